@@ -10,15 +10,18 @@ in VertexData
     vec4 TexShadowView;
 } fs_in;
 
+#ifdef BASE_MAP
 uniform sampler2D uBaseMap;
-uniform float uBaseMapSet;
-uniform vec4 uBaseColor;
+#endif
+#include "common/material.glsl"
 
+#ifdef NORMAL_MAP
 uniform sampler2D uNormalMap;
-uniform float uNormalMapSet;
+#endif
 
+#ifdef SHADOW_MAP
 uniform sampler2DShadow uShadowMap;
-uniform float uShadowMapSet;
+#endif
 
 #include "common/uniforms.glsl"
 #include "common/functions.glsl"
@@ -56,22 +59,22 @@ void main()
 {
     vec2 uv = fs_in.UV0;
 
-    vec4 albedo = uBaseMapSet > 0.0 ? SRGBtoLINEAR(texture(uBaseMap, uv)) * uBaseColor : uBaseColor;
-
-    vec3 N;
-    if (uNormalMapSet > 0.0)
-    {
-        vec3 n = fs_in.WorldNormal;
-        vec3 t = fs_in.WorldTangent.xyz;
-        vec3 b = cross(n, t) * sign(fs_in.WorldTangent.w);
-        mat3 TBN = mat3(t, b, n);
-        vec3 tangentNormal = texture(uNormalMap, uv).xyz * 2.0 - 1.0;
-        N = normalize(TBN * tangentNormal);
-    }
-    else
-    {
-        N = normalize(fs_in.WorldNormal);
-    }
+#ifdef BASE_MAP
+    vec4 albedo = SRGBtoLINEAR(texture(uBaseMap, uv)) * uBaseColor;
+#else
+    vec4 albedo = uBaseColor;
+#endif
+
+#ifdef NORMAL_MAP
+    vec3 n = fs_in.WorldNormal;
+    vec3 t = fs_in.WorldTangent.xyz;
+    vec3 b = cross(n, t) * sign(fs_in.WorldTangent.w);
+    mat3 TBN = mat3(t, b, n);
+    vec3 tangentNormal = texture(uNormalMap, uv).xyz * 2.0 - 1.0;
+    vec3 N = normalize(TBN * tangentNormal);
+#else
+    vec3 N = normalize(fs_in.WorldNormal);
+#endif
 
     vec3 V = normalize(CameraPosition - fs_in.WorldPosition);
     vec3 L = normalize(MainLightPosition - fs_in.WorldPosition);
@@ -79,11 +82,11 @@ void main()
 
     float NdotL = max(dot(N, L), 0.0);
 
+#ifdef SHADOW_MAP
+    float shadowAtten = SampleShadowMapPCFTent(uShadowMap, fs_in.TexShadowView);
+#else
     float shadowAtten = 1.0;
-    if (uShadowMapSet > 0.0)
-    {
-        shadowAtten = SampleShadowMapPCFTent(uShadowMap, fs_in.TexShadowView);
-    }
+#endif
 
     vec3 radiance = MainLightColor * shadowAtten;
 
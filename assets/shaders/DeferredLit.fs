@@ -14,12 +14,14 @@ uniform samplerCube uPrefilteredCubemap;
 uniform sampler2D uIBL_DFG;
 
 // Shadow
+#ifdef SHADOW_MAP
 uniform sampler2DShadow uShadowMap;
-uniform float uShadowMapSet;
+#endif
 
 // Screen Space Ambient Occlusion
-uniform float uSSAOSet;
+#ifdef SSAO
 uniform sampler2D uSSAOTexture;
+#endif
 
 #include "pbr/brdfs.glsl"
 #include "common/uniforms.glsl"
@@ -54,12 +56,12 @@ void main()
     float LdotH = max(dot(L, H), 0.0);
 
     // Main light shadow
+#ifdef SHADOW_MAP
+    vec4 texShadowView = ShadowViewFromWorld * vec4(worldPosition, 1.0);
+    float shadowAtten = SampleShadowMapPCFTent(uShadowMap, texShadowView);
+#else
     float shadowAtten = 1.0;
-    if (uShadowMapSet > 0.0)
-    {
-        vec4 texShadowView = ShadowViewFromWorld * vec4(worldPosition, 1.0);
-        shadowAtten = SampleShadowMapPCFTent(uShadowMap, texShadowView);
-    }
+#endif
 
     vec3 radiance = MainLightColor * shadowAtten;
 
@@ -104,11 +106,11 @@ void main()
     vec3 E = F0 * iblDFG.x + iblDFG.y;
     vec3 iblFr = prefilteredRadiance * E;
 
+#ifdef SSAO
+    float diffuseAO = texture(uSSAOTexture, uv).r;
+#else
     float diffuseAO = 1.0;
-    if (uSSAOSet > 0.0)
-    {
-        diffuseAO = texture(uSSAOTexture, uv).r;
-    }
+#endif
     // Environment irradiance
     vec3 diffuseIrradiance = texture(uIrradianceCubemap, N).rgb;
     vec3 iblFd = diffuseColor * diffuseIrradiance * diffuseAO;
@@ -0,0 +1,28 @@
+#version 410 core
+
+in vec2 UV0;
+
+// Alpha test
+#ifdef ALPHA_TEST
+#ifdef BASE_MAP
+uniform sampler2D uBaseMap;
+#endif
+// The base colour and the cutoff of the drawn material
+#include "common/material.glsl"
+#endif
+
+void main()
+{
+#ifdef ALPHA_TEST
+    // sRGB decoding does not change the alpha channel
+#ifdef BASE_MAP
+    float alpha = texture(uBaseMap, UV0).a * uBaseColor.a;
+#else
+    float alpha = uBaseColor.a;
+#endif
+    if (alpha < uAlphaCutoff)
+    {
+        discard;
+    }
+#endif
+}
\ No newline at end of file
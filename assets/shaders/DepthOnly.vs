@@ -0,0 +1,27 @@
+#version 410 core
+
+layout (location = 0) in vec3 vPosition;
+layout (location = 2) in vec2 vTexcoord0;
+
+#include "common/uniforms.glsl"
+
+#ifdef INSTANCING
+layout (location = 3) in mat4 iModelToWorld;
+#define uModelToWorld iModelToWorld
+#else
+#include "common/draw.glsl"
+#endif
+
+// The colour pass tests with GL_EQUAL, so the position must be computed exactly as in Lit.vs
+invariant gl_Position;
+
+out vec2 UV0;
+
+void main()
+{
+    UV0 = vTexcoord0;
+
+    vec3 worldPosition = vec3(uModelToWorld * vec4(vPosition, 1.0));
+
+    gl_Position = ClipFromView * ViewFromWorld * vec4(worldPosition, 1.0);
+}
@@ -13,35 +13,35 @@ in GBufferVertexData
     vec3 WorldPosition;
 } gbuffer_fs_in;
  
+// The material features (BASE_MAP, NORMAL_MAP, ...) are defined in the variants, see ShaderFeature
+
+// The colours and factors
+#include "common/material.glsl"
+
 // Albedo
+#ifdef BASE_MAP
 uniform sampler2D uBaseMap;
-uniform float uBaseMapSet;
-uniform vec4 uBaseColor;
+#endif
 
 // Normal
+#ifdef NORMAL_MAP
 uniform sampler2D uNormalMap;
-uniform float uNormalMapSet;
+#endif
 
 // Emission
+#ifdef EMISSIVE_MAP
 uniform sampler2D uEmissiveMap;
-uniform float uEmissiveMapSet;
-uniform vec4 uEmissiveColor;
+#endif
 
 // Metallic and roughness
+#ifdef METALLIC_ROUGHNESS_MAP
 uniform sampler2D uMetallicRoughnessMap;
-uniform float uMetallicRoughnessMapSet;
-uniform float uMetallicFactor;
-uniform float uRoughnessFactor;
+#endif
 
 // Occlusion
+#ifdef OCCLUSION_MAP
 uniform sampler2D uOcclusionMap;
-uniform float uOcclusionMapSet;
-
-// Alpha blend
-uniform float uAlphaBlendSet;
-// Alpha test
-uniform float uAlphaTestSet;
-uniform float uAlphaCutoff;
+#endif
 
 #include "common/functions.glsl"
 
@@ -49,51 +49,53 @@ void main()
 {
     vec2 uv = gbuffer_fs_in.UV0;
 
-    vec4 albedo = uBaseMapSet > 0.0 ? SRGBtoLINEAR(texture(uBaseMap, uv)) * uBaseColor : uBaseColor;
+#ifdef BASE_MAP
+    vec4 albedo = SRGBtoLINEAR(texture(uBaseMap, uv)) * uBaseColor;
+#else
+    vec4 albedo = uBaseColor;
+#endif
 
     // Alpha test
-    if (uAlphaTestSet > 0.0)
+#ifdef ALPHA_TEST
+    if (albedo.a < uAlphaCutoff)
     {
-        if (albedo.a < uAlphaCutoff)
-        {
-            discard;
-        }
+        discard;
     }
+#endif
 
     float metallic = uMetallicFactor;
     float perceptualRoughness = uRoughnessFactor;
-    if (uMetallicRoughnessMapSet > 0.0)
-    {
-        // Roughness is stored in the 'g' channel, metallic is stored in the 'b' channel.
-        vec4 metallicRoughness = texture(uMetallicRoughnessMap, uv);
-        metallic *= metallicRoughness.b;
-        perceptualRoughness *= metallicRoughness.g;
-    }
-
-    vec3 N;
-    if (uNormalMapSet > 0.0)
-    {
-        vec3 n = gbuffer_fs_in.WorldNormal;
-        vec3 t = gbuffer_fs_in.WorldTangent.xyz;
-        vec3 b = cross(n, t) * sign(gbuffer_fs_in.WorldTangent.w);
-        mat3 TBN = mat3(t, b, n);
-        vec3 tangentNormal = texture(uNormalMap, uv).xyz * 2.0 - 1.0;
-        N = normalize(TBN * tangentNormal);
-    }
-    else
-    {
-        N = normalize(gbuffer_fs_in.WorldNormal);
-    }
+#ifdef METALLIC_ROUGHNESS_MAP
+    // Roughness is stored in the 'g' channel, metallic is stored in the 'b' channel.
+    vec4 metallicRoughness = texture(uMetallicRoughnessMap, uv);
+    metallic *= metallicRoughness.b;
+    perceptualRoughness *= metallicRoughness.g;
+#endif
+
+#ifdef NORMAL_MAP
+    vec3 n = gbuffer_fs_in.WorldNormal;
+    vec3 t = gbuffer_fs_in.WorldTangent.xyz;
+    vec3 b = cross(n, t) * sign(gbuffer_fs_in.WorldTangent.w);
+    mat3 TBN = mat3(t, b, n);
+    vec3 tangentNormal = texture(uNormalMap, uv).xyz * 2.0 - 1.0;
+    vec3 N = normalize(TBN * tangentNormal);
+#else
+    vec3 N = normalize(gbuffer_fs_in.WorldNormal);
+#endif
 
     // Occlusion
+#ifdef OCCLUSION_MAP
+    float occlusion = texture(uOcclusionMap, uv).r;
+#else
     float occlusion = 1.0;
-    if (uOcclusionMapSet > 0.0)
-    {
-        occlusion = texture(uOcclusionMap, uv).r;
-    }
+#endif
 
     // Emissive
-    vec3 emission = uEmissiveMapSet > 0.0 ? SRGBtoLINEAR(texture(uEmissiveMap, uv)).rgb * uEmissiveColor.rgb : vec3(0.0);
+#ifdef EMISSIVE_MAP
+    vec3 emission = SRGBtoLINEAR(texture(uEmissiveMap, uv)).rgb * uEmissiveColor.rgb;
+#else
+    vec3 emission = vec3(0.0);
+#endif
 
     GBuffer0 = vec4(albedo.rgb, metallic);                        // rgb: albedo, a: occlusion
     GBuffer1 = vec4(N, perceptualRoughness);                      // rgb: normal, a: roughness
@@ -7,8 +7,18 @@ layout (location = 2) in vec2 vTexcoord0;
 #include "common/uniforms.glsl"
 #include "common/functions.glsl"
 
-uniform mat4 uModelToWorld;
-uniform mat3 uModelNormalToWorld;
+#ifdef INSTANCING
+// Per-instance attributes, a matrix takes one location per column
+layout (location = 3) in mat4 iModelToWorld;
+layout (location = 7) in mat3 iModelNormalToWorld;
+#define uModelToWorld iModelToWorld
+#define uModelNormalToWorld iModelNormalToWorld
+#else
+#include "common/draw.glsl"
+#endif
+
+// Must match DepthOnly.vs, the colour pass after a depth pre-pass tests with GL_EQUAL
+invariant gl_Position;
 
 out VertexData
 {
@@ -10,35 +10,35 @@ in VertexData
     vec4 TexShadowView;
 } fs_in;
 
+// The material features (BASE_MAP, NORMAL_MAP, ...) are defined in the variants, see ShaderFeature
+
+// The colours and factors
+#include "common/material.glsl"
+
 // Albedo
+#ifdef BASE_MAP
 uniform sampler2D uBaseMap;
-uniform float uBaseMapSet;
-uniform vec4 uBaseColor;
+#endif
 
 // Normal
+#ifdef NORMAL_MAP
 uniform sampler2D uNormalMap;
-uniform float uNormalMapSet;
+#endif
 
 // Emission
+#ifdef EMISSIVE_MAP
 uniform sampler2D uEmissiveMap;
-uniform float uEmissiveMapSet;
-uniform vec4 uEmissiveColor;
+#endif
 
 // Metallic and roughness
+#ifdef METALLIC_ROUGHNESS_MAP
 uniform sampler2D uMetallicRoughnessMap;
-uniform float uMetallicRoughnessMapSet;
-uniform float uMetallicFactor;
-uniform float uRoughnessFactor;
+#endif
 
 // Occlusion
+#ifdef OCCLUSION_MAP
 uniform sampler2D uOcclusionMap;
-uniform float uOcclusionMapSet;
-
-// Alpha blend
-uniform float uAlphaBlendSet;
-// Alpha test
-uniform float uAlphaTestSet;
-uniform float uAlphaCutoff;
+#endif
 
 // IBL
 uniform samplerCube uIrradianceCubemap;
@@ -46,8 +46,14 @@ uniform samplerCube uPrefilteredCubemap;
 uniform sampler2D uIBL_DFG;
 
 // Shadow
+#ifdef SHADOW_MAP
 uniform sampler2DShadow uShadowMap;
-uniform float uShadowMapSet;
+#endif
+
+// SSAO, only available with the depth pre-pass
+#ifdef SSAO
+uniform sampler2D uSSAOTexture;
+#endif
 
 #include "pbr/brdfs.glsl"
 #include "common/uniforms.glsl"
@@ -58,41 +64,39 @@ void main()
 {
     vec2 uv = fs_in.UV0;
 
-    vec4 baseColor = uBaseMapSet > 0.0 ? SRGBtoLINEAR(texture(uBaseMap, uv)) * uBaseColor : uBaseColor;
+#ifdef BASE_MAP
+    vec4 baseColor = SRGBtoLINEAR(texture(uBaseMap, uv)) * uBaseColor;
+#else
+    vec4 baseColor = uBaseColor;
+#endif
 
     // Alpha test
-    if (uAlphaTestSet > 0.0)
+#ifdef ALPHA_TEST
+    if (baseColor.a < uAlphaCutoff)
     {
-        if (baseColor.a < uAlphaCutoff)
-        {
-            discard;
-        }
+        discard;
     }
+#endif
 
     float metallic = uMetallicFactor;
     float perceptualRoughness = uRoughnessFactor;
-    if (uMetallicRoughnessMapSet > 0.0)
-    {
-        // Roughness is stored in the 'g' channel, metallic is stored in the 'b' channel.
-        vec4 metallicRoughness = texture(uMetallicRoughnessMap, uv);
-        metallic *= metallicRoughness.b;
-        perceptualRoughness *= metallicRoughness.g;
-    }
-
-    vec3 N;
-    if (uNormalMapSet > 0.0)
-    {
-        vec3 n = fs_in.WorldNormal;
-        vec3 t = fs_in.WorldTangent.xyz;
-        vec3 b = cross(n, t) * sign(fs_in.WorldTangent.w);
-        mat3 TBN = mat3(t, b, n);
-        vec3 tangentNormal = texture(uNormalMap, uv).xyz * 2.0 - 1.0;
-        N = normalize(TBN * tangentNormal);
-    }
-    else
-    {
-        N = normalize(fs_in.WorldNormal);
-    }
+#ifdef METALLIC_ROUGHNESS_MAP
+    // Roughness is stored in the 'g' channel, metallic is stored in the 'b' channel.
+    vec4 metallicRoughness = texture(uMetallicRoughnessMap, uv);
+    metallic *= metallicRoughness.b;
+    perceptualRoughness *= metallicRoughness.g;
+#endif
+
+#ifdef NORMAL_MAP
+    vec3 n = fs_in.WorldNormal;
+    vec3 t = fs_in.WorldTangent.xyz;
+    vec3 b = cross(n, t) * sign(fs_in.WorldTangent.w);
+    mat3 TBN = mat3(t, b, n);
+    vec3 tangentNormal = texture(uNormalMap, uv).xyz * 2.0 - 1.0;
+    vec3 N = normalize(TBN * tangentNormal);
+#else
+    vec3 N = normalize(fs_in.WorldNormal);
+#endif
 
     vec3 V = normalize(CameraPosition - fs_in.WorldPosition);
     vec3 L = normalize(MainLightPosition - fs_in.WorldPosition);
@@ -105,11 +109,11 @@ void main()
 
 
     // Main light shadow
+#ifdef SHADOW_MAP
+    float shadowAtten = SampleShadowMapPCFTent(uShadowMap, fs_in.TexShadowView);
+#else
     float shadowAtten = 1.0;
-    if (uShadowMapSet > 0.0)
-    {
-        shadowAtten = SampleShadowMapPCFTent(uShadowMap, fs_in.TexShadowView);
-    }
+#endif
 
     vec3 radiance = MainLightColor * shadowAtten;
 
@@ -155,7 +159,11 @@ void main()
     vec3 E = F0 * iblDFG.x + iblDFG.y;
     vec3 iblFr = prefilteredRadiance * E;
 
-    float diffuseAO = 1.0;//texture(uSSAOTexture, uv).r;
+#ifdef SSAO
+    float diffuseAO = texture(uSSAOTexture, gl_FragCoord.xy / vec2(textureSize(uSSAOTexture, 0))).r;
+#else
+    float diffuseAO = 1.0;
+#endif
     // Environment irradiance
     vec3 diffuseIrradiance = texture(uIrradianceCubemap, N).rgb;
     vec3 iblFd = diffuseColor * diffuseIrradiance * diffuseAO;
@@ -163,16 +171,24 @@ void main()
     Lo += iblFr + iblFd;
 
     // Occlusion
+#ifdef OCCLUSION_MAP
+    float occlusion = texture(uOcclusionMap, uv).r;
+#else
     float occlusion = 1.0;
-    if (uOcclusionMapSet > 0.0)
-    {
-        occlusion = texture(uOcclusionMap, uv).r;
-    }
+#endif
     Lo *= occlusion;
 
     // Emissive
-    vec3 emission = uEmissiveMapSet > 0.0 ? SRGBtoLINEAR(texture(uEmissiveMap, uv)).rgb * uEmissiveColor.rgb : vec3(0.0);
+#ifdef EMISSIVE_MAP
+    vec3 emission = SRGBtoLINEAR(texture(uEmissiveMap, uv)).rgb * uEmissiveColor.rgb;
+#else
+    vec3 emission = vec3(0.0);
+#endif
     Lo += emission;
 
-    FragColor = vec4(Lo, uAlphaBlendSet > 0.0 ? baseColor.a : 1.0); // * CascadeColors[GetCascadeIndex(fs_in.TexShadowView)];
+#ifdef ALPHA_BLEND
+    FragColor = vec4(Lo, baseColor.a);
+#else
+    FragColor = vec4(Lo, 1.0); // * CascadeColors[GetCascadeIndex(fs_in.TexShadowView)];
+#endif
 }
\ No newline at end of file
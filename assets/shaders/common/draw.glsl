@@ -0,0 +1,11 @@
+#ifndef DRAW_GLSL
+#define DRAW_GLSL
+
+// Per-draw data of the draws without instancing, each draw binds its own block of the ring buffer, see DrawUniformBuffer
+layout (std140) uniform DrawUniforms
+{
+    mat4 uModelToWorld;
+    mat3 uModelNormalToWorld;
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef MATERIAL_GLSL
+#define MATERIAL_GLSL
+
+// Parameters of a material, each material owns one block of the shared material buffer, see MaterialParameterBuffer.
+// Every shader declares the block through this file, so the std140 layout is the same and the depth pre-pass can read
+// the blocks of the lit materials.
+layout (std140) uniform MaterialParameters
+{
+    vec4 uBaseColor;
+    vec4 uEmissiveColor;
+    float uMetallicFactor;
+    float uRoughnessFactor;
+    float uAlphaCutoff;
+};
+
+#endif
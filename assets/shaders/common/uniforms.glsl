@@ -17,7 +17,4 @@ layout (std140) uniform GlobalUniforms
     vec4 ZBufferParams; // { x: near (positive), y: far (positive), zw; unused }
 };
 
-uniform float uFXAASet;
-uniform float uToneMappingSet;
-
 #endif
\ No newline at end of file
@@ -5,8 +5,9 @@ in vec2 UV0;
 
 uniform sampler2D uSourceTex;
 
-uniform float uBloomSet;
+#ifdef BLOOM
 uniform sampler2D uBloomTex;
+#endif
 
 uniform float uBloomIntensity;
 uniform float uBlitToCamera;
@@ -21,20 +22,17 @@ void main()
 
     vec4 color = texture(uSourceTex, uv);
 
-    vec3 bloom = vec3(0.0);
-    if (uBloomSet > 0.0)
-    {
-        bloom = texture(uBloomTex, uv).rgb;
-        color.rgb += bloom * uBloomIntensity;
-    }
+#ifdef BLOOM
+    vec3 bloom = texture(uBloomTex, uv).rgb;
+    color.rgb += bloom * uBloomIntensity;
+#endif
 
     if (uBlitToCamera > 0)
     {
         // HDR tonemapping
-        if (uToneMappingSet > 0.0)
-        {
-            color.rgb = ACESFilm(color.rgb);
-        }
+#ifdef TONE_MAPPING
+        color.rgb = ACESFilm(color.rgb);
+#endif
 
         // Gamma correction in final blit
         color = GammaCorrection(color);
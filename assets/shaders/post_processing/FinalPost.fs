@@ -17,16 +17,14 @@ void main()
 
     vec4 color = texture(uSourceTex, uv);
 
-    if (uFXAASet > 0.0)
-    {
-        color = ApplyFXAA(color, uSourceTex, uSourceTexSize.xy, uv);
-    }
+#ifdef FXAA
+    color = ApplyFXAA(color, uSourceTex, uSourceTexSize.xy, uv);
+#endif
 
     // HDR tonemapping
-    if (uToneMappingSet > 0.0)
-    {
-        color.rgb = ACESFilm(color.rgb);
-    }
+#ifdef TONE_MAPPING
+    color.rgb = ACESFilm(color.rgb);
+#endif
 
     // Gamma correction in final blit
     color = GammaCorrection(color);
@@ -2,11 +2,18 @@
 
 layout (location = 0) in vec3 vPosition;
 
-uniform mat4 uLightMVP;
+uniform mat4 uLightViewProjection;
+
+#ifdef INSTANCING
+layout (location = 3) in mat4 iModelToWorld;
+#define uModelToWorld iModelToWorld
+#else
+#include "common/draw.glsl"
+#endif
 
 void main()
 {
-    gl_Position = uLightMVP * vec4(vPosition, 1.0);
+    gl_Position = uLightViewProjection * (uModelToWorld * vec4(vPosition, 1.0));
 
     // Shadow Pancaking
     gl_Position.z = max(gl_Position.z, -1.0);
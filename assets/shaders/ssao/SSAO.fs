@@ -119,6 +119,12 @@ void main()
     vec2 uv = UV0;
 
     float z = texture(uDepthTexture, uv).r;
+    // Skip pixels at max 1.0 (i.e. the skybox), the output matches the clear color of the target
+    if (z == 1.0)
+    {
+        FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
     z = LinearizeDepth(z);
 
     mat4 invProjection = inverse(ClipFromView);
@@ -1,10 +0,0 @@
-#version 410 core
-
-in vec2 UV0;
-
-uniform sampler2D uDepthAttachment;
-
-void main()
-{
-    gl_FragDepth = texture(uDepthAttachment, UV0).r;
-}
\ No newline at end of file
@@ -4,7 +4,7 @@ layout (location = 0) in vec3 vPosition;
 
 #include "common/uniforms.glsl"
 
-uniform mat4 uModelToWorld;
+#include "common/draw.glsl"
 
 void main()
 {
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "utility/BoundingVolumeHierarchy.h"
+
+using namespace Collision;
+
+// 10k random boxes in a flat slab, the BVH queries against a linear loop over FrustumPlanes::Intersects.
+namespace
+{
+    constexpr int ITEM_COUNT = 10000;
+    constexpr int BUILD_REPEAT = 10;
+    constexpr int QUERY_REPEAT = 100;
+
+    double ElapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    bool BoxesOverlap(const BoundingBox &a, const BoundingBox &b)
+    {
+        return glm::all(glm::lessThanEqual(glm::abs(a.Center - b.Center), a.Extents + b.Extents));
+    }
+
+    // Boxes sharing a centre cannot be split, so they end in one leaf larger than MAX_LEAF_SIZE
+    bool CheckCoincidentCentroids()
+    {
+        std::vector<BoundingBox> bounds(12);
+        for (size_t i = 0; i < bounds.size(); ++i)
+        {
+            bounds[i].Center = vec3(0.0f, 0.0f, -5.0f);
+            bounds[i].Extents = vec3(1.0f + 0.1f * i);
+        }
+
+        BoundingVolumeHierarchy bvh;
+        bvh.Build(bounds);
+
+        // A frustum cutting the boxes, so the leaf is tested item by item
+        mat4 viewProjection = glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, 300.0f) * glm::lookAt(vec3(0.0f), vec3(0.6f, 0.0f, -1.0f), vec3(0, 1, 0));
+        FrustumPlanes planes(viewProjection);
+
+        std::vector<uint32_t> visible, reference;
+        bvh.Query(planes, visible);
+        for (uint32_t i = 0; i < bounds.size(); ++i)
+        {
+            if (planes.Intersects(bounds[i]))
+            {
+                reference.push_back(i);
+            }
+        }
+        std::sort(visible.begin(), visible.end());
+
+        bool match = visible == reference;
+        std::printf("coincident centroids: %zu boxes, %zu nodes, visible: %zu (%s)\n", bounds.size(), bvh.GetNodeCount(), visible.size(),
+            match ? "match" : "MISMATCH");
+        return match;
+    }
+}
+
+int RunBVHCullingBench()
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> extent(0.1f, 2.0f);
+
+    std::vector<BoundingBox> bounds(ITEM_COUNT);
+    for (size_t i = 0; i < bounds.size(); ++i)
+    {
+        bounds[i].Center = vec3(position(rng), position(rng) * 0.2f, position(rng));
+        bounds[i].Extents = vec3(extent(rng), extent(rng), extent(rng));
+    }
+
+    BoundingVolumeHierarchy bvh;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int k = 0; k < BUILD_REPEAT; ++k)
+    {
+        bvh.Build(bounds);
+    }
+    double buildTime = ElapsedMilliseconds(start) / BUILD_REPEAT;
+
+    for (size_t i = 0; i < bounds.size(); ++i)
+    {
+        bounds[i].Center.y += 0.5f;
+    }
+    start = std::chrono::high_resolution_clock::now();
+    for (int k = 0; k < QUERY_REPEAT; ++k)
+    {
+        bvh.Refit(bounds);
+    }
+    double refitTime = ElapsedMilliseconds(start) / QUERY_REPEAT;
+
+    mat4 viewProjection = glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, 300.0f) * glm::lookAt(vec3(0, 10, 0), vec3(50, 0, 30), vec3(0, 1, 0));
+    FrustumPlanes planes(viewProjection);
+
+    std::vector<uint32_t> visible;
+    visible.reserve(ITEM_COUNT);
+    start = std::chrono::high_resolution_clock::now();
+    for (int k = 0; k < QUERY_REPEAT; ++k)
+    {
+        visible.clear();
+        bvh.Query(planes, visible);
+    }
+    double queryTime = ElapsedMilliseconds(start) / QUERY_REPEAT;
+
+    std::vector<uint32_t> reference;
+    reference.reserve(ITEM_COUNT);
+    start = std::chrono::high_resolution_clock::now();
+    for (int k = 0; k < QUERY_REPEAT; ++k)
+    {
+        reference.clear();
+        for (uint32_t i = 0; i < bounds.size(); ++i)
+        {
+            if (planes.Intersects(bounds[i]))
+            {
+                reference.push_back(i);
+            }
+        }
+    }
+    double linearTime = ElapsedMilliseconds(start) / QUERY_REPEAT;
+    std::sort(visible.begin(), visible.end());
+
+    BoundingBox queryBox;
+    queryBox.Center = vec3(10.0f, 0.0f, 10.0f);
+    queryBox.Extents = vec3(20.0f);
+    std::vector<uint32_t> overlapping, referenceOverlapping;
+    bvh.Query(queryBox, overlapping);
+    for (uint32_t i = 0; i < bounds.size(); ++i)
+    {
+        if (BoxesOverlap(bounds[i], queryBox))
+        {
+            referenceOverlapping.push_back(i);
+        }
+    }
+    std::sort(overlapping.begin(), overlapping.end());
+
+    bool frustumMatch = visible == reference;
+    bool boxMatch = overlapping == referenceOverlapping;
+    std::printf("%d boxes, %zu nodes, build: %.3f ms, refit: %.3f ms, frustum query: %.4f ms, linear: %.4f ms\n",
+        ITEM_COUNT, bvh.GetNodeCount(), buildTime, refitTime, queryTime, linearTime);
+    std::printf("frustum visible: %zu (%s), box overlapping: %zu (%s)\n", visible.size(), frustumMatch ? "match" : "MISMATCH",
+        overlapping.size(), boxMatch ? "match" : "MISMATCH");
+    bool coincidentMatch = CheckCoincidentCentroids();
+    return frustumMatch && boxMatch && coincidentMatch ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+#include <cstdio>
+#include <cstring>
+
+// Microbenchmarks of the CPU side systems, built with -DBUILD_BENCHMARKS=ON.
+// Each benchmark prints its timings against the reference path and returns non-zero if the results differ.
+int RunTransformHierarchyBench();
+int RunBVHCullingBench();
+int RunFrustumBatchBench();
+
+struct Benchmark
+{
+    const char *Name;
+    int (*Run)();
+};
+
+static const Benchmark s_Benchmarks[] = {
+    { "transform", RunTransformHierarchyBench },
+    { "bvh", RunBVHCullingBench },
+    { "frustum", RunFrustumBatchBench },
+};
+
+int main(int argc, char **argv)
+{
+    // All the benchmarks, or the ones named on the command line
+    int failures = 0;
+    for (const Benchmark &benchmark : s_Benchmarks)
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i)
+        {
+            selected = selected || std::strcmp(argv[i], benchmark.Name) == 0;
+        }
+
+        if (selected)
+        {
+            std::printf("[%s]\n", benchmark.Name);
+            if (benchmark.Run() != 0)
+            {
+                std::printf("[%s] FAILED\n", benchmark.Name);
+                ++failures;
+            }
+        }
+    }
+    return failures;
+}
@@ -0,0 +1,98 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "utility/Collision.h"
+
+using namespace Collision;
+
+// 64k random boxes and spheres against one 6-plane frustum, the batch kernels against the scalar test of each box.
+// The kernel path is chosen at compile time like in Collision.cpp, build with -mavx to compare the AVX path.
+namespace
+{
+    constexpr int ITEM_COUNT = 1 << 16;
+    constexpr int REPEAT = 200;
+
+    double MillionsPerSecond(std::chrono::high_resolution_clock::time_point start)
+    {
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        return static_cast<double>(ITEM_COUNT) * REPEAT / seconds / 1e6;
+    }
+
+    const char* GetKernelPath()
+    {
+#if defined(__AVX__)
+        return "AVX";
+#elif defined(__SSE__) || defined(_M_X64) || defined(_M_IX86_FP)
+        return "SSE";
+#else
+        return "scalar";
+#endif
+    }
+}
+
+int RunFrustumBatchBench()
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> extent(0.1f, 2.0f);
+
+    std::vector<BoundingBox> boxes(ITEM_COUNT);
+    BoundingBoxBatch boxBatch;
+    boxBatch.Resize(ITEM_COUNT);
+    BoundingSphereBatch sphereBatch;
+    sphereBatch.Resize(ITEM_COUNT);
+    for (int i = 0; i < ITEM_COUNT; ++i)
+    {
+        boxes[i].Center = vec3(position(rng), position(rng), position(rng));
+        boxes[i].Extents = vec3(extent(rng), extent(rng), extent(rng));
+        boxBatch.Set(i, boxes[i]);
+        sphereBatch.Set(i, BoundingSphere(boxes[i].Center, glm::length(boxes[i].Extents)));
+    }
+
+    FrustumPlanes planes(glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, 300.0f) * glm::lookAt(vec3(0, 10, 0), vec3(50, 0, 30), vec3(0, 1, 0)));
+    std::vector<uint8_t> results(ITEM_COUNT);
+
+    size_t boxVisible = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int k = 0; k < REPEAT; ++k)
+    {
+        boxVisible = IntersectBatch(planes, boxBatch, 0, ITEM_COUNT, results.data());
+    }
+    double boxRate = MillionsPerSecond(start);
+
+    size_t sphereVisible = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (int k = 0; k < REPEAT; ++k)
+    {
+        sphereVisible = IntersectBatch(planes, sphereBatch, 0, ITEM_COUNT, results.data());
+    }
+    double sphereRate = MillionsPerSecond(start);
+
+    size_t scalarVisible = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (int k = 0; k < REPEAT; ++k)
+    {
+        scalarVisible = 0;
+        for (int i = 0; i < ITEM_COUNT; ++i)
+        {
+            scalarVisible += planes.Intersects(boxes[i]) ? 1 : 0;
+        }
+    }
+    double scalarRate = MillionsPerSecond(start);
+
+    // The box kernel must agree with the scalar test on every box
+    IntersectBatch(planes, boxBatch, 0, ITEM_COUNT, results.data());
+    int mismatches = 0;
+    for (int i = 0; i < ITEM_COUNT; ++i)
+    {
+        mismatches += (results[i] != 0) != planes.Intersects(boxes[i]) ? 1 : 0;
+    }
+
+    std::printf("%s kernels, boxes: %.0f M/s, spheres: %.0f M/s, scalar boxes: %.0f M/s\n", GetKernelPath(), boxRate, sphereRate, scalarRate);
+    std::printf("visible boxes: %zu, spheres: %zu, scalar: %zu, mismatches: %d\n", boxVisible, sphereVisible, scalarVisible, mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "scene/SceneNode.h"
+#include "scene/TransformHierarchy.h"
+
+// 10k nodes in 100 chains of depth 100, every world matrix is read each frame like the render commands do.
+// The reference walks the parent chain of every node, as GetModelMatrix() did before the world matrices were cached.
+namespace
+{
+    constexpr int CHAIN_COUNT = 100;
+    constexpr int CHAIN_DEPTH = 100;
+    constexpr int FRAME_COUNT = 100;
+
+    double ElapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+}
+
+int RunTransformHierarchyBench()
+{
+    SceneNode::Ptr root = SceneNode::New();
+    std::vector<SceneNode::Ptr> nodes;
+    std::vector<int> parents;   // Index in nodes, -1 for the children of the root
+    for (int c = 0; c < CHAIN_COUNT; ++c)
+    {
+        SceneNode::Ptr parent = root;
+        int parentIndex = -1;
+        for (int d = 0; d < CHAIN_DEPTH; ++d)
+        {
+            SceneNode::Ptr node = SceneNode::New();
+            node->SetModelMatrix(glm::translate(glm::mat4(1.0f), glm::vec3(0.01f * d, 0.0f, 0.0f)));
+            parent->AddChild(node);
+            nodes.push_back(node);
+            parents.push_back(parentIndex);
+            parent = node;
+            parentIndex = static_cast<int>(nodes.size()) - 1;
+        }
+    }
+
+    float sink = 0.0f;
+
+    // Reference, the parent chain of every node multiplied on each read
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int f = 0; f < FRAME_COUNT; ++f)
+    {
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            glm::mat4 world = nodes[i]->GetLocalMatrix();
+            for (int p = parents[i]; p >= 0; p = parents[p])
+            {
+                world = nodes[p]->GetLocalMatrix() * world;
+            }
+            sink += world[3][0];
+        }
+    }
+    double referenceTime = ElapsedMilliseconds(start) / FRAME_COUNT;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int f = 0; f < FRAME_COUNT; ++f)
+    {
+        TransformHierarchy::Get().UpdateWorldMatrices();
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            sink += nodes[i]->GetModelMatrix()[3][0];
+        }
+    }
+    double staticTime = ElapsedMilliseconds(start) / FRAME_COUNT;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int f = 0; f < FRAME_COUNT; ++f)
+    {
+        nodes[(f % CHAIN_COUNT) * CHAIN_DEPTH]->Translate(glm::vec3(0.001f));
+        TransformHierarchy::Get().UpdateWorldMatrices();
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            sink += nodes[i]->GetModelMatrix()[3][0];
+        }
+    }
+    double movingTime = ElapsedMilliseconds(start) / FRAME_COUNT;
+
+    // The cached matrices must match the chain walk
+    int mismatches = 0;
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        glm::mat4 world = nodes[i]->GetLocalMatrix();
+        for (int p = parents[i]; p >= 0; p = parents[p])
+        {
+            world = nodes[p]->GetLocalMatrix() * world;
+        }
+        glm::vec4 difference = glm::abs(world[3] - nodes[i]->GetModelMatrix()[3]);
+        mismatches += glm::max(glm::max(difference.x, difference.y), difference.z) > 1e-3f ? 1 : 0;
+    }
+
+    std::printf("%zu nodes, chain walk: %.3f ms/frame, cached static: %.3f ms/frame, cached one chain moving: %.3f ms/frame (sink %f)\n",
+        nodes.size(), referenceTime, staticTime, movingTime, sink);
+    std::printf("mismatches: %d\n", mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -1,11 +1,19 @@
 #include "base/Material.h"
 
-#include "loader/AssetsLoader.h"
+#include <algorithm>
+#include <cstring>
+
+#include "base/MaterialParameterBuffer.h"
+
+uint32_t Material::s_NextMaterialID = 1;
 
 Material::Material(const std::string &shaderName, const std::string &vsPath, const std::string &fsPath, bool usedForSkybox)
-    : m_UsedForSkybox(usedForSkybox), m_CastShadows(true), m_RenderFace(RenderFace::FRONT), m_AlphaMode(AlphaMode::DEFAULT_OPAQUE)
+    : m_Features(ShaderFeature::NONE), m_Version(0), m_ParameterOffset(RangeAllocator::INVALID_OFFSET), m_ParameterVersion(0),
+      m_UsedForSkybox(usedForSkybox), m_CastShadows(true), m_RenderFace(RenderFace::FRONT), m_AlphaMode(AlphaMode::DEFAULT_OPAQUE),
+      m_MaterialID(s_NextMaterialID++), m_TextureSetKey(0), m_TextureSetDirty(true)
 {
-    m_Shader = AssetsLoader::LoadShader(shaderName, vsPath, fsPath);
+    // The variant is compiled when it is first used, after the loader has set the features
+    m_ShaderVariants = ShaderVariantCache::Get(shaderName, vsPath, fsPath);
     
     if (m_UsedForSkybox)
     {
@@ -16,42 +24,128 @@ Material::Material(const std::string &shaderName, const std::string &vsPath, con
 Material::~Material()
 {
     ClearUniforms();
+    MaterialParameterBuffer::Free(m_ParameterOffset, static_cast<uint32_t>(m_ParameterData.size()));
+}
+
+namespace
+{
+    // Position of the property in an array sorted by the property ids
+    template<typename T>
+    typename std::vector<T>::iterator LowerBound(std::vector<T> &values, int propertyID)
+    {
+        return std::lower_bound(values.begin(), values.end(), propertyID, [](const T &value, int id) { return value.PropertyID < id; });
+    }
+
+    template<typename T, typename TexturePtr>
+    bool AddOrSetTextureValue(std::vector<T> &values, int propertyID, const TexturePtr &texture)
+    {
+        auto iter = LowerBound(values, propertyID);
+        if (iter != values.end() && iter->PropertyID == propertyID)
+        {
+            if (iter->Texture == texture)
+            {
+                return false;
+            }
+            iter->Texture = texture;
+        }
+        else
+        {
+            values.insert(iter, T{ propertyID, texture });
+        }
+        return true;
+    }
 }
 
 void Material::AddOrSetTexture(Texture2D::Ptr texture)
 {
-    m_Textures.insert_or_assign(texture->GetTextureName(), texture);
+    AddOrSetTexture(texture->GetTextureName(), texture);
 }
 
 void Material::AddOrSetTextureCube(TextureCube::Ptr textureCube)
 {
-    m_TextureCubes.insert_or_assign(textureCube->GetTextureName(), textureCube);
+    if (AddOrSetTextureValue(m_TextureCubes, Shader::PropertyToID(textureCube->GetTextureName()), textureCube))
+    {
+        m_TextureSetDirty = true;
+    }
 }
 
 void Material::AddOrSetTexture(const std::string &propertyName, Texture2D::Ptr texture)
 {
     texture->SetTextureName(propertyName);
-    m_Textures.insert_or_assign(propertyName, texture);
+
+    // The IBL and shadow maps are set again every frame, only a new texture invalidates the key
+    if (AddOrSetTextureValue(m_Textures, Shader::PropertyToID(propertyName), texture))
+    {
+        m_TextureSetDirty = true;
+    }
 }
 
 void Material::AddOrSetVector(const std::string &propertyName, const glm::vec4 &value)
 {
-    m_UniformVec4.insert_or_assign(propertyName, value);
+    UniformValue &uniform = GetOrAddUniform(Shader::PropertyToID(propertyName), false);
+    if (uniform.Value != value || uniform.Version == 0)
+    {
+        uniform.Value = value;
+        uniform.Version = ++m_Version;
+    }
 }
 
 void Material::AddOrSetFloat(const std::string &propertyName, const float &value)
 {
-    m_UniformFloats.insert_or_assign(propertyName, value);
+    UniformValue &uniform = GetOrAddUniform(Shader::PropertyToID(propertyName), true);
+    if (uniform.Value.x != value || uniform.Version == 0)
+    {
+        uniform.Value.x = value;
+        uniform.Version = ++m_Version;
+    }
+}
+
+Material::UniformValue& Material::GetOrAddUniform(int propertyID, bool isFloat)
+{
+    auto iter = LowerBound(m_Uniforms, propertyID);
+    if (iter == m_Uniforms.end() || iter->PropertyID != propertyID)
+    {
+        // Version 0 marks a value which has never been set
+        iter = m_Uniforms.insert(iter, UniformValue{ propertyID, glm::vec4(0.0f), isFloat, 0 });
+    }
+    iter->IsFloat = isFloat;
+    return *iter;
+}
+
+const Material::UniformValue* Material::FindUniform(int propertyID) const
+{
+    auto iter = std::lower_bound(m_Uniforms.begin(), m_Uniforms.end(), propertyID,
+        [](const UniformValue &value, int id) { return value.PropertyID < id; });
+    return iter != m_Uniforms.end() && iter->PropertyID == propertyID ? &(*iter) : nullptr;
+}
+
+Texture2D::Ptr Material::GetTexture(const std::string &propertyName)
+{
+    int propertyID = Shader::PropertyToID(propertyName);
+    auto iter = LowerBound(m_Textures, propertyID);
+    return iter != m_Textures.end() && iter->PropertyID == propertyID ? iter->Texture : nullptr;
+}
+
+glm::vec4 Material::GetVector(const std::string &propertyName, const glm::vec4 &defaultValue)
+{
+    const UniformValue *uniform = FindUniform(Shader::PropertyToID(propertyName));
+    return uniform && !uniform->IsFloat ? uniform->Value : defaultValue;
+}
+
+float Material::GetFloat(const std::string &propertyName, const float &defaultValue)
+{
+    const UniformValue *uniform = FindUniform(Shader::PropertyToID(propertyName));
+    return uniform && uniform->IsFloat ? uniform->Value.x : defaultValue;
 }
 
 void Material::SetMatrix(const std::string &propertyName, const glm::mat3x3 &value)
 {
-    m_Shader->SetUniformMatrix(propertyName, value);
+    GetShader()->SetUniformMatrix(Shader::PropertyToID(propertyName), value);
 }
 
 void Material::SetMatrix(const std::string &propertyName, const glm::mat4x4 &value)
 {
-    m_Shader->SetUniformMatrix(propertyName, value);
+    GetShader()->SetUniformMatrix(Shader::PropertyToID(propertyName), value);
 }
 
 void Material::SetRenderFace(RenderFace face)
@@ -98,53 +192,159 @@ bool Material::GetMaterialCastShadows()
     return m_CastShadows;
 }
 
-void Material::Use()
+void Material::Use(bool instanced)
 {
-    m_Shader->Use();
+    Shader* shader = instanced ? GetInstancedShader().get() : GetShader().get();
+    shader->Use();
 
-    if (m_UniformVec4.size() > 0)
+    UpdateParameterBlock(shader);
+
+    // The program keeps the uniform values, another material overwrote all of them, this one only the changed ones.
+    // The values in the parameter block have no location and are skipped.
+    bool sameMaterial = shader->GetLastMaterialID() == m_MaterialID;
+    uint32_t uploadedVersion = sameMaterial ? shader->GetLastMaterialVersion() : 0;
+    if (!sameMaterial || uploadedVersion != m_Version)
     {
-        for (auto &pair : m_UniformVec4)
+        for (const UniformValue &uniform : m_Uniforms)
         {
-            m_Shader->SetUniformVector(pair.first, pair.second);
+            if (uniform.Version <= uploadedVersion)
+            {
+                continue;
+            }
+
+            if (uniform.IsFloat)
+            {
+                shader->SetUniformFloat(uniform.PropertyID, uniform.Value.x);
+            }
+            else
+            {
+                shader->SetUniformVector(uniform.PropertyID, uniform.Value);
+            }
         }
+        shader->SetLastMaterial(m_MaterialID, m_Version);
     }
 
-    if (m_UniformFloats.size() > 0)
+    // The sampler units are set once by the shader, the textures it does not sample are not bound.
+    // Texture::Bind skips the textures which are still bound to their unit.
+    for (const TextureValue<Texture2D> &texture : m_Textures)
+    {
+        int unit = shader->GetSamplerUnit(texture.PropertyID);
+        if (unit >= 0)
+        {
+            texture.Texture->Bind(unit);
+        }
+    }
+    for (const TextureValue<TextureCube> &texture : m_TextureCubes)
     {
-        for (auto &pair : m_UniformFloats)
+        int unit = shader->GetSamplerUnit(texture.PropertyID);
+        if (unit >= 0)
         {
-            m_Shader->SetUniformFloat(pair.first, pair.second);
+            texture.Texture->Bind(unit);
         }
     }
+}
+
+void Material::BindParameterBlock()
+{
+    UpdateParameterBlock(GetShader().get());
+}
+
+bool Material::UpdateParameterBlock(Shader *shader)
+{
+    uint32_t size = static_cast<uint32_t>(shader->GetParameterBlockSize());
+    if (size == 0 || m_Uniforms.empty())
+    {
+        return false;
+    }
 
-    if (m_Textures.size() > 0 || m_TextureCubes.size() > 0)
+    // The variants share the declaration of the block, the size only changes if another program declares it differently
+    if (m_ParameterData.size() != size || m_ParameterOffset == RangeAllocator::INVALID_OFFSET)
     {
-        int unit = 0;
-        for (auto &pair : m_Textures)
+        MaterialParameterBuffer::Free(m_ParameterOffset, static_cast<uint32_t>(m_ParameterData.size()));
+        m_ParameterOffset = MaterialParameterBuffer::Allocate(size);
+        if (m_ParameterOffset == RangeAllocator::INVALID_OFFSET)
         {
-            m_Shader->SetUniformInt(pair.first, unit);
-            pair.second->Bind(unit);
-            ++unit;
+            m_ParameterData.clear();
+            return false;
         }
-        for (auto &pair : m_TextureCubes)
+        m_ParameterData.assign(size, 0);
+        m_ParameterVersion = m_Version - 1;
+    }
+
+    if (m_ParameterVersion != m_Version)
+    {
+        for (const UniformValue &uniform : m_Uniforms)
         {
-            m_Shader->SetUniformInt(pair.first, unit);
-            pair.second->Bind(unit);
-            ++unit;
+            GLint offset = shader->GetParameterOffset(uniform.PropertyID);
+            size_t valueSize = uniform.IsFloat ? sizeof(float) : sizeof(glm::vec4);
+            if (offset >= 0 && offset + valueSize <= m_ParameterData.size())
+            {
+                std::memcpy(m_ParameterData.data() + offset, &uniform.Value.x, valueSize);
+            }
         }
+        MaterialParameterBuffer::Upload(m_ParameterOffset, size, m_ParameterData.data());
+        m_ParameterVersion = m_Version;
     }
+
+    MaterialParameterBuffer::Bind(m_ParameterOffset, size);
+    return true;
+}
+
+uint32_t Material::GetTextureSetKey()
+{
+    if (m_TextureSetDirty)
+    {
+        // FNV-1a over the texture objects in binding order
+        uint32_t hash = 2166136261u;
+        for (const TextureValue<Texture2D> &texture : m_Textures)
+        {
+            hash = (hash ^ texture.Texture->GetTextureID()) * 16777619u;
+        }
+        for (const TextureValue<TextureCube> &texture : m_TextureCubes)
+        {
+            hash = (hash ^ texture.Texture->GetTextureID()) * 16777619u;
+        }
+        m_TextureSetKey = hash;
+        m_TextureSetDirty = false;
+    }
+    return m_TextureSetKey;
 }
 
 void Material::ClearUniforms()
 {
+    m_TextureSetDirty = true;
     m_Textures.clear();
     m_TextureCubes.clear();
-    m_UniformVec4.clear();
-    m_UniformFloats.clear();
+    m_Uniforms.clear();
+    // The programs may hold values of the cleared properties, the values set again are uploaded as new
+    ++m_Version;
+}
+
+void Material::SetFeature(uint32_t feature, bool enable)
+{
+    uint32_t features = enable ? (m_Features | feature) : (m_Features & ~feature);
+    if (features != m_Features)
+    {
+        m_Features = features;
+        m_Shader = nullptr;
+        m_InstancedShader = nullptr;
+    }
 }
 
 Shader::Ptr Material::GetShader()
 {
+    if (!m_Shader)
+    {
+        m_Shader = m_ShaderVariants->GetVariant(m_Features);
+    }
     return m_Shader;
 }
+
+Shader::Ptr Material::GetInstancedShader()
+{
+    if (!m_InstancedShader)
+    {
+        m_InstancedShader = m_ShaderVariants->GetVariant(m_Features | ShaderFeature::INSTANCING);
+    }
+    return m_InstancedShader;
+}
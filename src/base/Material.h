@@ -1,11 +1,12 @@
 #pragma once
 
 #include <vector>
-#include <map>
+#include <cstdint>
 #include <glm/glm.hpp>
 
 #include "ptr.h"
 #include "base/Shader.h"
+#include "base/ShaderVariants.h"
 #include "base/Texture2D.h"
 #include "base/TextureCube.h"
 
@@ -36,6 +37,11 @@ public:
     void AddOrSetVector(const std::string &propertyName, const glm::vec4 &value);
     void AddOrSetFloat(const std::string &propertyName, const float &value);
 
+    // Return nullptr or the default value if the property is not set
+    Texture2D::Ptr GetTexture(const std::string &propertyName);
+    glm::vec4 GetVector(const std::string &propertyName, const glm::vec4 &defaultValue);
+    float GetFloat(const std::string &propertyName, const float &defaultValue);
+
     void SetMatrix(const std::string &propertyName, const glm::mat3x3 &value);
     void SetMatrix(const std::string &propertyName, const glm::mat4x4& value);
 
@@ -50,23 +56,80 @@ public:
     void SetCastShadows(bool cast);
     bool GetMaterialCastShadows();
 
-    void Use();
+    // The instanced variant of the shader reads the model matrices from per-instance attributes.
+    // The values in the MaterialParameters block of the program are packed in the parameter block of the material,
+    // which is bound as a whole. For the other values, only those changed since the program last used this material are uploaded.
+    void Use(bool instanced = false);
+    // Bind the parameter block for another program reading the same MaterialParameters block, e.g. the depth pre-pass
+    void BindParameterBlock();
     
     void ClearUniforms();
+
+    // ShaderFeature bits selecting the variant of the shader, changing them switches to another program
+    void SetFeature(uint32_t feature, bool enable);
+    bool HasFeature(uint32_t feature) const { return (m_Features & feature) != 0; }
+    uint32_t GetFeatures() const { return m_Features; }
     
+    // The variant of the current features, compiled on first use
     Shader::Ptr GetShader();
+    // The same variant with the INSTANCING feature
+    Shader::Ptr GetInstancedShader();
+
+    // Unique id of the material, used in the sort key of the draws
+    uint32_t GetMaterialID() const { return m_MaterialID; }
+    // Hash of the bound texture objects, materials sharing all their textures have the same key
+    uint32_t GetTextureSetKey();
 
 private:
+    ShaderVariantCache::Ptr m_ShaderVariants;
+    uint32_t m_Features;
+    // Variants of the current features, resolved again after a feature changes
     Shader::Ptr m_Shader;
+    Shader::Ptr m_InstancedShader;
 
-    std::map<std::string, Texture2D::Ptr> m_Textures;
-    std::map<std::string, TextureCube::Ptr> m_TextureCubes;
-    std::map<std::string, glm::vec4> m_UniformVec4;
-    std::map<std::string, float> m_UniformFloats;
+    struct UniformValue
+    {
+        int PropertyID;
+        glm::vec4 Value;        // A float is stored in x
+        bool IsFloat;
+        uint32_t Version;       // m_Version when the value last changed
+    };
+
+    template<typename T>
+    struct TextureValue
+    {
+        int PropertyID;
+        typename T::Ptr Texture;
+    };
+
+    // Value of the property, inserted if it is not set yet
+    UniformValue& GetOrAddUniform(int propertyID, bool isFloat);
+    const UniformValue* FindUniform(int propertyID) const;
+    // Allocate, pack and bind the parameter block with the layout of the program, returns false if the program has no block
+    bool UpdateParameterBlock(Shader *shader);
+
+    // Flat arrays sorted by the property ids
+    std::vector<UniformValue> m_Uniforms;
+    std::vector<TextureValue<Texture2D>> m_Textures;
+    std::vector<TextureValue<TextureCube>> m_TextureCubes;
+    // Incremented by every change of a value, the programs remember the version they last uploaded
+    uint32_t m_Version;
+
+    // Range of the material in MaterialParameterBuffer and the packed values of the range
+    uint32_t m_ParameterOffset;
+    std::vector<uint8_t> m_ParameterData;
+    // m_Version when the block was last packed
+    uint32_t m_ParameterVersion;
 
     bool m_UsedForSkybox;
     bool m_CastShadows;
     
     RenderFace m_RenderFace;
     AlphaMode m_AlphaMode;
+
+    uint32_t m_MaterialID;
+    uint32_t m_TextureSetKey;
+    bool m_TextureSetDirty;
+
+    static uint32_t s_NextMaterialID;
 };
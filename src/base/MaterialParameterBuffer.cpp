@@ -0,0 +1,99 @@
+#include "base/MaterialParameterBuffer.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "utility/StatusRecorder.h"
+
+GLuint MaterialParameterBuffer::s_BufferID = 0;
+RangeAllocator MaterialParameterBuffer::s_Allocator;
+uint32_t MaterialParameterBuffer::s_OffsetAlignment = 0;
+uint32_t MaterialParameterBuffer::s_BlockCount = 0;
+uint32_t MaterialParameterBuffer::s_BoundOffset = RangeAllocator::INVALID_OFFSET;
+uint32_t MaterialParameterBuffer::s_BoundSize = 0;
+
+uint32_t MaterialParameterBuffer::Allocate(uint32_t size)
+{
+    if (s_BufferID == 0)
+    {
+        GLint alignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        s_OffsetAlignment = alignment > 0 ? static_cast<uint32_t>(alignment) : 256;
+
+        glGenBuffers(1, &s_BufferID);
+        glBindBuffer(GL_UNIFORM_BUFFER, s_BufferID);
+        glBufferData(GL_UNIFORM_BUFFER, DEFAULT_CAPACITY, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        s_Allocator.Reset(DEFAULT_CAPACITY);
+    }
+
+    uint32_t offset = s_Allocator.Allocate(size, s_OffsetAlignment);
+    if (offset == RangeAllocator::INVALID_OFFSET)
+    {
+        Grow(std::max(s_Allocator.GetCapacity() * 2, s_Allocator.GetCapacity() + size + s_OffsetAlignment));
+        offset = s_Allocator.Allocate(size, s_OffsetAlignment);
+        if (offset == RangeAllocator::INVALID_OFFSET)
+        {
+            std::cerr << "Failed to allocate a material parameter block of " << size << " bytes" << std::endl;
+            return offset;
+        }
+    }
+
+    s_BlockCount++;
+    return offset;
+}
+
+void MaterialParameterBuffer::Free(uint32_t offset, uint32_t size)
+{
+    if (offset == RangeAllocator::INVALID_OFFSET)
+    {
+        return;
+    }
+
+    s_Allocator.Free(offset, size);
+    s_BlockCount--;
+    if (s_BoundOffset == offset)
+    {
+        s_BoundOffset = RangeAllocator::INVALID_OFFSET;
+    }
+}
+
+void MaterialParameterBuffer::Upload(uint32_t offset, uint32_t size, const void *data)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, s_BufferID);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void MaterialParameterBuffer::Bind(uint32_t offset, uint32_t size)
+{
+    if (s_BoundOffset == offset && s_BoundSize == size)
+    {
+        return;
+    }
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, s_BufferID, offset, size);
+    s_BoundOffset = offset;
+    s_BoundSize = size;
+    StatusRecorder::UniformBufferBinds++;
+}
+
+void MaterialParameterBuffer::Grow(uint32_t capacity)
+{
+    // The blocks keep their offsets, the content is copied to the new storage
+    GLuint newBufferID = 0;
+    glGenBuffers(1, &newBufferID);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newBufferID);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, s_BufferID);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, s_Allocator.GetCapacity());
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glDeleteBuffers(1, &s_BufferID);
+    s_BufferID = newBufferID;
+    s_Allocator.Grow(capacity);
+
+    // The binding point referenced the deleted buffer
+    s_BoundOffset = RangeAllocator::INVALID_OFFSET;
+}
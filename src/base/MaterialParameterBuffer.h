@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h>
+
+#include "utility/RangeAllocator.h"
+
+// One uniform buffer holding the parameter blocks (the MaterialParameters std140 block of the shaders) of all the materials.
+// Each material owns a range aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, switching materials binds another range
+// to the MaterialParameters binding point instead of setting the parameters as separate uniforms.
+// The buffer grows when it is full, the offsets of the blocks do not change.
+class MaterialParameterBuffer
+{
+public:
+    static constexpr GLuint BINDING = 1;
+    static constexpr uint32_t DEFAULT_CAPACITY = 64 * 1024;
+
+    // Returns RangeAllocator::INVALID_OFFSET if the buffer cannot be created
+    static uint32_t Allocate(uint32_t size);
+    static void Free(uint32_t offset, uint32_t size);
+
+    static void Upload(uint32_t offset, uint32_t size, const void *data);
+    // Bind the range to the MaterialParameters binding point, nothing is done if it is already bound
+    static void Bind(uint32_t offset, uint32_t size);
+
+    static uint32_t GetBlockCount() { return s_BlockCount; }
+    static uint32_t GetUsedSize() { return s_Allocator.GetUsedSize(); }
+    static uint32_t GetCapacity() { return s_Allocator.GetCapacity(); }
+
+private:
+    static void Grow(uint32_t capacity);
+
+    static GLuint s_BufferID;
+    static RangeAllocator s_Allocator;
+    static uint32_t s_OffsetAlignment;
+    static uint32_t s_BlockCount;
+    static uint32_t s_BoundOffset;
+    static uint32_t s_BoundSize;
+};
@@ -2,22 +2,50 @@
 
 #include <vector>
 
+#include "base/MaterialParameterBuffer.h"
+#include "utility/StatusRecorder.h"
+
+GLuint Shader::s_CurrentProgram = 0;
+std::unordered_map<std::string, int> Shader::s_PropertyIDs;
+
 Shader::Shader(const std::string &name, const std::string &vsSource, const std::string &fsSource)
-    : m_ShaderID(0)
+    : m_ShaderID(0), m_Linked(false), m_ParameterBlockSize(0), m_LastMaterialID(0), m_LastMaterialVersion(0)
 {
     m_ShaderName = name;
     CreateShadersAndCompile(vsSource, fsSource);
 }
 
+Shader::Shader(const std::string &name, GLuint programID)
+    : m_ShaderID(programID), m_Linked(true), m_ParameterBlockSize(0), m_LastMaterialID(0), m_LastMaterialVersion(0)
+{
+    m_ShaderName = name;
+    SetupLinkedProgram();
+}
+
 Shader::~Shader()
 {
+    if (s_CurrentProgram == m_ShaderID)
+    {
+        s_CurrentProgram = 0;
+    }
     glDeleteProgram(m_ShaderID);
     m_ShaderID = 0;
 }
 
 void Shader::Use()
 {
-    glUseProgram(m_ShaderID);
+    if (s_CurrentProgram != m_ShaderID)
+    {
+        glUseProgram(m_ShaderID);
+        s_CurrentProgram = m_ShaderID;
+        StatusRecorder::ProgramSwitches++;
+    }
+}
+
+int Shader::PropertyToID(const std::string &uniformName)
+{
+    auto result = s_PropertyIDs.emplace(uniformName, static_cast<int>(s_PropertyIDs.size()));
+    return result.first->second;
 }
 
 void Shader::SetUniformInt(const std::string &uniformName, const int &value)
@@ -55,9 +83,62 @@ void Shader::SetUniformVectorArray(const std::string &uniformName, size_t size,
     glUniform4fv(GetUniformLocation(uniformName), static_cast<GLsizei>(size), (float*)(&values[0].x));
 }
 
-GLuint Shader::GetUniformLocation(const std::string &uniformName)
+void Shader::SetUniformFloat(int propertyID, const float &value)
+{
+    GLint location = GetUniformLocation(propertyID);
+    if (location >= 0)
+    {
+        glUniform1f(location, value);
+        StatusRecorder::UniformUploads++;
+    }
+}
+
+void Shader::SetUniformVector(int propertyID, const glm::vec4 &value)
 {
-    return glGetUniformLocation(m_ShaderID, uniformName.c_str());
+    GLint location = GetUniformLocation(propertyID);
+    if (location >= 0)
+    {
+        glUniform4fv(location, 1, &value[0]);
+        StatusRecorder::UniformUploads++;
+    }
+}
+
+void Shader::SetUniformMatrix(int propertyID, const glm::mat3x3 &value)
+{
+    GLint location = GetUniformLocation(propertyID);
+    if (location >= 0)
+    {
+        glUniformMatrix3fv(location, 1, GL_FALSE, &(value[0].x));
+        StatusRecorder::UniformUploads++;
+    }
+}
+
+void Shader::SetUniformMatrix(int propertyID, const glm::mat4x4 &value)
+{
+    GLint location = GetUniformLocation(propertyID);
+    if (location >= 0)
+    {
+        glUniformMatrix4fv(location, 1, GL_FALSE, &(value[0].x));
+        StatusRecorder::UniformUploads++;
+    }
+}
+
+GLint Shader::GetUniformLocation(const std::string &uniformName)
+{
+    // Every uniform of the program got an id when it was linked, an unknown name is not used by the program
+    auto iter = s_PropertyIDs.find(uniformName);
+    return iter != s_PropertyIDs.end() ? GetUniformLocation(iter->second) : -1;
+}
+
+GLint Shader::GetUniformLocation(int propertyID) const
+{
+    return propertyID >= 0 && propertyID < static_cast<int>(m_UniformLocations.size()) ? m_UniformLocations[propertyID] : -1;
+}
+
+void Shader::SetLastMaterial(uint32_t materialID, uint32_t version)
+{
+    m_LastMaterialID = materialID;
+    m_LastMaterialVersion = version;
 }
 
 std::string& Shader::GetName()
@@ -101,9 +182,12 @@ void Shader::CreateShadersAndCompile(const std::string &vsSource, const std::str
 
     glAttachShader(m_ShaderID, vsID);
     glAttachShader(m_ShaderID, fsID);
+    // Allow the linked binary to be saved to the shader binary cache
+    glProgramParameteri(m_ShaderID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(m_ShaderID);
 
     glGetProgramiv(m_ShaderID, GL_LINK_STATUS, &success);
+    m_Linked = success != GL_FALSE;
     if (success == GL_FALSE)
     {
         GLint logLength = 0;
@@ -116,10 +200,131 @@ void Shader::CreateShadersAndCompile(const std::string &vsSource, const std::str
     glDeleteShader(vsID);
     glDeleteShader(fsID);
 
+    SetupLinkedProgram();
+}
+
+void Shader::SetupLinkedProgram()
+{
     // Set global uniform to binding point 0 for each shader
     GLuint uniformBlockIndex = glGetUniformBlockIndex(m_ShaderID, "GlobalUniforms");
     if (uniformBlockIndex != GL_INVALID_INDEX)
     {
         glUniformBlockBinding(m_ShaderID, uniformBlockIndex, 0);
     }
+
+    // Per-draw uniforms to binding point 2, see DrawUniformBuffer
+    uniformBlockIndex = glGetUniformBlockIndex(m_ShaderID, "DrawUniforms");
+    if (uniformBlockIndex != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(m_ShaderID, uniformBlockIndex, 2);
+    }
+
+    QueryUniforms();
+
+    uniformBlockIndex = glGetUniformBlockIndex(m_ShaderID, "MaterialParameters");
+    if (uniformBlockIndex != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(m_ShaderID, uniformBlockIndex, MaterialParameterBuffer::BINDING);
+        QueryParameterBlock(uniformBlockIndex);
+    }
+}
+
+GLint Shader::GetParameterOffset(int propertyID) const
+{
+    return propertyID >= 0 && propertyID < static_cast<int>(m_ParameterOffsets.size()) ? m_ParameterOffsets[propertyID] : -1;
+}
+
+int Shader::GetSamplerUnit(const std::string &samplerName)
+{
+    auto iter = s_PropertyIDs.find(samplerName);
+    return iter != s_PropertyIDs.end() ? GetSamplerUnit(iter->second) : -1;
+}
+
+int Shader::GetSamplerUnit(int propertyID) const
+{
+    return propertyID >= 0 && propertyID < static_cast<int>(m_SamplerUnits.size()) ? m_SamplerUnits[propertyID] : -1;
+}
+
+void Shader::QueryUniforms()
+{
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(m_ShaderID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(m_ShaderID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    if (uniformCount <= 0)
+    {
+        return;
+    }
+
+    std::vector<GLchar> nameBuffer(maxNameLength > 0 ? maxNameLength : 1);
+    int unit = 0;
+    for (GLint i = 0; i < uniformCount; ++i)
+    {
+        GLint size = 0;
+        GLenum type = GL_NONE;
+        glGetActiveUniform(m_ShaderID, static_cast<GLuint>(i), static_cast<GLsizei>(nameBuffer.size()), nullptr, &size, &type, nameBuffer.data());
+
+        // The members of the uniform blocks have no location
+        GLint location = glGetUniformLocation(m_ShaderID, nameBuffer.data());
+        if (location < 0)
+        {
+            continue;
+        }
+
+        // Arrays are reported as "name[0]", they are set by their name
+        std::string name = nameBuffer.data();
+        size_t bracket = name.find('[');
+        if (bracket != std::string::npos)
+        {
+            name.resize(bracket);
+        }
+
+        int id = PropertyToID(name);
+        if (id >= static_cast<int>(m_UniformLocations.size()))
+        {
+            m_UniformLocations.resize(id + 1, -1);
+            m_SamplerUnits.resize(id + 1, -1);
+        }
+        m_UniformLocations[id] = location;
+
+        if (type == GL_SAMPLER_2D || type == GL_SAMPLER_2D_SHADOW || type == GL_SAMPLER_CUBE)
+        {
+            Use();
+            glUniform1i(location, unit);
+            m_SamplerUnits[id] = unit;
+            ++unit;
+        }
+    }
+}
+
+void Shader::QueryParameterBlock(GLuint blockIndex)
+{
+    GLint memberCount = 0;
+    glGetActiveUniformBlockiv(m_ShaderID, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &m_ParameterBlockSize);
+    glGetActiveUniformBlockiv(m_ShaderID, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &memberCount);
+    if (memberCount <= 0)
+    {
+        return;
+    }
+
+    std::vector<GLint> memberIndices(memberCount);
+    glGetActiveUniformBlockiv(m_ShaderID, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, memberIndices.data());
+    std::vector<GLuint> indices(memberIndices.begin(), memberIndices.end());
+    std::vector<GLint> offsets(memberCount);
+    glGetActiveUniformsiv(m_ShaderID, memberCount, indices.data(), GL_UNIFORM_OFFSET, offsets.data());
+
+    GLint maxNameLength = 0;
+    glGetProgramiv(m_ShaderID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::vector<GLchar> nameBuffer(maxNameLength > 0 ? maxNameLength : 1);
+    for (GLint i = 0; i < memberCount; ++i)
+    {
+        // The block has no instance name, the members are named like the loose uniforms they replace
+        glGetActiveUniformName(m_ShaderID, indices[i], static_cast<GLsizei>(nameBuffer.size()), nullptr, nameBuffer.data());
+        int id = PropertyToID(nameBuffer.data());
+        if (id >= static_cast<int>(m_ParameterOffsets.size()))
+        {
+            m_ParameterOffsets.resize(id + 1, -1);
+        }
+        m_ParameterOffsets[id] = offsets[i];
+    }
 }
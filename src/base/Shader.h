@@ -2,6 +2,9 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -13,10 +16,16 @@ class Shader
     SHARED_PTR(Shader)
 public:
     Shader(const std::string &name, const std::string &vsSource, const std::string &fsSource);
+    // Take the ownership of a program which is already linked, e.g. loaded from a binary
+    Shader(const std::string &name, GLuint programID);
     ~Shader();
 
     void Use();
 
+    // Global id of a uniform name, the same in every program. The ids index the location tables of the programs
+    // and the property arrays of the materials, resolve them once instead of passing the names per draw.
+    static int PropertyToID(const std::string &uniformName);
+
     void SetUniformInt(const std::string &uniformName, const int &value);
     void SetUniformFloat(const std::string &uniformName, const float &value);
     void SetUniformVector(const std::string &uniformName, const glm::vec3 &value);
@@ -24,13 +33,55 @@ public:
     void SetUniformMatrix(const std::string &uniformName, const glm::mat3x3 &value);
     void SetUniformMatrix(const std::string &uniformName, const glm::mat4x4 &value);
     void SetUniformVectorArray(const std::string &uniformName, size_t size, const std::vector<glm::vec4> &values);
+    void SetUniformFloat(int propertyID, const float &value);
+    void SetUniformVector(int propertyID, const glm::vec4 &value);
+    void SetUniformMatrix(int propertyID, const glm::mat3x3 &value);
+    void SetUniformMatrix(int propertyID, const glm::mat4x4 &value);
     
     std::string& GetName();
+    GLuint GetProgramID() { return m_ShaderID; }
+    bool IsLinked() { return m_Linked; }
+
+    // Texture unit of a sampler uniform, fixed when the program is linked, or -1 if the program does not use it.
+    // The units do not depend on the textures a material sets, so the materials sharing the program never leave a stale unit in it.
+    int GetSamplerUnit(const std::string &samplerName);
+    int GetSamplerUnit(int propertyID) const;
+    // Location of a uniform outside the uniform blocks, or -1 if the program does not use it
+    GLint GetUniformLocation(int propertyID) const;
+
+    // Size of the MaterialParameters block in bytes, 0 if the program does not use it
+    GLint GetParameterBlockSize() const { return m_ParameterBlockSize; }
+    // Byte offset of a member of the MaterialParameters block, or -1 if it is not in the block
+    GLint GetParameterOffset(int propertyID) const;
+
+    // The material whose values the program holds and the version of the material when they were uploaded,
+    // Material::Use only uploads the values changed since, or all of them for another material
+    uint32_t GetLastMaterialID() const { return m_LastMaterialID; }
+    uint32_t GetLastMaterialVersion() const { return m_LastMaterialVersion; }
+    void SetLastMaterial(uint32_t materialID, uint32_t version);
 
 private:
     void CreateShadersAndCompile(const std::string &vsSource, const std::string &fsSource);
-    GLuint GetUniformLocation(const std::string &uniformName);
+    GLint GetUniformLocation(const std::string &uniformName);
+    // Bind the uniform blocks, resolve the uniform locations and set the sampler units of the linked program
+    void SetupLinkedProgram();
+    void QueryUniforms();
+    void QueryParameterBlock(GLuint blockIndex);
 
     GLuint m_ShaderID;
+    bool m_Linked;
     std::string m_ShaderName;
+    // Indexed by the property ids, -1 for the uniforms the program does not use
+    std::vector<GLint> m_UniformLocations;
+    std::vector<int> m_SamplerUnits;
+    std::vector<GLint> m_ParameterOffsets;
+    GLint m_ParameterBlockSize;
+
+    uint32_t m_LastMaterialID;
+    uint32_t m_LastMaterialVersion;
+
+    static std::unordered_map<std::string, int> s_PropertyIDs;
+
+    // Program currently in use, glUseProgram is skipped if it does not change
+    static GLuint s_CurrentProgram;
 };
@@ -0,0 +1,116 @@
+#include "base/ShaderVariants.h"
+
+#include <cctype>
+
+#include "loader/AssetsLoader.h"
+#include "loader/ShaderSourceDatabase.h"
+
+std::map<std::string, ShaderVariantCache::Ptr> ShaderVariantCache::s_Caches;
+
+namespace ShaderFeature
+{
+    static const char* const s_DefineNames[COUNT] =
+    {
+        "BASE_MAP",
+        "NORMAL_MAP",
+        "EMISSIVE_MAP",
+        "METALLIC_ROUGHNESS_MAP",
+        "OCCLUSION_MAP",
+        "ALPHA_TEST",
+        "ALPHA_BLEND",
+        "SHADOW_MAP",
+        "SSAO",
+        "BLOOM",
+        "FXAA",
+        "TONE_MAPPING",
+        "INSTANCING",
+    };
+
+    std::vector<std::string> GetDefines(uint32_t features)
+    {
+        std::vector<std::string> defines;
+        for (uint32_t bit = 0; bit < COUNT; ++bit)
+        {
+            if (features & (1u << bit))
+            {
+                defines.push_back(s_DefineNames[bit]);
+            }
+        }
+        return defines;
+    }
+} // namespace ShaderFeature
+
+ShaderVariantCache::ShaderVariantCache(const std::string &name, const std::string &vsPath, const std::string &fsPath)
+    : m_Name(name), m_VSPath(vsPath), m_FSPath(fsPath), m_UsedFeatures(0)
+{
+    const ShaderSourceDatabase::StageSource &vsStage = ShaderSourceDatabase::GetStage(vsPath);
+    const ShaderSourceDatabase::StageSource &fsStage = ShaderSourceDatabase::GetStage(fsPath);
+
+    // Any whole-word use of the define name counts, e.g. #ifdef NAME or defined(NAME)
+    std::vector<std::string> names = ShaderFeature::GetDefines(~0u);
+    for (uint32_t bit = 0; bit < names.size(); ++bit)
+    {
+        if (ContainsWord(vsStage.Source, names[bit]) || ContainsWord(fsStage.Source, names[bit]))
+        {
+            m_UsedFeatures |= 1u << bit;
+        }
+    }
+}
+
+ShaderVariantCache::Ptr ShaderVariantCache::Get(const std::string &name, const std::string &vsPath, const std::string &fsPath)
+{
+    std::string key = vsPath + "|" + fsPath;
+    auto iter = s_Caches.find(key);
+    if (iter != s_Caches.end())
+    {
+        return iter->second;
+    }
+
+    ShaderVariantCache::Ptr cache = ShaderVariantCache::New(name, vsPath, fsPath);
+    s_Caches[key] = cache;
+    return cache;
+}
+
+Shader::Ptr ShaderVariantCache::GetVariant(uint32_t features)
+{
+    features &= m_UsedFeatures;
+    auto iter = m_Variants.find(features);
+    if (iter != m_Variants.end())
+    {
+        return iter->second;
+    }
+
+    Shader::Ptr shader = AssetsLoader::LoadShader(m_Name, m_VSPath, m_FSPath, ShaderFeature::GetDefines(features));
+    m_Variants[features] = shader;
+    return shader;
+}
+
+bool ShaderVariantCache::ContainsWord(const std::string &source, const std::string &word)
+{
+    auto isIdentifierChar = [](char c)
+    {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    };
+
+    size_t pos = source.find(word);
+    while (pos != std::string::npos)
+    {
+        size_t end = pos + word.length();
+        if ((pos == 0 || !isIdentifierChar(source[pos - 1])) && (end == source.length() || !isIdentifierChar(source[end])))
+        {
+            return true;
+        }
+        pos = source.find(word, pos + 1);
+    }
+    return false;
+}
+
+size_t ShaderVariantCache::GetTotalVariantCount()
+{
+    size_t count = 0;
+    for (auto &pair : s_Caches)
+    {
+        count += pair.second->GetVariantCount();
+    }
+    return count;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "ptr.h"
+#include "base/Shader.h"
+
+// Features compiled into the shader variants instead of branching on uniforms, each bit is a #define of the same name
+namespace ShaderFeature
+{
+    enum : uint32_t
+    {
+        NONE = 0,
+        // Material
+        BASE_MAP = 1 << 0,
+        NORMAL_MAP = 1 << 1,
+        EMISSIVE_MAP = 1 << 2,
+        METALLIC_ROUGHNESS_MAP = 1 << 3,
+        OCCLUSION_MAP = 1 << 4,
+        ALPHA_TEST = 1 << 5,
+        ALPHA_BLEND = 1 << 6,
+        // Lighting
+        SHADOW_MAP = 1 << 7,
+        SSAO = 1 << 8,
+        // Post-processing
+        BLOOM = 1 << 9,
+        FXAA = 1 << 10,
+        TONE_MAPPING = 1 << 11,
+        // Vertex input
+        INSTANCING = 1 << 12,
+
+        COUNT = 13
+    };
+
+    // The #define names of the bits set in the mask, in bit order
+    std::vector<std::string> GetDefines(uint32_t features);
+} // namespace ShaderFeature
+
+// The variants of one pair of shader files, compiled the first time a feature mask is asked for.
+// A cache is shared by all the materials using the same files. The features the sources never mention are dropped
+// from the mask, so e.g. the shadow bit set on a G-buffer material does not compile an identical program.
+class ShaderVariantCache
+{
+    SHARED_PTR(ShaderVariantCache)
+public:
+    ShaderVariantCache(const std::string &name, const std::string &vsPath, const std::string &fsPath);
+
+    static ShaderVariantCache::Ptr Get(const std::string &name, const std::string &vsPath, const std::string &fsPath);
+
+    Shader::Ptr GetVariant(uint32_t features);
+    // Mask of the features the sources of the pair test
+    uint32_t GetUsedFeatures() const { return m_UsedFeatures; }
+
+    size_t GetVariantCount() const { return m_Variants.size(); }
+    static size_t GetTotalVariantCount();
+
+private:
+    static bool ContainsWord(const std::string &source, const std::string &word);
+
+    std::string m_Name;
+    std::string m_VSPath;
+    std::string m_FSPath;
+    uint32_t m_UsedFeatures;
+    std::map<uint32_t, Shader::Ptr> m_Variants;
+
+    // Keyed by the pair of paths
+    static std::map<std::string, ShaderVariantCache::Ptr> s_Caches;
+};
@@ -1,11 +1,24 @@
 #include "base/Texture.h"
 
+#include "utility/StatusRecorder.h"
+
+GLuint Texture::s_BoundTextures[MAX_TEXTURE_UNITS] = { 0 };
+int Texture::s_ActiveUnit = 0;
+
 Texture::Texture()
     : m_TextureName(""), m_TextureID(0), m_Size(glm::u32vec2(1)), m_InternalFormat(GL_RGBA), m_Format(GL_RGBA), m_Type(GL_UNSIGNED_BYTE), m_Target(GL_TEXTURE_2D)
 { }
 
 Texture::~Texture()
 {
+    // Deleting a texture unbinds it, and the name may be reused by a new texture
+    for (int i = 0; i < MAX_TEXTURE_UNITS; ++i)
+    {
+        if (s_BoundTextures[i] == m_TextureID)
+        {
+            s_BoundTextures[i] = 0;
+        }
+    }
     glDeleteTextures(1, &m_TextureID);
     m_TextureID = 0;
 }
@@ -14,12 +27,32 @@ void Texture::Bind(const int &unit)
 {
     if (unit >= 0)
     {
-        glActiveTexture(GL_TEXTURE0 + unit);
+        if (unit < MAX_TEXTURE_UNITS && s_BoundTextures[unit] == m_TextureID)
+        {
+            return;
+        }
+
+        if (unit != s_ActiveUnit)
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            s_ActiveUnit = unit;
+        }
     }
     glBindTexture(m_Target, m_TextureID);
+    StatusRecorder::TextureBinds++;
+
+    if (s_ActiveUnit < MAX_TEXTURE_UNITS)
+    {
+        s_BoundTextures[s_ActiveUnit] = m_TextureID;
+    }
 }
 
 void Texture::Unbind()
 {
     glBindTexture(m_Target, 0);
+
+    if (s_ActiveUnit < MAX_TEXTURE_UNITS)
+    {
+        s_BoundTextures[s_ActiveUnit] = 0;
+    }
 }
\ No newline at end of file
@@ -19,12 +19,20 @@ public:
     GLuint& GetTextureID() { return m_TextureID; }
     glm::u32vec2& GetSize() { return m_Size; }
 
+    // Binding to a unit is skipped if the texture is already bound there, -1 binds to the active unit
     void Bind(const int &unit = -1);
     void Unbind();
 
+    static constexpr int MAX_TEXTURE_UNITS = 32;
+
 protected:
     std::string m_TextureName;
     GLuint m_TextureID;
     GLenum m_InternalFormat, m_Format, m_Type, m_Target;
     glm::u32vec2 m_Size;
+
+private:
+    // Last texture bound to each unit and the active unit, all the texture bindings must go through Bind() and Unbind()
+    static GLuint s_BoundTextures[MAX_TEXTURE_UNITS];
+    static int s_ActiveUnit;
 };
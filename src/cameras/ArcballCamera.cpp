@@ -12,7 +12,7 @@ void ArcballCamera::Zooming(const float &yoffset)
     {
         m_Fov -= yoffset * CAMERA_ZOOMING_SPEED;
         m_Fov = glm::clamp(m_Fov, glm::radians(1.0f), glm::radians(90.0f));
-        m_Projection = glm::perspective(m_Fov, m_Aspect, m_ZNear, m_ZFar);
+        SetProjection(glm::perspective(m_Fov, m_Aspect, m_ZNear, m_ZFar));
     }
 }
 
@@ -7,6 +7,7 @@ Camera::Camera(const glm::vec3 &eye, const glm::vec3 &lookAt, const glm::vec3 &u
 {
     m_IsPerspective = true;
     m_Projection = glm::mat4(1.0f);
+    m_InverseProjection = glm::mat4(1.0f);
     m_View = glm::mat4(1.0f);
     m_ScreenSize = glm::u32vec2(1);
     m_Fov = 60.0f;
@@ -26,7 +27,7 @@ void Camera::SetPerspective(const float &fov, const int &width, const int &heigh
     m_ZNear = zNear;
     m_ZFar = zFar;
     
-    m_Projection = glm::perspective(m_Fov, m_Aspect, m_ZNear, m_ZFar);
+    SetProjection(glm::perspective(m_Fov, m_Aspect, m_ZNear, m_ZFar));
 }
 
 void Camera::SetOrthographic(const float &left, const float &right, const float &bottom, const float &top, const float &zNear, const float &zFar)
@@ -36,7 +37,7 @@ void Camera::SetOrthographic(const float &left, const float &right, const float
     m_ZNear = zNear;
     m_ZFar = zFar;
     
-    m_Projection = glm::ortho(left, right, bottom, top, zNear, zFar);
+    SetProjection(glm::ortho(left, right, bottom, top, zNear, zFar));
 }
 
 void Camera::SetScreenSize(const int &width, const int &height)
@@ -47,7 +48,7 @@ void Camera::SetScreenSize(const int &width, const int &height)
     if (m_IsPerspective)
     {
         m_Aspect = static_cast<float>(width) / height;
-        m_Projection = glm::perspective(m_Fov, m_Aspect, m_ZNear, m_ZFar);
+        SetProjection(glm::perspective(m_Fov, m_Aspect, m_ZNear, m_ZFar));
     }
 }
 
@@ -66,6 +67,17 @@ glm::mat4& Camera::GetProjectionMatrix()
     return m_Projection;
 }
 
+glm::mat4& Camera::GetInverseProjectionMatrix()
+{
+    return m_InverseProjection;
+}
+
+void Camera::SetProjection(const glm::mat4 &projection)
+{
+    m_Projection = projection;
+    m_InverseProjection = glm::inverse(projection);
+}
+
 glm::vec3& Camera::GetEyePosition()
 {
     return m_EyePosition;
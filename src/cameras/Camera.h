@@ -19,6 +19,8 @@ public:
     
     glm::mat4& GetViewMatrix();
     glm::mat4& GetProjectionMatrix();
+    // Computed when the projection changes
+    glm::mat4& GetInverseProjectionMatrix();
     glm::vec3& GetEyePosition();
     float& GetNear();
     float& GetFar();
@@ -30,8 +32,11 @@ public:
     virtual void Arcballing(const float &xoffset, const float &yoffset) {}
 
 protected:
+    void SetProjection(const glm::mat4 &projection);
+
     bool m_IsPerspective;
     glm::mat4 m_Projection, m_View;
+    glm::mat4 m_InverseProjection;
     glm::vec3 m_EyePosition, m_LookAt, m_UpVector;
     glm::u32vec2 m_ScreenSize;
     float m_Fov, m_Aspect, m_ZNear, m_ZFar;
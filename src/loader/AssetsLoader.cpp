@@ -1,6 +1,7 @@
 #include "loader/AssetsLoader.h"
 
 #include <fstream>
+#include <chrono>
 #include <stb_image.h>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -13,33 +14,66 @@
 #include "utility/Collision.h"
 
 #include "utility/StatusRecorder.h"
+#include "utility/Hash.h"
+
+#include "loader/ShaderBinaryCache.h"
+#include "loader/ShaderSourceDatabase.h"
 
 using namespace Collision;
 
 std::map<std::string, Texture2D::Ptr> AssetsLoader::assimpTextures = {};
+std::map<unsigned int, Material::Ptr> AssetsLoader::assimpMaterials = {};
+std::map<uint64_t, Shader::Ptr> AssetsLoader::shaderPrograms = {};
 
-Shader::Ptr AssetsLoader::LoadShader(const std::string &name, const std::string &vsFilePath, const std::string &fsFilePath)
+Shader::Ptr AssetsLoader::LoadShader(const std::string &name, const std::string &vsFilePath, const std::string &fsFilePath, const std::vector<std::string> &defines)
 {
-    std::string vsPath = GetShaderPath() + vsFilePath;
-    std::string fsPath = GetShaderPath() + fsFilePath;
-
-    std::ifstream vsFile, fsFile;
-    vsFile.open(vsPath);
-    fsFile.open(fsPath);
-
-    if (!vsFile.is_open() || !fsFile.is_open())
+    const ShaderSourceDatabase::StageSource &vsStage = ShaderSourceDatabase::GetStage(vsFilePath, defines);
+    const ShaderSourceDatabase::StageSource &fsStage = ShaderSourceDatabase::GetStage(fsFilePath, defines);
+    if (!vsStage.Valid || !fsStage.Valid)
     {
-        std::cerr << "Failed to load shader, path: " + vsPath + " and " + fsPath << std::endl;
+        std::cerr << "Failed to load shader, path: " + GetShaderPath() + vsFilePath + " and " + GetShaderPath() + fsFilePath << std::endl;
         return nullptr;
     }
 
-    std::string vsSource = ReadShader(vsFile, name);
-    std::string fsSource = ReadShader(fsFile, name);
+    // The defines are part of the sources, so each variant of a pair of files is one program
+    uint64_t key = Hash::FNV1a64(&fsStage.Hash, sizeof(fsStage.Hash), Hash::FNV1a64(&vsStage.Hash, sizeof(vsStage.Hash)));
+    auto iter = shaderPrograms.find(key);
+    if (iter != shaderPrograms.end())
+    {
+        StatusRecorder::ShaderCacheHits++;
+        return iter->second;
+    }
+
+    StatusRecorder::ShaderCacheMisses++;
 
-    vsFile.close();
-    fsFile.close();
+    auto compileStart = std::chrono::high_resolution_clock::now();
+    Shader::Ptr shader;
+    uint64_t binaryKey = ShaderBinaryCache::MakeKey(key);
+    GLuint programID = ShaderBinaryCache::LoadProgram(binaryKey);
+    if (programID != 0)
+    {
+        shader = Shader::New(name, programID);
+        StatusRecorder::ShaderBinaryCacheHits++;
+    }
+    else
+    {
+        shader = Shader::New(name, vsStage.Source, fsStage.Source);
+        if (shader->IsLinked())
+        {
+            ShaderBinaryCache::SaveProgram(binaryKey, shader->GetProgramID());
+        }
+        else
+        {
+            // The errors are reported as <source string number>(<line>)
+            std::cerr << "Source string numbers of " << name << ":\n" << ShaderSourceDatabase::DescribeFiles(vsStage) << ShaderSourceDatabase::DescribeFiles(fsStage);
+        }
+        StatusRecorder::ShaderCompiles++;
+    }
+    auto compileEnd = std::chrono::high_resolution_clock::now();
 
-    return Shader::New(name, vsSource, fsSource);
+    StatusRecorder::ShaderCompileTime += std::chrono::duration<float, std::milli>(compileEnd - compileStart).count();
+    shaderPrograms[key] = shader;
+    return shader;
 }
 
 Texture2D::Ptr AssetsLoader::LoadTexture(const std::string &textureName, const std::string &filePath, bool useMipmap)
@@ -108,36 +142,6 @@ Texture2D::Ptr AssetsLoader::LoadHDRTexture(const std::string &textureName, cons
     return texture;
 }
 
-std::string AssetsLoader::ReadShader(std::ifstream &file, const std::string &name)
-{
-    std::string source, line;
-    const std::string includeDirective = "#include ";
-    const size_t startPos = includeDirective.length();
-    while (std::getline(file, line))
-    {
-        if (line.substr(0, startPos) == includeDirective)
-        {
-            const size_t pos = startPos + 1;
-            std::string includedPath = GetShaderPath() + line.substr(pos, line.length() - pos - 1);
-            std::ifstream includedFile(includedPath);
-            if (includedFile.is_open())
-            {
-                source += ReadShader(includedFile, name);
-            }
-            else
-            {
-                std::cerr << "Failed to read included file: " << includedPath << " in Shader: " << name << std::endl;
-            }
-            includedFile.close();
-        }
-        else
-        {
-            source += line + "\n";
-        }
-    }
-    return source;
-}
-
 SceneNode::Ptr AssetsLoader::LoadModel(const std::string &filePath, const bool &calculateAABB)
 {
     std::string newPath = GetAssetsPath() + filePath;
@@ -172,16 +176,18 @@ SceneNode::Ptr AssetsLoader::LoadModel(const std::string &filePath, const bool &
     std::string directory = filePath.substr(0, filePath.find_last_of("/"));
 
     AssetsLoader::assimpTextures.clear();
+    AssetsLoader::assimpMaterials.clear();
     return AssetsLoader::ProcessAssimpNode(scene->mRootNode, scene, directory, calculateAABB);
 }
 
 SceneNode::Ptr AssetsLoader::ProcessAssimpNode(aiNode* aNode, const aiScene* aScene, const std::string& directory, const bool &calculateAABB)
 {
     SceneNode::Ptr node = SceneNode::New();
-    node->ModelMatrix = AssetsLoader::aiMatrix4x4ToGlmMat4(aNode->mTransformation);
+    node->SetModelMatrix(AssetsLoader::aiMatrix4x4ToGlmMat4(aNode->mTransformation));
 
     // Bounding box of the node
     BoundingBox nodeAABB;
+    bool hasAABB = false;
     for (size_t i = 0; i < aNode->mNumMeshes; ++i)
     {
         aiMesh* assimpMesh = aScene->mMeshes[aNode->mMeshes[i]];
@@ -190,31 +196,49 @@ SceneNode::Ptr AssetsLoader::ProcessAssimpNode(aiNode* aNode, const aiScene* aSc
         if (numVertices > 0)
         {
             Mesh::Ptr mesh = AssetsLoader::ParseMesh(assimpMesh, aScene);
+            
+            Material::Ptr mat;
+            auto matIter = AssetsLoader::assimpMaterials.find(assimpMesh->mMaterialIndex);
+            if (matIter != AssetsLoader::assimpMaterials.end())
+            {
+                mat = matIter->second;
+            }
+            else
+            {
+                aiMaterial* assimpMat = aScene->mMaterials[assimpMesh->mMaterialIndex];
+                mat = AssetsLoader::ParseMaterial(assimpMat, aScene, directory);
+                AssetsLoader::assimpMaterials.insert(std::make_pair(assimpMesh->mMaterialIndex, mat));
+            }
+
+            MeshRender::Ptr meshRender = MeshRender::New(mesh, mat);
             if (calculateAABB)
             {
                 glm::vec3 min = glm::vec3(assimpMesh->mAABB.mMin.x, assimpMesh->mAABB.mMin.y, assimpMesh->mAABB.mMin.z);
                 glm::vec3 max = glm::vec3(assimpMesh->mAABB.mMax.x, assimpMesh->mAABB.mMax.y, assimpMesh->mAABB.mMax.z);
 
-                if (!node->IsAABBCalculated)
+                // Bounds of each mesh are kept for culling
+                BoundingBox meshAABB;
+                BoundingBox::CreateFromPoints(meshAABB, min, max);
+                meshRender->SetBounds(meshAABB);
+
+                if (!hasAABB)
                 {
-                    node->IsAABBCalculated = true;
-                    BoundingBox::CreateFromPoints(nodeAABB, min, max);
+                    hasAABB = true;
+                    nodeAABB = meshAABB;
                 }
                 else
                 {
-                    BoundingBox tempAABB;
-                    BoundingBox::CreateFromPoints(tempAABB, min, max);
-                    nodeAABB.MergeBoundingBox(tempAABB);
+                    nodeAABB.MergeBoundingBox(meshAABB);
                 }
             }
-            
-            aiMaterial* assimpMat = aScene->mMaterials[assimpMesh->mMaterialIndex];
-            Material::Ptr mat = AssetsLoader::ParseMaterial(assimpMat, aScene, directory);
 
-            node->MeshRenders.push_back(MeshRender::New(mesh, mat));
+            node->MeshRenders.push_back(meshRender);
         }
     }
-    node->AABB = nodeAABB;
+    if (hasAABB)
+    {
+        node->SetAABB(nodeAABB);
+    }
 
     // Also recursively parse this node's children
     for (unsigned int i = 0; i < aNode->mNumChildren; ++i)
@@ -318,6 +342,20 @@ void AssetsLoader::EncodeTBN(const glm::vec3 &tangent, const glm::vec3 &bitangen
     }
 }
 
+void AssetsLoader::DecodeTBN(const glm::vec4 &q, glm::vec3 &tangent, glm::vec3 &bitangent, glm::vec3 &normal)
+{
+    // Same as ExtractNormalAndTangent() in common/functions.glsl
+    normal = glm::vec3(0.0f, 0.0f, 1.0f) +
+             glm::vec3(2.0f, -2.0f, -2.0f) * q.x * glm::vec3(q.z, q.w, q.x) +
+             glm::vec3(2.0f, 2.0f, -2.0f) * q.y * glm::vec3(q.w, q.z, q.y);
+    tangent = glm::vec3(1.0f, 0.0f, 0.0f) +
+              glm::vec3(-2.0f, 2.0f, -2.0f) * q.y * glm::vec3(q.y, q.x, q.w) +
+              glm::vec3(-2.0f, 2.0f, 2.0f) * q.z * glm::vec3(q.z, q.w, q.x);
+
+    // A negative w means EncodeTBN() found a reflection, (t x n) . b < 0
+    bitangent = q.w < 0.0f ? glm::cross(normal, tangent) : glm::cross(tangent, normal);
+}
+
 Material::Ptr AssetsLoader::ParseMaterial(aiMaterial* aMaterial, const aiScene* aScene, const std::string& directory)
 {
     // Blend mode
@@ -355,11 +393,7 @@ Material::Ptr AssetsLoader::ParseMaterial(aiMaterial* aMaterial, const aiScene*
     if (AI_SUCCESS == aMaterial->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath))
     {
         mat->AddOrSetTexture(AssetsLoader::LoadAssimpTexture("uBaseMap", directory, texturePath.C_Str()));
-        mat->AddOrSetFloat("uBaseMapSet", 1.0f);
-    }
-    else
-    {
-        mat->AddOrSetFloat("uBaseMapSet", -1.0f);
+        mat->SetFeature(ShaderFeature::BASE_MAP, true);
     }
 
     // Base color
@@ -377,22 +411,14 @@ Material::Ptr AssetsLoader::ParseMaterial(aiMaterial* aMaterial, const aiScene*
     if (AI_SUCCESS == aMaterial->GetTexture(aiTextureType_NORMALS, 0, &texturePath))
     {
         mat->AddOrSetTexture(AssetsLoader::LoadAssimpTexture("uNormalMap", directory, texturePath.C_Str()));
-        mat->AddOrSetFloat("uNormalMapSet", 1.0f);
-    }
-    else
-    {
-        mat->AddOrSetFloat("uNormalMapSet", -1.0f);
+        mat->SetFeature(ShaderFeature::NORMAL_MAP, true);
     }
 
     // Emission
     if (AI_SUCCESS == aMaterial->GetTexture(aiTextureType_EMISSIVE, 0, &texturePath))
     {
         mat->AddOrSetTexture(AssetsLoader::LoadAssimpTexture("uEmissiveMap", directory, texturePath.C_Str()));
-        mat->AddOrSetFloat("uEmissiveMapSet", 1.0f);
-    }
-    else
-    {
-        mat->AddOrSetFloat("uEmissiveMapSet", -1.0f);
+        mat->SetFeature(ShaderFeature::EMISSIVE_MAP, true);
     }
 
     // Emission color
@@ -410,11 +436,7 @@ Material::Ptr AssetsLoader::ParseMaterial(aiMaterial* aMaterial, const aiScene*
     if (AI_SUCCESS == aMaterial->GetTexture(aiTextureType_METALNESS, 0, &texturePath))
     {
         mat->AddOrSetTexture(AssetsLoader::LoadAssimpTexture("uMetallicRoughnessMap", directory, texturePath.C_Str()));
-        mat->AddOrSetFloat("uMetallicRoughnessMapSet", 1.0f);
-    }
-    else
-    {
-        mat->AddOrSetFloat("uMetallicRoughnessMapSet", -1.0f);
+        mat->SetFeature(ShaderFeature::METALLIC_ROUGHNESS_MAP, true);
     }
 
     // Metallic factor
@@ -442,11 +464,7 @@ Material::Ptr AssetsLoader::ParseMaterial(aiMaterial* aMaterial, const aiScene*
     if (AI_SUCCESS == aMaterial->GetTexture(aiTextureType_LIGHTMAP, 0, &texturePath))
     {
         mat->AddOrSetTexture(AssetsLoader::LoadAssimpTexture("uOcclusionMap", directory, texturePath.C_Str()));
-        mat->AddOrSetFloat("uOcclusionMapSet", 1.0f);
-    }
-    else
-    {
-        mat->AddOrSetFloat("uOcclusionMapSet", -1.0f);
+        mat->SetFeature(ShaderFeature::OCCLUSION_MAP, true);
     }
 
     // Cull face
@@ -461,8 +479,8 @@ Material::Ptr AssetsLoader::ParseMaterial(aiMaterial* aMaterial, const aiScene*
     }
 
     mat->SetAlphaMode(mode);
-    mat->AddOrSetFloat("uAlphaBlendSet", mode == Material::AlphaMode::BLEND ? 1.0f : -1.0f);
-    mat->AddOrSetFloat("uAlphaTestSet", mode == Material::AlphaMode::MASK ? 1.0f : -1.0f);
+    mat->SetFeature(ShaderFeature::ALPHA_BLEND, mode == Material::AlphaMode::BLEND);
+    mat->SetFeature(ShaderFeature::ALPHA_TEST, mode == Material::AlphaMode::MASK);
 
     // Alpha cutoff
     if (AI_SUCCESS == aiGetMaterialFloat(aMaterial, AI_MATKEY_GLTF_ALPHACUTOFF, &valueFactor))
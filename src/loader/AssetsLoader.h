@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <cstdint>
 
 #include <glm/glm.hpp>
 #include <assimp/scene.h>
@@ -17,21 +18,17 @@
 class AssetsLoader
 {
 public:
-    static Shader::Ptr LoadShader(const std::string &name, const std::string &vsFilePath, const std::string &fsFilePath);
+    // The defines are inserted after the #version line of both stages, see ShaderSourceDatabase.
+    // Programs are cached by the hashes of their preprocessed stages, loading the same files and defines again returns the same Shader.
+    static Shader::Ptr LoadShader(const std::string &name, const std::string &vsFilePath, const std::string &fsFilePath, const std::vector<std::string> &defines = {});
     static Texture2D::Ptr LoadTexture(const std::string &textureName, const std::string &filePath, bool useMipmap = false);
     static Texture2D::Ptr LoadHDRTexture(const std::string &textureName, const std::string &filePath, bool useMipmap = false);
     static SceneNode::Ptr LoadModel(const std::string &filePath, const bool &calculateAABB = true);
 
-private:
-    static std::string ReadShader(std::ifstream &file, const std::string &name);
-    static SceneNode::Ptr ProcessAssimpNode(aiNode* aNode, const aiScene* aScene, const std::string &directory, const bool &calculateAABB);
-    static Mesh::Ptr ParseMesh(aiMesh* aMesh, const aiScene* aScene);
-    
     // Encode the orthonormal basis as a quaternion to save space in the attributes, and the sign of the w component preserve the reflection ((n x t) . b <= 0)
     static void EncodeTBN(const glm::vec3 &tangent, const glm::vec3 &bitangent, const glm::vec3 &normal, glm::quat &q);
-
-    static Material::Ptr ParseMaterial(aiMaterial* aMaterial, const aiScene* aScene, const std::string& directory);
-    static Texture2D::Ptr LoadAssimpTexture(const std::string &textureName, const std::string &directory, const std::string &texturePath);
+    // Inverse of EncodeTBN(), encoding the returned basis gives the same quaternion
+    static void DecodeTBN(const glm::vec4 &q, glm::vec3 &tangent, glm::vec3 &bitangent, glm::vec3 &normal);
 
     inline static std::string GetAssetsPath()
     {
@@ -43,6 +40,14 @@ private:
     }
 
     inline static std::string GetShaderPath() { return GetAssetsPath() + "shaders/"; }
+
+private:
+    static SceneNode::Ptr ProcessAssimpNode(aiNode* aNode, const aiScene* aScene, const std::string &directory, const bool &calculateAABB);
+    static Mesh::Ptr ParseMesh(aiMesh* aMesh, const aiScene* aScene);
+
+    static Material::Ptr ParseMaterial(aiMaterial* aMaterial, const aiScene* aScene, const std::string& directory);
+    static Texture2D::Ptr LoadAssimpTexture(const std::string &textureName, const std::string &directory, const std::string &texturePath);
+
     inline static GLenum GetFormat(const int &components)
     {
         GLenum format = 0;
@@ -73,4 +78,8 @@ private:
     }
 
     static std::map<std::string, Texture2D::Ptr> assimpTextures;
+    // The meshes using the same assimp material share one Material, keyed by the material index of the scene
+    static std::map<unsigned int, Material::Ptr> assimpMaterials;
+    // Linked programs keyed by the hash of their preprocessed sources, shared by all the materials using them
+    static std::map<uint64_t, Shader::Ptr> shaderPrograms;
 };
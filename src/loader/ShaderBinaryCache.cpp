@@ -0,0 +1,142 @@
+#include "loader/ShaderBinaryCache.h"
+
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+
+#include "utility/Hash.h"
+
+bool ShaderBinaryCache::IsSupported()
+{
+    static int formatCount = -1;
+    if (formatCount < 0)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+        formatCount = count;
+    }
+    return formatCount > 0;
+}
+
+uint64_t ShaderBinaryCache::MakeKey(uint64_t sourceHash)
+{
+    uint64_t key = Hash::FNV1a64(&sourceHash, sizeof(sourceHash));
+    const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (GLenum name : driverStrings)
+    {
+        const char *value = reinterpret_cast<const char*>(glGetString(name));
+        key = Hash::FNV1a64(std::string(value ? value : ""), key);
+    }
+    return key;
+}
+
+GLuint ShaderBinaryCache::LoadProgram(uint64_t key)
+{
+    if (!IsSupported())
+    {
+        return 0;
+    }
+
+    std::string path = GetFilePath(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return 0;
+    }
+
+    FileHeader header;
+    std::vector<char> binary;
+    bool valid = static_cast<bool>(file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        && header.Magic == FILE_MAGIC && header.Version == FILE_VERSION && header.Key == key && header.BinaryLength > 0;
+    if (valid)
+    {
+        binary.resize(header.BinaryLength);
+        valid = static_cast<bool>(file.read(binary.data(), binary.size()));
+    }
+    file.close();
+
+    GLuint programID = 0;
+    if (valid)
+    {
+        programID = glCreateProgram();
+        glProgramBinary(programID, header.BinaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+
+        // A driver update can reject a binary saved under the same strings
+        GLint success = GL_FALSE;
+        glGetProgramiv(programID, GL_LINK_STATUS, &success);
+        if (success == GL_FALSE)
+        {
+            glDeleteProgram(programID);
+            programID = 0;
+        }
+    }
+
+    if (programID == 0)
+    {
+        std::cerr << "Discarded shader binary: " << path << std::endl;
+        std::error_code error;
+        std::filesystem::remove(path, error);
+    }
+    return programID;
+}
+
+void ShaderBinaryCache::SaveProgram(uint64_t key, GLuint programID)
+{
+    if (!IsSupported() || programID == 0)
+    {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(programID, length, &length, &format, binary.data());
+    if (length <= 0)
+    {
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(GetCacheDirectory(), error);
+
+    // Written to a temporary file first, so a crash while writing never leaves a truncated binary under the key
+    std::string path = GetFilePath(key);
+    std::string tempPath = path + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to write shader binary: " << tempPath << std::endl;
+        return;
+    }
+
+    FileHeader header = { FILE_MAGIC, FILE_VERSION, key, format, static_cast<uint32_t>(length) };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), length);
+    file.close();
+
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        std::cerr << "Failed to write shader binary: " << path << std::endl;
+        std::filesystem::remove(tempPath, error);
+    }
+}
+
+std::string ShaderBinaryCache::GetFilePath(uint64_t key)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string name(16, '0');
+    for (int i = 15; i >= 0; --i)
+    {
+        name[i] = digits[key & 0xF];
+        key >>= 4;
+    }
+    return GetCacheDirectory() + name + ".bin";
+}
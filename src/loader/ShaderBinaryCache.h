@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <glad/glad.h>
+
+// Linked program binaries saved on disk with glGetProgramBinary, so a restart does not compile the shaders again.
+// A binary is only valid for the driver which produced it, the driver strings are part of the key, and any binary
+// the driver still rejects is deleted so the caller compiles the program from the sources and saves it again.
+class ShaderBinaryCache
+{
+public:
+    // False if the driver does not expose any binary format
+    static bool IsSupported();
+
+    // Combine the hash of the preprocessed sources with the vendor, renderer and version strings of the driver
+    static uint64_t MakeKey(uint64_t sourceHash);
+
+    // Returns a linked program, or 0 if there is no valid binary for the key
+    static GLuint LoadProgram(uint64_t key);
+    // The program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    static void SaveProgram(uint64_t key, GLuint programID);
+
+    // Relative to the working directory, next to the build instead of the assets
+    static std::string GetCacheDirectory() { return "./ShaderCache/"; }
+
+private:
+    struct FileHeader
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        uint64_t Key;
+        uint32_t BinaryFormat;
+        uint32_t BinaryLength;
+    };
+
+    static constexpr uint32_t FILE_MAGIC = 0x42505347; // "GSPB"
+    static constexpr uint32_t FILE_VERSION = 1;
+
+    static std::string GetFilePath(uint64_t key);
+};
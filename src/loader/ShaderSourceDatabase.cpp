@@ -0,0 +1,173 @@
+#include "loader/ShaderSourceDatabase.h"
+
+#include <fstream>
+#include <iostream>
+
+#include "loader/AssetsLoader.h"
+#include "utility/Hash.h"
+#include "utility/StatusRecorder.h"
+
+std::vector<std::unique_ptr<ShaderSourceDatabase::SourceFile>> ShaderSourceDatabase::s_Files;
+std::map<std::string, uint32_t> ShaderSourceDatabase::s_FileIDs;
+std::map<std::string, ShaderSourceDatabase::StageSource> ShaderSourceDatabase::s_Stages;
+
+const ShaderSourceDatabase::StageSource& ShaderSourceDatabase::GetStage(const std::string &filePath, const std::vector<std::string> &defines)
+{
+    std::string key = filePath;
+    for (const std::string &define : defines)
+    {
+        key += '|';
+        key += define;
+    }
+
+    auto iter = s_Stages.find(key);
+    if (iter != s_Stages.end())
+    {
+        return iter->second;
+    }
+
+    StageSource &stage = s_Stages[key];
+    stage.Hash = 0;
+    stage.Valid = false;
+
+    uint32_t fileID = LoadFile(filePath);
+    if (!s_Files[fileID]->Loaded)
+    {
+        return stage;
+    }
+
+    std::set<uint32_t> includedFiles;
+    stage.Hash = Hash::FNV1A_64_OFFSET;
+    AppendFile(fileID, stage, includedFiles, &defines);
+    stage.Valid = true;
+    return stage;
+}
+
+const std::string& ShaderSourceDatabase::GetFilePath(uint32_t fileID)
+{
+    static const std::string unknown = "<unknown>";
+    return fileID < s_Files.size() ? s_Files[fileID]->Path : unknown;
+}
+
+std::string ShaderSourceDatabase::DescribeFiles(const StageSource &stage)
+{
+    std::string description;
+    for (uint32_t fileID : stage.FileIDs)
+    {
+        description += "  " + std::to_string(fileID) + ": " + GetFilePath(fileID) + "\n";
+    }
+    return description;
+}
+
+void ShaderSourceDatabase::Clear()
+{
+    s_Stages.clear();
+    s_FileIDs.clear();
+    s_Files.clear();
+}
+
+uint32_t ShaderSourceDatabase::LoadFile(const std::string &filePath)
+{
+    auto iter = s_FileIDs.find(filePath);
+    if (iter != s_FileIDs.end())
+    {
+        return iter->second;
+    }
+
+    uint32_t fileID = static_cast<uint32_t>(s_Files.size());
+    s_FileIDs[filePath] = fileID;
+    s_Files.emplace_back(new SourceFile());
+    SourceFile &file = *s_Files.back();
+    file.Path = filePath;
+
+    // A missing file is remembered too, it is reported once
+    std::ifstream stream(AssetsLoader::GetShaderPath() + filePath);
+    file.Loaded = stream.is_open();
+    if (!file.Loaded)
+    {
+        std::cerr << "Failed to read shader file: " << AssetsLoader::GetShaderPath() + filePath << std::endl;
+        return fileID;
+    }
+
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        file.Lines.push_back(line);
+    }
+    StatusRecorder::ShaderFileReads++;
+    return fileID;
+}
+
+void ShaderSourceDatabase::AppendFile(uint32_t fileID, StageSource &stage, std::set<uint32_t> &includedFiles, const std::vector<std::string> *defines)
+{
+    includedFiles.insert(fileID);
+    stage.FileIDs.push_back(fileID);
+
+    const std::string includeDirective = "#include ";
+    const SourceFile &file = *s_Files[fileID];
+
+    // The ids follow the order the files are first loaded in the run, so the hash skips the #line directives and
+    // takes the paths instead
+    stage.Hash = Hash::FNV1a64(file.Path, stage.Hash);
+
+    // Without a #version line the defines go first
+    bool hasVersion = !file.Lines.empty() && file.Lines[0].compare(0, 8, "#version") == 0;
+    if (defines && !hasVersion)
+    {
+        for (const std::string &define : *defines)
+        {
+            stage.Source += "#define " + define + "\n";
+            stage.Hash = Hash::FNV1a64(define, stage.Hash);
+        }
+        stage.Source += "#line 1 " + std::to_string(fileID) + "\n";
+    }
+
+    for (size_t i = 0; i < file.Lines.size(); ++i)
+    {
+        const std::string &line = file.Lines[i];
+        stage.Hash = Hash::FNV1a64(line, stage.Hash);
+        if (line.compare(0, includeDirective.length(), includeDirective) == 0)
+        {
+            size_t begin = line.find('"');
+            size_t end = line.rfind('"');
+            if (begin == std::string::npos || end <= begin)
+            {
+                std::cerr << "Malformed include in shader file: " << file.Path << "(" << i + 1 << ")" << std::endl;
+                continue;
+            }
+
+            uint32_t includedID = LoadFile(line.substr(begin + 1, end - begin - 1));
+            if (includedFiles.count(includedID) == 0 && s_Files[includedID]->Loaded)
+            {
+                stage.Source += "#line 1 " + std::to_string(includedID) + "\n";
+                AppendFile(includedID, stage, includedFiles, nullptr);
+                // The next line keeps its number in this file
+                stage.Source += "#line " + std::to_string(i + 2) + " " + std::to_string(fileID) + "\n";
+            }
+            else
+            {
+                // Already included, an empty line keeps the numbering
+                stage.Source += '\n';
+            }
+            continue;
+        }
+
+        stage.Source += line;
+        stage.Source += '\n';
+
+        // #version must stay the first statement, the defines of the variant follow it
+        if (i == 0 && defines && hasVersion)
+        {
+            for (const std::string &define : *defines)
+            {
+                stage.Source += "#define " + define + "\n";
+                stage.Hash = Hash::FNV1a64(define, stage.Hash);
+            }
+            stage.Source += "#line 2 " + std::to_string(fileID) + "\n";
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Shader files read once from disk, and the preprocessed stages built from them, kept for the whole run.
+// Each file is inlined at most once per stage, so the include guards of the common headers are not needed any more.
+// The stages carry #line directives whose source string number is the id of the file, GetFilePath() maps the
+// numbers of a compile error back to the files.
+class ShaderSourceDatabase
+{
+public:
+    struct StageSource
+    {
+        std::string Source;
+        // FNV-1a of the paths and the lines of the files and of the defines, without the #line directives whose file ids
+        // depend on the load order, so it is the same on every run as long as the files do not change
+        uint64_t Hash;
+        // Files inlined in the stage, by id
+        std::vector<uint32_t> FileIDs;
+        bool Valid;
+    };
+
+    // Preprocess a stage once per set of defines, the defines are inserted after the #version line.
+    // The path is relative to the shader directory, the result stays valid until Clear().
+    static const StageSource& GetStage(const std::string &filePath, const std::vector<std::string> &defines = {});
+
+    static const std::string& GetFilePath(uint32_t fileID);
+    // "<id>: <path>" of every file of the stage, for the compile errors
+    static std::string DescribeFiles(const StageSource &stage);
+
+    static void Clear();
+
+private:
+    struct SourceFile
+    {
+        std::string Path;
+        std::vector<std::string> Lines;
+        bool Loaded;
+    };
+
+    static uint32_t LoadFile(const std::string &filePath);
+    static void AppendFile(uint32_t fileID, StageSource &stage, std::set<uint32_t> &includedFiles, const std::vector<std::string> *defines);
+
+    static std::vector<std::unique_ptr<SourceFile>> s_Files;
+    static std::map<std::string, uint32_t> s_FileIDs;
+    // Keyed by the path and the defines
+    static std::map<std::string, StageSource> s_Stages;
+};
@@ -0,0 +1,176 @@
+#include "loader/StaticBatcher.h"
+
+#include <cfloat>
+#include <chrono>
+#include <algorithm>
+#include <glm/gtc/quaternion.hpp>
+
+#include "loader/AssetsLoader.h"
+#include "utility/StatusRecorder.h"
+
+void StaticBatcher::Build(SceneNode::Ptr root)
+{
+    if (!root || !root->IsStatic)
+    {
+        return;
+    }
+
+    auto batchingStart = std::chrono::high_resolution_clock::now();
+
+    // The transform of the root is kept on the root, so the model can still be placed after batching
+    std::map<Material*, std::vector<SourceMesh>> meshesByMaterial;
+    CollectStaticMeshes(root.get(), glm::mat4(1.0f), meshesByMaterial);
+
+    BoundingBox rootAABB = root->AABB;
+    bool hasRootAABB = root->IsAABBCalculated;
+
+    for (auto &pair : meshesByMaterial)
+    {
+        std::vector<SourceMesh> &sources = pair.second;
+        if (sources.size() < 2)
+        {
+            continue;
+        }
+
+        std::vector<vec3> vertices;
+        std::vector<vec4> tangents;
+        std::vector<vec2> texcoords;
+        std::vector<unsigned int> indices;
+
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
+        for (const SourceMesh &source : sources)
+        {
+            vertexCount += source.Render->GetMesh()->GetVertices().size();
+            indexCount += source.Render->GetMesh()->GetIndices().size();
+        }
+        vertices.reserve(vertexCount);
+        tangents.reserve(vertexCount);
+        texcoords.reserve(vertexCount);
+        indices.reserve(indexCount);
+
+        // Ranges and bounds of the source meshes in the merged mesh
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        std::vector<BoundingBox> bounds;
+        for (const SourceMesh &source : sources)
+        {
+            const Mesh::Ptr &mesh = source.Render->GetMesh();
+            const std::vector<vec3> &sourceVertices = mesh->GetVertices();
+            const std::vector<vec4> &sourceTangents = mesh->GetTangents();
+            const std::vector<vec2> &sourceTexcoords = mesh->GetTexcoords();
+            const std::vector<unsigned int> &sourceIndices = mesh->GetIndices();
+
+            const mat3 model = mat3(source.RootFromMesh);
+            const mat3 normalMatrix = transpose(inverse(model));
+
+            vec3 boundsMin = vec3(FLT_MAX);
+            vec3 boundsMax = vec3(-FLT_MAX);
+            const unsigned int baseVertex = static_cast<unsigned int>(vertices.size());
+            for (size_t i = 0; i < sourceVertices.size(); ++i)
+            {
+                vec3 position = vec3(source.RootFromMesh * vec4(sourceVertices[i], 1.0f));
+                boundsMin = min(boundsMin, position);
+                boundsMax = max(boundsMax, position);
+                vertices.push_back(position);
+                texcoords.push_back(sourceTexcoords[i]);
+
+                // Transform the basis like Lit.vs does and encode it again, a mirroring transform flips the bitangent
+                vec3 tangent, bitangent, normal;
+                AssetsLoader::DecodeTBN(sourceTangents[i], tangent, bitangent, normal);
+                normal = normalize(normalMatrix * normal);
+                tangent = model * tangent;
+                tangent = normalize(tangent - normal * dot(normal, tangent));
+                bitangent = model * bitangent;
+
+                glm::quat q;
+                AssetsLoader::EncodeTBN(tangent, bitangent, normal, q);
+                tangents.push_back(vec4(q.x, q.y, q.z, q.w));
+            }
+
+            const uint32_t indexOffset = static_cast<uint32_t>(indices.size());
+            for (size_t i = 0; i < sourceIndices.size(); ++i)
+            {
+                indices.push_back(baseVertex + sourceIndices[i]);
+            }
+            ranges.push_back(std::make_pair(indexOffset, static_cast<uint32_t>(sourceIndices.size())));
+
+            BoundingBox meshBounds;
+            BoundingBox::CreateFromPoints(meshBounds, boundsMin, boundsMax);
+            bounds.push_back(meshBounds);
+        }
+
+        Mesh::Ptr mergedMesh = Mesh::New(vertices, tangents, texcoords, indices);
+        Material::Ptr mat = sources[0].Render->GetMaterial();
+        for (size_t i = 0; i < sources.size(); ++i)
+        {
+            MeshRender::Ptr render = MeshRender::New(mergedMesh, mat);
+            render->SetIndexRange(ranges[i].first, ranges[i].second);
+            render->SetBounds(bounds[i]);
+            root->MeshRenders.push_back(render);
+
+            if (!hasRootAABB)
+            {
+                rootAABB = bounds[i];
+                hasRootAABB = true;
+            }
+            else
+            {
+                rootAABB.MergeBoundingBox(bounds[i]);
+            }
+
+            // The source mesh is now drawn from the merged one
+            std::vector<MeshRender::Ptr> &nodeRenders = sources[i].Node->MeshRenders;
+            nodeRenders.erase(std::remove(nodeRenders.begin(), nodeRenders.end(), sources[i].Render), nodeRenders.end());
+        }
+
+        StatusRecorder::StaticBatchCount++;
+        StatusRecorder::StaticBatchedMeshCount += static_cast<unsigned int>(sources.size());
+    }
+
+    if (hasRootAABB)
+    {
+        root->SetAABB(rootAABB);
+    }
+
+    auto batchingEnd = std::chrono::high_resolution_clock::now();
+    StatusRecorder::StaticBatchingTime += std::chrono::duration<float, std::milli>(batchingEnd - batchingStart).count();
+}
+
+void StaticBatcher::CollectStaticMeshes(SceneNode *node, const glm::mat4 &rootFromNode, std::map<Material*, std::vector<SourceMesh>> &outMeshesByMaterial)
+{
+    for (size_t i = 0; i < node->MeshRenders.size(); ++i)
+    {
+        const MeshRender::Ptr &render = node->MeshRenders[i];
+        if (CanBeMerged(node, render))
+        {
+            SourceMesh source;
+            source.Node = node;
+            source.Render = render;
+            source.RootFromMesh = rootFromNode;
+            outMeshesByMaterial[render->GetMaterial().get()].push_back(source);
+        }
+    }
+
+    for (size_t i = 0; i < node->GetChildrenCount(); ++i)
+    {
+        SceneNode::Ptr child = node->GetChildByIndex(i);
+        if (child->IsStatic)
+        {
+            CollectStaticMeshes(child.get(), rootFromNode * child->GetLocalMatrix(), outMeshesByMaterial);
+        }
+    }
+}
+
+bool StaticBatcher::CanBeMerged(SceneNode *node, const MeshRender::Ptr &render)
+{
+    // Blended meshes are sorted back-to-front one by one
+    if (node->OverrideMat || render->GetMaterial()->GetAlphaMode() == Material::AlphaMode::BLEND || render->GetIndexCount() > 0)
+    {
+        return false;
+    }
+
+    // The merged vertex layout has all the attributes
+    const Mesh::Ptr &mesh = render->GetMesh();
+    size_t vertexCount = mesh->GetVertices().size();
+    return vertexCount > 0 && mesh->GetIndices().size() > 0 && mesh->GetTangents().size() == vertexCount && mesh->GetTexcoords().size() == vertexCount;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <glm/glm.hpp>
+
+#include "scene/SceneNode.h"
+
+// Merge the meshes of the static nodes of a loaded model by material, so each material is drawn from one set of buffers.
+// The vertices are pre-transformed into the space of the root, every source mesh stays a MeshRender drawing an index range of
+// the merged mesh with its own bounds, so the culling still works per source mesh and the adjacent visible ranges are drawn at once.
+class StaticBatcher
+{
+public:
+    // Only the nodes whose whole path from the root is static are merged, the root must be static.
+    // Blended materials and the nodes with an override material are left as they are.
+    static void Build(SceneNode::Ptr root);
+
+private:
+    struct SourceMesh
+    {
+        SceneNode* Node;
+        MeshRender::Ptr Render;
+        glm::mat4 RootFromMesh;
+    };
+
+    static void CollectStaticMeshes(SceneNode *node, const glm::mat4 &rootFromNode, std::map<Material*, std::vector<SourceMesh>> &outMeshesByMaterial);
+    static bool CanBeMerged(SceneNode *node, const MeshRender::Ptr &render);
+};
@@ -1,5 +1,6 @@
 #include <string>
 #include <iostream>
+#include <chrono>
 #include <glad/glad.h>
 
 #include "imgui.h"
@@ -13,6 +14,12 @@
 #include "lights/DirectionalLight.h"
 
 #include "loader/AssetsLoader.h"
+#include "loader/StaticBatcher.h"
+
+#include "meshes/GeometryPool.h"
+
+#include "base/MaterialParameterBuffer.h"
+#include "base/ShaderVariants.h"
 
 #include "scene/SceneNode.h"
 
@@ -45,6 +52,8 @@ void checkOpenGLError();
 
 int main()
 {
+    auto startupBegin = std::chrono::high_resolution_clock::now();
+
 //    double p = 3.1415926535897932;
 //    std::cout << std::fixed << std::setprecision(16);
 //    std::cout << 1.0 / p << std::endl;
@@ -101,12 +110,48 @@ int main()
     m_SceneRenderGraph->Init();
 
     // SceneNode::Ptr sponza = AssetsLoader::LoadModel("models/glTF/Sponza/glTF/Sponza.gltf");
+    // if (StatusRecorder::StaticBatching)
+    // {
+    //     sponza->SetStatic(true);
+    //     StaticBatcher::Build(sponza);
+    // }
     // m_SceneRenderGraph->AddSceneNode(sponza);
 
     SceneNode::Ptr helmet = AssetsLoader::LoadModel("models/glTF/DamagedHelmet/glTF/DamagedHelmet.gltf");
     m_SceneRenderGraph->AddSceneNode(helmet);
 
-    SceneNode::Ptr floor = AssetsLoader::LoadModel("models/obj/floor/floor.obj");
+    // The floor is a grid of tiles sharing the mesh and the material of the plane, the static batching merges them into
+    // one mesh and the tiles out of view are still culled one by one
+    SceneNode::Ptr floorModel = AssetsLoader::LoadModel("models/obj/floor/floor.obj");
+    SceneNode::Ptr floorPlane = floorModel->MeshRenders.empty() ? floorModel->GetChildByIndex(0) : floorModel;
+    const MeshRender::Ptr &floorRender = floorPlane->MeshRenders[0];
+    const BoundingBox &floorBounds = floorRender->GetBounds();
+
+    const unsigned int floorTilesPerSide = 4;
+    const glm::vec3 tileScale = glm::vec3(1.0f / floorTilesPerSide, 1.0f, 1.0f / floorTilesPerSide);
+    const glm::vec3 tileSize = floorBounds.Extents * 2.0f * tileScale;
+    SceneNode::Ptr floor = SceneNode::New();
+    for (unsigned int x = 0; x < floorTilesPerSide; ++x)
+    {
+        for (unsigned int z = 0; z < floorTilesPerSide; ++z)
+        {
+            SceneNode::Ptr tile = SceneNode::New();
+            MeshRender::Ptr tileRender = MeshRender::New(floorRender->GetMesh(), floorRender->GetMaterial());
+            tileRender->SetBounds(floorBounds);
+            tile->MeshRenders.push_back(tileRender);
+            tile->SetAABB(floorBounds);
+
+            glm::vec3 tileCenter = floorBounds.Center + glm::vec3((x + 0.5f) * tileSize.x - floorBounds.Extents.x, 0.0f, (z + 0.5f) * tileSize.z - floorBounds.Extents.z);
+            tile->Translate(tileCenter - tileScale * floorBounds.Center);
+            tile->Scale(tileScale);
+            floor->AddChild(tile);
+        }
+    }
+    if (StatusRecorder::StaticBatching)
+    {
+        floor->SetStatic(true);
+        StaticBatcher::Build(floor);
+    }
     floor->Translate(glm::vec3(0.0f, -1.5f, 0.0f));
     m_SceneRenderGraph->AddSceneNode(floor);
 
@@ -172,6 +217,82 @@ int main()
 
             ImGui::Checkbox("FXAA", &StatusRecorder::FXAA);
             ImGui::Checkbox("SSAO", &StatusRecorder::SSAO);
+            ImGui::Checkbox("Depth Pre-Pass (Forward)", &StatusRecorder::DepthPrePass);
+            ImGui::Checkbox("Frustum Culling", &StatusRecorder::FrustumCulling);
+            ImGui::Checkbox("Sort Commands", &StatusRecorder::SortCommands);
+            ImGui::Checkbox("Sort Transparent Triangles", &StatusRecorder::SortTransparentTriangles);
+            ImGui::Checkbox("Instancing", &StatusRecorder::Instancing);
+
+            if (ImGui::TreeNode("Statistics"))
+            {
+                ImGui::Text("Transform update: %.3f ms", StatusRecorder::TransformUpdateTime);
+                ImGui::Text("Scene bounds update: %.3f ms", StatusRecorder::SceneBoundsUpdateTime);
+                ImGui::Text("Visible meshes: %u", StatusRecorder::VisibleMeshCount);
+                ImGui::Text("Culled meshes: %u", StatusRecorder::CulledMeshCount);
+                ImGui::Text("Shadow caster draws: %u", StatusRecorder::ShadowCasterDrawCount);
+                ImGui::Text("Culled shadow casters: %u", StatusRecorder::ShadowCasterCulledCount);
+                ImGui::Text("BVH build: %.3f ms", StatusRecorder::BVHBuildTime);
+                ImGui::Text("BVH refit: %.3f ms", StatusRecorder::BVHRefitTime);
+                ImGui::Text("BVH queries: %.3f ms", StatusRecorder::BVHQueryTime);
+                ImGui::Text("Command build allocations: %u", StatusRecorder::CommandBuildAllocations);
+                ImGui::Text("Program switches: %u", StatusRecorder::ProgramSwitches);
+                ImGui::Text("Texture binds: %u", StatusRecorder::TextureBinds);
+                ImGui::Text("Uniform uploads: %u, ring waits: %u", StatusRecorder::UniformUploads, StatusRecorder::UniformRingWaits);
+                ImGui::Text("Per-draw uniforms uploaded: %.1f KB", StatusRecorder::DrawUniformUploadBytes / 1024.0f);
+                ImGui::Text("Material blocks: %u (%.1f / %.1f KB), %u binds", MaterialParameterBuffer::GetBlockCount(),
+                    MaterialParameterBuffer::GetUsedSize() / 1024.0f, MaterialParameterBuffer::GetCapacity() / 1024.0f, StatusRecorder::UniformBufferBinds);
+                ImGui::Text("Render targets: %u pooled (%.1f MB), %u allocated", StatusRecorder::PooledRenderTargetCount,
+                    StatusRecorder::PooledRenderTargetMemory, StatusRecorder::RenderTargetAllocations);
+                ImGui::Text("Frame graph: %u passes (%u culled), %u targets in %u (%.1f MB shared)", StatusRecorder::FrameGraphPassCount,
+                    StatusRecorder::FrameGraphCulledPassCount, StatusRecorder::FrameGraphTransientTargets, StatusRecorder::FrameGraphPhysicalTargets,
+                    StatusRecorder::FrameGraphAliasedMemory);
+                ImGui::Text("Vertex array binds: %u", StatusRecorder::VertexArrayBinds);
+                size_t geometryUsedBytes, geometryReservedBytes;
+                GeometryPool::GetMemoryUsage(geometryUsedBytes, geometryReservedBytes);
+                ImGui::Text("Geometry pools: %zu, %.2f / %.2f MB, %u rebuilds", GeometryPool::GetPoolCount(),
+                    geometryUsedBytes / (1024.0f * 1024.0f), geometryReservedBytes / (1024.0f * 1024.0f), StatusRecorder::GeometryPoolRebuilds);
+                ImGui::Text("Instanced draws: %u (%u commands)", StatusRecorder::InstancedBatchCount, StatusRecorder::InstancedCommandCount);
+                ImGui::Text("Instanced shadow draws: %u", StatusRecorder::InstancedShadowBatchCount);
+                ImGui::Text("Opaque draw calls: %u", StatusRecorder::OpaqueDrawCount);
+                ImGui::Text("Shader programs: %u cache misses (%u compiled, %u from binaries, %.1f ms), %u cache hits", StatusRecorder::ShaderCacheMisses,
+                    StatusRecorder::ShaderCompiles, StatusRecorder::ShaderBinaryCacheHits, StatusRecorder::ShaderCompileTime, StatusRecorder::ShaderCacheHits);
+                ImGui::Text("Shader variants: %zu, %u files read", ShaderVariantCache::GetTotalVariantCount(), StatusRecorder::ShaderFileReads);
+                ImGui::Text("Startup to first frame: %.1f ms", StatusRecorder::StartupTime);
+                ImGui::Text("Static batches: %u (%u meshes, %.3f ms)", StatusRecorder::StaticBatchCount, StatusRecorder::StaticBatchedMeshCount, StatusRecorder::StaticBatchingTime);
+                ImGui::TreePop();
+            }
+
+            if (ImGui::TreeNode("Frame Graph"))
+            {
+                const FrameGraph::Ptr frameGraph = m_SceneRenderGraph->GetFrameGraph();
+                const std::vector<FrameGraph::PassInfo> &passInfos = frameGraph->GetPassInfos();
+                for (size_t i = 0; i < passInfos.size(); ++i)
+                {
+                    ImGui::Text("%zu: %s%s", i, passInfos[i].Name, passInfos[i].Culled ? " (culled)" : "");
+                }
+
+                ImGui::Separator();
+                const std::vector<FrameGraph::ResourceInfo> &resourceInfos = frameGraph->GetResourceInfos();
+                for (size_t i = 0; i < resourceInfos.size(); ++i)
+                {
+                    const FrameGraph::ResourceInfo &info = resourceInfos[i];
+                    if (info.FirstPass < 0)
+                    {
+                        ImGui::Text("%s: unused", info.Name);
+                    }
+                    else if (info.Imported)
+                    {
+                        ImGui::Text("%s: imported, passes %d-%d", info.Name, info.FirstPass, info.LastPass);
+                    }
+                    else
+                    {
+                        ImGui::Text("%s: %ux%u, passes %d-%d, target %d%s%s", info.Name, info.Desc.Size.x, info.Desc.Size.y,
+                            info.FirstPass, info.LastPass, info.PhysicalTarget, info.Desc.DepthSource != FrameGraph::INVALID_RESOURCE ? ", depth of " : "",
+                            info.Desc.DepthSource != FrameGraph::INVALID_RESOURCE ? resourceInfos[info.Desc.DepthSource].Name : "");
+                    }
+                }
+                ImGui::TreePop();
+            }
         }
         ImGui::End();
         // Rendering
@@ -184,6 +305,17 @@ int main()
         checkOpenGLError();
 
         glfwSwapBuffers(m_Window);
+
+        if (StatusRecorder::StartupTime == 0.0f)
+        {
+            // Compare a cold start (no ShaderCache directory) with a warm one
+            glFinish();
+            StatusRecorder::StartupTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startupBegin).count();
+            std::cout << "Startup to first frame: " << StatusRecorder::StartupTime << " ms, shaders: " << StatusRecorder::ShaderCompileTime << " ms ("
+                      << StatusRecorder::ShaderCacheMisses << " cache misses, " << StatusRecorder::ShaderCompiles << " compiled, "
+                      << StatusRecorder::ShaderBinaryCacheHits << " from binaries)" << std::endl;
+        }
+
         glfwPollEvents();
     }
 
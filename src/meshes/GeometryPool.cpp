@@ -0,0 +1,313 @@
+#include "meshes/GeometryPool.h"
+
+#include <iostream>
+#include <algorithm>
+
+#include "utility/StatusRecorder.h"
+
+std::map<uint32_t, GeometryPool::Ptr> GeometryPool::s_Pools;
+GLuint GeometryPool::s_BoundVertexArray = 0;
+
+GeometryPool::GeometryPool(uint32_t layout, uint32_t vertexCapacity, uint32_t indexCapacity)
+    : m_Layout(layout), m_Stride(3 * sizeof(float)), m_VertexArrayID(0), m_VertexBufferID(0), m_ElementBufferID(0)
+{
+    if (m_Layout & LAYOUT_TANGENT) m_Stride += 4 * sizeof(float);
+    if (m_Layout & LAYOUT_TEXCOORD) m_Stride += 2 * sizeof(float);
+
+    glGenVertexArrays(1, &m_VertexArrayID);
+    Rebuild(vertexCapacity, indexCapacity);
+}
+
+GeometryPool::~GeometryPool()
+{
+    if (s_BoundVertexArray == m_VertexArrayID)
+    {
+        s_BoundVertexArray = 0;
+    }
+
+    glDeleteVertexArrays(1, &m_VertexArrayID);
+    glDeleteBuffers(1, &m_VertexBufferID);
+    glDeleteBuffers(1, &m_ElementBufferID);
+}
+
+GeometryPool::Ptr GeometryPool::GetPool(uint32_t layout)
+{
+    auto it = s_Pools.find(layout);
+    if (it != s_Pools.end())
+    {
+        return it->second;
+    }
+
+    GeometryPool::Ptr pool = GeometryPool::New(layout);
+    s_Pools[layout] = pool;
+    return pool;
+}
+
+uint32_t GeometryPool::Allocate(const float *vertexData, uint32_t vertexCount, const unsigned int *indices, uint32_t indexCount)
+{
+    if (vertexCount == 0)
+    {
+        return INVALID_HANDLE;
+    }
+
+    uint32_t baseVertex = AllocateRange(m_VertexAllocator, vertexCount);
+    if (baseVertex == RangeAllocator::INVALID_OFFSET)
+    {
+        std::cerr << "GeometryPool: Failed to allocate " << vertexCount << " vertices" << std::endl;
+        return INVALID_HANDLE;
+    }
+
+    uint32_t handle;
+    if (!m_FreeHandles.empty())
+    {
+        handle = m_FreeHandles.back();
+        m_FreeHandles.pop_back();
+    }
+    else
+    {
+        handle = static_cast<uint32_t>(m_Allocations.size());
+        m_Allocations.emplace_back();
+    }
+
+    // Registered before the indices are allocated, the pool may be rebuilt by the index allocation and move the vertices
+    Allocation &vertexAllocation = m_Allocations[handle];
+    vertexAllocation.BaseVertex = baseVertex;
+    vertexAllocation.VertexCount = vertexCount;
+    vertexAllocation.FirstIndex = RangeAllocator::INVALID_OFFSET;
+    vertexAllocation.IndexCount = 0;
+    vertexAllocation.Used = true;
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_VertexBufferID);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(baseVertex) * m_Stride, static_cast<GLsizeiptr>(vertexCount) * m_Stride, vertexData);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (indexCount > 0)
+    {
+        uint32_t firstIndex = AllocateRange(m_IndexAllocator, indexCount);
+        if (firstIndex == RangeAllocator::INVALID_OFFSET)
+        {
+            std::cerr << "GeometryPool: Failed to allocate " << indexCount << " indices" << std::endl;
+            Free(handle);
+            return INVALID_HANDLE;
+        }
+
+        Allocation &allocation = m_Allocations[handle];
+        allocation.FirstIndex = firstIndex;
+        allocation.IndexCount = indexCount;
+        UpdateIndices(handle, indices, indexCount);
+    }
+
+    return handle;
+}
+
+void GeometryPool::Free(uint32_t handle)
+{
+    if (handle >= m_Allocations.size() || !m_Allocations[handle].Used)
+    {
+        return;
+    }
+
+    Allocation &allocation = m_Allocations[handle];
+    m_VertexAllocator.Free(allocation.BaseVertex, allocation.VertexCount);
+    if (allocation.IndexCount > 0)
+    {
+        m_IndexAllocator.Free(allocation.FirstIndex, allocation.IndexCount);
+    }
+    allocation.Used = false;
+    m_FreeHandles.push_back(handle);
+
+    if (m_VertexAllocator.GetFreeRangeCount() > MAX_FREE_RANGES || m_IndexAllocator.GetFreeRangeCount() > MAX_FREE_RANGES)
+    {
+        Defragment();
+    }
+}
+
+void GeometryPool::UpdateIndices(uint32_t handle, const unsigned int *indices, uint32_t indexCount)
+{
+    const Allocation &allocation = m_Allocations[handle];
+    if (!allocation.Used || indexCount != allocation.IndexCount)
+    {
+        return;
+    }
+
+    // The copy target is used instead of the element array, whose binding belongs to the bound vertex array
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_ElementBufferID);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(allocation.FirstIndex) * sizeof(unsigned int), static_cast<GLsizeiptr>(indexCount) * sizeof(unsigned int), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GeometryPool::Defragment()
+{
+    Rebuild(m_VertexAllocator.GetCapacity(), m_IndexAllocator.GetCapacity());
+}
+
+void GeometryPool::BindVertexArray(GLuint vertexArrayID)
+{
+    if (s_BoundVertexArray == vertexArrayID)
+    {
+        return;
+    }
+
+    glBindVertexArray(vertexArrayID);
+    s_BoundVertexArray = vertexArrayID;
+    StatusRecorder::VertexArrayBinds++;
+}
+
+void GeometryPool::GetMemoryUsage(size_t &usedBytes, size_t &reservedBytes)
+{
+    usedBytes = 0;
+    reservedBytes = 0;
+    for (auto &pair : s_Pools)
+    {
+        const GeometryPool::Ptr &pool = pair.second;
+        usedBytes += static_cast<size_t>(pool->m_VertexAllocator.GetUsedSize()) * pool->m_Stride + static_cast<size_t>(pool->m_IndexAllocator.GetUsedSize()) * sizeof(unsigned int);
+        reservedBytes += static_cast<size_t>(pool->m_VertexAllocator.GetCapacity()) * pool->m_Stride + static_cast<size_t>(pool->m_IndexAllocator.GetCapacity()) * sizeof(unsigned int);
+    }
+}
+
+uint32_t GeometryPool::AllocateRange(RangeAllocator &allocator, uint32_t size)
+{
+    uint32_t offset = allocator.Allocate(size);
+    if (offset != RangeAllocator::INVALID_OFFSET)
+    {
+        return offset;
+    }
+
+    // Compacting puts all the free space in one range at the end, grow only if that is still too small
+    uint64_t capacity = allocator.GetCapacity();
+    if (allocator.GetFreeSize() < size)
+    {
+        capacity = std::max<uint64_t>(capacity * 2, static_cast<uint64_t>(allocator.GetUsedSize()) + size);
+        if (capacity >= RangeAllocator::INVALID_OFFSET)
+        {
+            return RangeAllocator::INVALID_OFFSET;
+        }
+    }
+
+    if (&allocator == &m_VertexAllocator)
+    {
+        Rebuild(static_cast<uint32_t>(capacity), m_IndexAllocator.GetCapacity());
+    }
+    else
+    {
+        Rebuild(m_VertexAllocator.GetCapacity(), static_cast<uint32_t>(capacity));
+    }
+    return allocator.Allocate(size);
+}
+
+void GeometryPool::Rebuild(uint32_t vertexCapacity, uint32_t indexCapacity)
+{
+    GLuint vertexBufferID = 0;
+    GLuint elementBufferID = 0;
+    glGenBuffers(1, &vertexBufferID);
+    glGenBuffers(1, &elementBufferID);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBufferID);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(vertexCapacity) * m_Stride, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, elementBufferID);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(indexCapacity) * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+
+    // The ranges are copied packed in their current order, on the GPU
+    std::vector<uint32_t> handles;
+    handles.reserve(m_Allocations.size());
+    for (uint32_t i = 0; i < m_Allocations.size(); ++i)
+    {
+        if (m_Allocations[i].Used)
+        {
+            handles.push_back(i);
+        }
+    }
+
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    if (!handles.empty())
+    {
+        std::sort(handles.begin(), handles.end(), [this](uint32_t a, uint32_t b)
+        {
+            return m_Allocations[a].BaseVertex < m_Allocations[b].BaseVertex;
+        });
+
+        glBindBuffer(GL_COPY_READ_BUFFER, m_VertexBufferID);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBufferID);
+        for (uint32_t handle : handles)
+        {
+            Allocation &allocation = m_Allocations[handle];
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(allocation.BaseVertex) * m_Stride,
+                static_cast<GLintptr>(vertexCount) * m_Stride, static_cast<GLsizeiptr>(allocation.VertexCount) * m_Stride);
+            allocation.BaseVertex = vertexCount;
+            vertexCount += allocation.VertexCount;
+        }
+
+        std::sort(handles.begin(), handles.end(), [this](uint32_t a, uint32_t b)
+        {
+            return m_Allocations[a].FirstIndex < m_Allocations[b].FirstIndex;
+        });
+
+        glBindBuffer(GL_COPY_READ_BUFFER, m_ElementBufferID);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, elementBufferID);
+        for (uint32_t handle : handles)
+        {
+            Allocation &allocation = m_Allocations[handle];
+            if (allocation.IndexCount == 0)
+            {
+                continue;
+            }
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(allocation.FirstIndex) * sizeof(unsigned int),
+                static_cast<GLintptr>(indexCount) * sizeof(unsigned int), static_cast<GLsizeiptr>(allocation.IndexCount) * sizeof(unsigned int));
+            allocation.FirstIndex = indexCount;
+            indexCount += allocation.IndexCount;
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (m_VertexBufferID)
+    {
+        glDeleteBuffers(1, &m_VertexBufferID);
+        glDeleteBuffers(1, &m_ElementBufferID);
+    }
+    m_VertexBufferID = vertexBufferID;
+    m_ElementBufferID = elementBufferID;
+
+    // The packed ranges are one allocation at the front, the allocator does not track the ranges one by one
+    m_VertexAllocator.Reset(vertexCapacity);
+    m_IndexAllocator.Reset(indexCapacity);
+    if (vertexCount > 0)
+    {
+        m_VertexAllocator.Allocate(vertexCount);
+    }
+    if (indexCount > 0)
+    {
+        m_IndexAllocator.Allocate(indexCount);
+    }
+
+    SetupVertexArray();
+    StatusRecorder::GeometryPoolRebuilds++;
+}
+
+void GeometryPool::SetupVertexArray()
+{
+    BindVertexArray(m_VertexArrayID);
+    glBindBuffer(GL_ARRAY_BUFFER, m_VertexBufferID);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ElementBufferID);
+
+    size_t offset = 0;
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, m_Stride, (GLvoid*)offset);
+    offset += 3 * sizeof(float);
+
+    if (m_Layout & LAYOUT_TANGENT)
+    {
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, m_Stride, (GLvoid*)offset);
+        offset += 4 * sizeof(float);
+    }
+
+    if (m_Layout & LAYOUT_TEXCOORD)
+    {
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, m_Stride, (GLvoid*)offset);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
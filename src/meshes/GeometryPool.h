@@ -0,0 +1,91 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <glad/glad.h>
+
+#include "ptr.h"
+#include "utility/RangeAllocator.h"
+
+// Vertex and index buffers shared by all the meshes of one vertex layout, with a single vertex array.
+// A mesh is a range of vertices and a range of indices in the pool, the indices are relative to the first vertex of the mesh
+// and it is drawn with glDrawElementsBaseVertex, so the draws of different meshes do not switch the vertex array.
+// When a request does not fit, the pool is compacted if that frees enough space, otherwise the buffers grow.
+class GeometryPool
+{
+    SHARED_PTR(GeometryPool)
+public:
+    // Attributes interleaved after the position
+    enum LayoutBits : uint32_t
+    {
+        LAYOUT_TANGENT = 1 << 0,  // vec4 at location 1
+        LAYOUT_TEXCOORD = 1 << 1, // vec2 at location 2
+    };
+
+    static constexpr uint32_t INVALID_HANDLE = 0xFFFFFFFFu;
+    static constexpr uint32_t DEFAULT_VERTEX_CAPACITY = 64 * 1024;
+    static constexpr uint32_t DEFAULT_INDEX_CAPACITY = 192 * 1024;
+    // Freeing a range which splits the free space more than this compacts the pool
+    static constexpr size_t MAX_FREE_RANGES = 256;
+
+    struct Allocation
+    {
+        uint32_t BaseVertex;
+        uint32_t VertexCount;
+        uint32_t FirstIndex;
+        uint32_t IndexCount;
+        bool Used;
+    };
+
+    GeometryPool(uint32_t layout, uint32_t vertexCapacity = DEFAULT_VERTEX_CAPACITY, uint32_t indexCapacity = DEFAULT_INDEX_CAPACITY);
+    ~GeometryPool();
+
+    // The pool of a layout is created the first time a mesh needs it
+    static GeometryPool::Ptr GetPool(uint32_t layout);
+
+    // The vertex data is interleaved as described by the layout, returns a handle which stays valid until it is freed
+    uint32_t Allocate(const float *vertexData, uint32_t vertexCount, const unsigned int *indices, uint32_t indexCount);
+    void Free(uint32_t handle);
+    // Overwrite the indices of an allocation with the same number of indices
+    void UpdateIndices(uint32_t handle, const unsigned int *indices, uint32_t indexCount);
+
+    inline const Allocation& GetAllocation(uint32_t handle) const { return m_Allocations[handle]; }
+
+    // Move the allocations to the front of the buffers, the handles stay valid
+    void Defragment();
+
+    inline void Bind() { BindVertexArray(m_VertexArrayID); }
+    inline GLuint GetVertexArrayID() const { return m_VertexArrayID; }
+    inline uint32_t GetLayout() const { return m_Layout; }
+    inline GLsizei GetStride() const { return m_Stride; }
+
+    // Bind a vertex array unless it is the bound one, every vertex array bind of the renderer goes through here
+    static void BindVertexArray(GLuint vertexArrayID);
+
+    static size_t GetPoolCount() { return s_Pools.size(); }
+    // Bytes of the vertex and index data in use and of the buffers, summed over all the pools
+    static void GetMemoryUsage(size_t &usedBytes, size_t &reservedBytes);
+
+private:
+    uint32_t AllocateRange(RangeAllocator &allocator, uint32_t size);
+    // Copy the allocations packed into new buffers of the given capacities
+    void Rebuild(uint32_t vertexCapacity, uint32_t indexCapacity);
+    void SetupVertexArray();
+
+    static std::map<uint32_t, GeometryPool::Ptr> s_Pools;
+    static GLuint s_BoundVertexArray;
+
+    uint32_t m_Layout;
+    GLsizei m_Stride;
+
+    GLuint m_VertexArrayID;
+    GLuint m_VertexBufferID;
+    GLuint m_ElementBufferID;
+
+    RangeAllocator m_VertexAllocator;
+    RangeAllocator m_IndexAllocator;
+
+    std::vector<Allocation> m_Allocations;
+    std::vector<uint32_t> m_FreeHandles;
+};
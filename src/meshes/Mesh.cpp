@@ -1,7 +1,10 @@
 #include "meshes/Mesh.h"
 
+#include <algorithm>
+
+uint32_t Mesh::s_NextMeshID = 1;
+
 Mesh::Mesh(const std::vector<vec3> &vertices, const std::vector<vec4> &tangents, const std::vector<vec2> &texcoords0, const std::vector<unsigned int> &indices)
-    : m_VertexArrayID(0), m_VertexBufferID(0), m_ElementBufferID(0)
 {
     m_Vertices = vertices;
 //    m_Normals = normals;
@@ -13,20 +16,14 @@ Mesh::Mesh(const std::vector<vec3> &vertices, const std::vector<vec4> &tangents,
 
 Mesh::~Mesh()
 {
-    if (m_VertexArrayID)
+    if (m_Pool)
     {
-        glDeleteVertexArrays(1, &m_VertexArrayID);
-        glDeleteBuffers(1, &m_VertexBufferID);
-        glDeleteBuffers(1, &m_ElementBufferID);
+        m_Pool->Free(m_PoolHandle);
     }
 }
 
 void Mesh::InitMesh(const std::vector<vec3> &vertices, const std::vector<unsigned int> &indices)
 {
-    m_VertexArrayID = 0;
-    m_VertexBufferID = 0;
-    m_ElementBufferID = 0;
-
     m_Vertices = vertices;
     m_Indices = indices;
 
@@ -35,13 +32,17 @@ void Mesh::InitMesh(const std::vector<vec3> &vertices, const std::vector<unsigne
 
 void Mesh::InitBuffers()
 {
-    if (!m_VertexArrayID)
+    if (m_Pool)
     {
-        glGenVertexArrays(1, &m_VertexArrayID);
-        glGenBuffers(1, &m_VertexBufferID);
-        glGenBuffers(1, &m_ElementBufferID);
+        m_Pool->Free(m_PoolHandle);
+        m_Pool = nullptr;
+        m_PoolHandle = GeometryPool::INVALID_HANDLE;
     }
 
+    uint32_t layout = 0;
+    if (m_Tangents.size() > 0) layout |= GeometryPool::LAYOUT_TANGENT;
+    if (m_Texcoords.size() > 0) layout |= GeometryPool::LAYOUT_TEXCOORD;
+
     std::vector<float> data;
     for (int i = 0; i < m_Vertices.size(); ++i)
     {
@@ -71,46 +72,120 @@ void Mesh::InitBuffers()
         }
     }
 
-    glBindVertexArray(m_VertexArrayID);
-    glBindBuffer(GL_ARRAY_BUFFER, m_VertexBufferID);
-    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), &data[0], GL_STATIC_DRAW);
+    if (m_Vertices.empty())
+    {
+        return;
+    }
+
+    m_Pool = GeometryPool::GetPool(layout);
+    m_PoolHandle = m_Pool->Allocate(data.data(), static_cast<uint32_t>(m_Vertices.size()), m_Indices.data(), static_cast<uint32_t>(m_Indices.size()));
+    if (m_PoolHandle == GeometryPool::INVALID_HANDLE)
+    {
+        m_Pool = nullptr;
+    }
+}
+
+void Mesh::Draw(uint32_t indexOffset, uint32_t indexCount)
+{
+    if (!m_Pool)
+    {
+        return;
+    }
+
+    m_Pool->Bind();
+    const GeometryPool::Allocation &allocation = m_Pool->GetAllocation(m_PoolHandle);
+    if (allocation.IndexCount > 0)
+    {
+        GLsizei count = static_cast<GLsizei>(indexCount > 0 ? indexCount : allocation.IndexCount);
+        size_t firstIndex = static_cast<size_t>(allocation.FirstIndex) + indexOffset;
+        glDrawElementsBaseVertex(GL_TRIANGLES, count, GL_UNSIGNED_INT, (GLvoid*)(firstIndex * sizeof(unsigned int)), static_cast<GLint>(allocation.BaseVertex));
+    }
+    else
+    {
+        glDrawArrays(GL_TRIANGLES, static_cast<GLint>(allocation.BaseVertex), static_cast<GLsizei>(allocation.VertexCount));
+    }
+}
+
+void Mesh::DrawInstanced(uint32_t instanceCount)
+{
+    if (!m_Pool)
+    {
+        return;
+    }
 
-    if (m_Indices.size() > 0)
+    m_Pool->Bind();
+    const GeometryPool::Allocation &allocation = m_Pool->GetAllocation(m_PoolHandle);
+    if (allocation.IndexCount > 0)
     {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ElementBufferID);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_Indices.size() * sizeof(unsigned int), &m_Indices[0], GL_STATIC_DRAW);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(allocation.IndexCount), GL_UNSIGNED_INT,
+            (GLvoid*)(static_cast<size_t>(allocation.FirstIndex) * sizeof(unsigned int)), static_cast<GLsizei>(instanceCount), static_cast<GLint>(allocation.BaseVertex));
     }
+    else
+    {
+        glDrawArraysInstanced(GL_TRIANGLES, static_cast<GLint>(allocation.BaseVertex), static_cast<GLsizei>(allocation.VertexCount), static_cast<GLsizei>(instanceCount));
+    }
+}
 
-    GLsizei stride = 3 * sizeof(float);
-//    if (m_Normals.size() > 0) stride += 3 * sizeof(float);
-    if (m_Tangents.size() > 0) stride += 4 * sizeof(float);
-    if (m_Texcoords.size() > 0) stride += 2 * sizeof(float);
+void Mesh::SortTrianglesBackToFront(const vec3 &eyeInModelSpace)
+{
+    size_t triangleCount = m_Indices.size() / 3;
+    if (triangleCount < 2 || !m_Pool || eyeInModelSpace == m_LastSortEye)
+    {
+        return;
+    }
+    m_LastSortEye = eyeInModelSpace;
 
-    size_t offset = 0;
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offset);
-    offset += 3 * sizeof(float);
+    m_TriangleDistances.resize(triangleCount);
+    for (size_t i = 0; i < triangleCount; ++i)
+    {
+        const unsigned int *triangle = &m_Indices[i * 3];
+        vec3 centroid = (m_Vertices[triangle[0]] + m_Vertices[triangle[1]] + m_Vertices[triangle[2]]) * (1.0f / 3.0f);
+        vec3 toEye = centroid - eyeInModelSpace;
+        m_TriangleDistances[i].Distance = dot(toEye, toEye);
+        m_TriangleDistances[i].Triangle = static_cast<uint32_t>(i);
+    }
 
-//    if (m_Normals.size() > 0)
-//    {
-//        glEnableVertexAttribArray(1);
-//        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid *)offset);
-//         offset += 3 * sizeof(float);
-//    }
+    std::sort(m_TriangleDistances.begin(), m_TriangleDistances.end(), [](const TriangleDistance &a, const TriangleDistance &b)
+    {
+        return a.Distance > b.Distance;
+    });
 
-    if (m_Tangents.size() > 0)
+    m_SortedIndices.resize(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount; ++i)
     {
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid *)offset);
-         offset += 4 * sizeof(float);
+        const unsigned int *triangle = &m_Indices[m_TriangleDistances[i].Triangle * 3];
+        m_SortedIndices[i * 3 + 0] = triangle[0];
+        m_SortedIndices[i * 3 + 1] = triangle[1];
+        m_SortedIndices[i * 3 + 2] = triangle[2];
     }
-    
-    if (m_Texcoords.size() > 0)
+
+    m_Pool->UpdateIndices(m_PoolHandle, m_SortedIndices.data(), static_cast<uint32_t>(m_SortedIndices.size()));
+}
+
+void Mesh::BindInstanceAttributes(GLuint instanceBufferID, size_t offset, GLsizei stride)
+{
+    if (!m_Pool)
     {
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offset);
-//        offset += 2 * sizeof(float);
+        return;
     }
 
-    glBindVertexArray(0);
+    // The attributes are set on the vertex array of the pool, for the meshes of the pool drawn next
+    m_Pool->Bind();
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+
+    // A matrix attribute takes one location per column
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        glEnableVertexAttribArray(3 + column);
+        glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(offset + column * sizeof(vec4)));
+        glVertexAttribDivisor(3 + column, 1);
+    }
+    offset += sizeof(mat4);
+    for (GLuint column = 0; column < 3; ++column)
+    {
+        glEnableVertexAttribArray(7 + column);
+        glVertexAttribPointer(7 + column, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(offset + column * sizeof(vec3)));
+        glVertexAttribDivisor(7 + column, 1);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <vector>
+#include <limits>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <glad/glad.h>
 
 #include "ptr.h"
+#include "meshes/GeometryPool.h"
 
 using namespace glm;
 
@@ -18,18 +21,54 @@ public:
 
     void InitMesh(const std::vector<vec3> &vertices, const std::vector<unsigned int> &indices);
 
-    inline GLuint GetVertexArrayID() { return m_VertexArrayID; }
+    // The vertex array of the geometry pool, shared with the other meshes of the same layout
+    inline GLuint GetVertexArrayID() { return m_Pool ? m_Pool->GetVertexArrayID() : 0; }
+    // Unique id of the mesh, used in the sort key of the draws
+    inline uint32_t GetMeshID() const { return m_MeshID; }
     inline GLsizei GetIndicesCount() { return static_cast<GLsizei>(m_Indices.size()); }
     inline GLsizei GetVerticesCount() { return static_cast<GLsizei>(m_Vertices.size()); }
 
+    // CPU copies of the vertex data, the tangents hold the TBN quaternions
+    const std::vector<vec3>& GetVertices() const { return m_Vertices; }
+    const std::vector<vec4>& GetTangents() const { return m_Tangents; }
+    const std::vector<vec2>& GetTexcoords() const { return m_Texcoords; }
+    const std::vector<unsigned int>& GetIndices() const { return m_Indices; }
+
+    // Reorder the triangles from the farthest to the nearest to the eye, for blended meshes that overlap themselves.
+    // The eye is in model space, the index buffer is only uploaded again if the eye moved. The order is stored in the mesh,
+    // so it only suits a mesh drawn once per frame.
+    void SortTrianglesBackToFront(const vec3 &eyeInModelSpace);
+
+    // Draw the whole mesh, or the index range if indexCount is not 0, from the vertex array of the pool
+    void Draw(uint32_t indexOffset = 0, uint32_t indexCount = 0);
+    void DrawInstanced(uint32_t instanceCount);
+
+    // Point the per-instance attributes (mat4 at locations 3-6, mat3 at 7-9) of the vertex array to an instance buffer
+    void BindInstanceAttributes(GLuint instanceBufferID, size_t offset, GLsizei stride);
+
 private:
     void InitBuffers();
 
-    GLuint m_VertexArrayID, m_VertexBufferID, m_ElementBufferID;
+    struct TriangleDistance
+    {
+        float Distance;
+        uint32_t Triangle;
+    };
+
+    GeometryPool::Ptr m_Pool;
+    uint32_t m_PoolHandle = GeometryPool::INVALID_HANDLE;
+    uint32_t m_MeshID = s_NextMeshID++;
+
+    static uint32_t s_NextMeshID;
 
     std::vector<vec3> m_Vertices;
 //    std::vector<vec3> m_Normals;
     std::vector<vec4> m_Tangents;
     std::vector<vec2> m_Texcoords;
     std::vector<unsigned int> m_Indices;
+
+    // Scratch buffers of the triangle sort, only allocated for the meshes that are sorted
+    std::vector<TriangleDistance> m_TriangleDistances;
+    std::vector<unsigned int> m_SortedIndices;
+    vec3 m_LastSortEye = vec3(std::numeric_limits<float>::max());
 };
@@ -2,9 +2,10 @@
 
 #include <assert.h>
 
+#include "meshes/GeometryPool.h"
+
 GLuint Blitter::BlitVAO = 0;
 Material::Ptr Blitter::DefaultBlitMat = nullptr;
-Material::Ptr Blitter::CopyDepthMat = nullptr;
 
 void Blitter::BlitCameraTexture(const Texture2D::Ptr sourceTex, const RenderTarget::Ptr destination, Material::Ptr material)
 {
@@ -74,18 +75,6 @@ void Blitter::RenderToTarget(const RenderTarget::Ptr target, const Material::Ptr
     target->UnbindTarget();
 }
 
-void Blitter::CopyDepth(const RenderTarget::Ptr source, const RenderTarget::Ptr destination)
-{
-    destination->BindTarget(false, true);
-
-    CopyDepthMat->AddOrSetTexture(source->GetDepthTexture());
-    CopyDepthMat->Use();
-
-    DrawFullScreenTriangle();
-    
-    destination->UnbindTarget();
-}
-
 void Blitter::BlitDepth(const RenderTarget::Ptr source, const RenderTarget::Ptr destination)
 {
     glBindFramebuffer(GL_READ_FRAMEBUFFER, source->GetFrameBufferID());
@@ -108,21 +97,16 @@ void Blitter::Init()
     {
         DefaultBlitMat = Material::New("Blit", "utils/FullScreenTriangle.vs", "utils/BlitColor.fs");
     }
-    
-    if (CopyDepthMat == nullptr)
-    {
-        CopyDepthMat = Material::New("Blit Depth", "utils/FullScreenTriangle.vs", "utils/CopyDepth.fs");
-    }
 }
 
 void Blitter::Cleanup()
 {
+    GeometryPool::BindVertexArray(0);
     glDeleteVertexArrays(1, &BlitVAO);
 }
 
 void Blitter::DrawFullScreenTriangle()
 {
-    glBindVertexArray(BlitVAO);
+    GeometryPool::BindVertexArray(BlitVAO);
     glDrawArrays(GL_TRIANGLES, 0, 3);
-    glBindVertexArray(0);
 }
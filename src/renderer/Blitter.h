@@ -17,7 +17,6 @@ public:
 
     static void RenderToTarget(const RenderTarget::Ptr target, const Material::Ptr material, const bool &clearColor = true, const bool &clearDepth = true);
 
-    static void CopyDepth(const RenderTarget::Ptr source, const RenderTarget::Ptr destination);
     static void BlitDepth(const RenderTarget::Ptr source, const RenderTarget::Ptr destination);
 
     static void Init();
@@ -29,5 +28,4 @@ private:
 
     static GLuint BlitVAO;
     static Material::Ptr DefaultBlitMat;
-    static Material::Ptr CopyDepthMat;
 };
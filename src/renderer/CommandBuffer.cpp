@@ -1,5 +1,7 @@
 #include "CommandBuffer.h"
 
+#include <algorithm>
+
 CommandBuffer::~CommandBuffer()
 {
     Clear();
@@ -11,14 +13,21 @@ void CommandBuffer::Clear()
     m_SkyboxCommands.clear();
     m_TransparentCommands.clear();
     m_DebuggingCommands.clear();
+    m_DebuggingMeshes.clear();
+
+    m_OpaqueBatches.clear();
+    m_InstanceData.clear();
+
+    m_Arena.Reset();
 }
 
-void CommandBuffer::PushCommand(Mesh::Ptr mesh, Material::Ptr mat, glm::mat4 transform)
+RenderCommand* CommandBuffer::PushCommand(Mesh* mesh, Material* mat, const glm::mat4 &transform, const glm::mat3 &normalMatrix)
 {
-    RenderCommand::Ptr cmd = RenderCommand::New();
+    RenderCommand* cmd = m_Arena.New<RenderCommand>();
     cmd->Mesh = mesh;
     cmd->Material = mat;
     cmd->Transform = transform;
+    cmd->NormalMatrix = normalMatrix;
 
     if (mat->IsUsedForSkybox())
     {
@@ -35,54 +44,186 @@ void CommandBuffer::PushCommand(Mesh::Ptr mesh, Material::Ptr mat, glm::mat4 tra
             m_OpaqueCommands.push_back(cmd);
         }
     }
+    return cmd;
 }
 
-void CommandBuffer::PushDebuggingCommand(Mesh::Ptr mesh, Material::Ptr mat, glm::mat4 transform)
+void CommandBuffer::PushDebuggingCommand(Mesh::Ptr mesh, Material* mat, const glm::mat4 &transform)
 {
-    RenderCommand::Ptr cmd = RenderCommand::New();
-    cmd->Mesh = mesh;
+    RenderCommand* cmd = m_Arena.New<RenderCommand>();
+    cmd->Mesh = mesh.get();
     cmd->Material = mat;
     cmd->Transform = transform;
 
     m_DebuggingCommands.push_back(cmd);
+    m_DebuggingMeshes.push_back(mesh);
 }
 
-std::vector<RenderCommand::Ptr>& CommandBuffer::GetOpaqueCommands()
+void CommandBuffer::SortOpaqueCommands(const glm::mat4 &view, float farPlane)
 {
-    return m_OpaqueCommands;
+    for (size_t i = 0; i < m_OpaqueCommands.size(); ++i)
+    {
+        m_OpaqueCommands[i]->SortKey = BuildOpaqueSortKey(m_OpaqueCommands[i], view, farPlane);
+    }
+    RadixSortCommands(m_OpaqueCommands);
 }
 
-std::vector<RenderCommand::Ptr>& CommandBuffer::GetSkyboxCommands()
+void CommandBuffer::SortTransparentCommands(const glm::mat4 &view, float farPlane)
 {
-    return m_SkyboxCommands;
+    for (size_t i = 0; i < m_TransparentCommands.size(); ++i)
+    {
+        m_TransparentCommands[i]->SortKey = BuildTransparentSortKey(m_TransparentCommands[i], view, farPlane);
+    }
+    RadixSortCommands(m_TransparentCommands);
 }
 
-std::vector<RenderCommand::Ptr>& CommandBuffer::GetTransparentCommands()
+uint64_t CommandBuffer::GetStateBits(Material *mat)
 {
-    return m_TransparentCommands;
+    uint64_t program = static_cast<uint64_t>(mat->GetShader()->GetProgramID()) & 0xFFF;
+    uint32_t textureSet = mat->GetTextureSetKey();
+    uint64_t textures = static_cast<uint64_t>((textureSet ^ (textureSet >> 12) ^ (textureSet >> 24)) & 0xFFF);
+    uint64_t material = static_cast<uint64_t>(mat->GetMaterialID()) & 0xFFF;
+
+    return (program << 24) | (textures << 12) | material;
 }
 
-std::vector<RenderCommand::Ptr> CommandBuffer::GetShadowCasterCommands()
+uint64_t CommandBuffer::QuantizeViewDepth(const RenderCommand *command, const glm::mat4 &view, float farPlane)
 {
-    std::vector<RenderCommand::Ptr> commands;
-    for (size_t i = 0; i < m_OpaqueCommands.size(); ++i)
+    glm::vec3 position = command->HasWorldBounds ? command->WorldBounds.Center : glm::vec3(command->Transform[3]);
+    // The camera looks down -Z in view space
+    float viewDepth = -(view * glm::vec4(position, 1.0f)).z;
+
+    float depth = glm::clamp(viewDepth / farPlane, 0.0f, 1.0f);
+    return static_cast<uint64_t>(depth * static_cast<float>(0xFFFFFF));
+}
+
+uint64_t CommandBuffer::BuildOpaqueSortKey(const RenderCommand *command, const glm::mat4 &view, float farPlane)
+{
+    Material* mat = command->Material;
+
+    // Alpha tested draws go after the solid ones, so they do not break early depth rejection of the others
+    uint64_t pass = mat->GetAlphaMode() == Material::AlphaMode::MASK ? 1 : 0;
+    uint64_t face = static_cast<uint64_t>(mat->GetRenderFace()) & 0x3;
+    uint64_t mesh = static_cast<uint64_t>(command->Mesh->GetMeshID()) & 0xFF;
+    uint64_t depth = command->IndexCount > 0 ? 0 : QuantizeViewDepth(command, view, farPlane) >> 8;
+
+    return (pass << 62) | (face << 60) | (GetStateBits(mat) << 24) | (mesh << 16) | depth;
+}
+
+uint64_t CommandBuffer::BuildTransparentSortKey(const RenderCommand *command, const glm::mat4 &view, float farPlane)
+{
+    uint64_t invertedDepth = 0xFFFFFF - QuantizeViewDepth(command, view, farPlane);
+
+    return (invertedDepth << 40) | (GetStateBits(command->Material) << 4);
+}
+
+void CommandBuffer::BuildOpaqueBatches(bool instancing)
+{
+    m_OpaqueBatches.clear();
+    m_InstanceData.clear();
+
+    BuildBatches(m_OpaqueCommands.data(), m_OpaqueCommands.size(), instancing, true, m_OpaqueBatches, m_InstanceData);
+}
+
+void CommandBuffer::BuildBatches(const RenderCommand* const *commands, size_t count, bool instancing, bool matchMaterial, std::vector<RenderBatch> &outBatches, std::vector<InstanceData> &outInstances)
+{
+    size_t runBegin = 0;
+    while (runBegin < count)
     {
-        if (m_OpaqueCommands[i]->Material->GetMaterialCastShadows())
+        const RenderCommand* first = commands[runBegin];
+
+        RenderBatch batch;
+        batch.Command = first;
+        batch.InstanceCount = 1;
+        batch.FirstInstance = static_cast<uint32_t>(outInstances.size());
+        batch.IndexOffset = first->IndexOffset;
+        batch.IndexCount = first->IndexCount;
+
+        size_t runEnd = runBegin + 1;
+        if (first->IndexCount > 0)
         {
-            commands.push_back(m_OpaqueCommands[i]);
+            // A range only shares its mesh with the other ranges of the same merged mesh, so they have the same transform
+            while (runEnd < count && commands[runEnd]->Mesh == first->Mesh && (!matchMaterial || commands[runEnd]->Material == first->Material) &&
+                   commands[runEnd]->IndexOffset == batch.IndexOffset + batch.IndexCount)
+            {
+                batch.IndexCount += commands[runEnd]->IndexCount;
+                ++runEnd;
+            }
         }
-    }
-    for (size_t i = 0; i < m_TransparentCommands.size(); ++i)
-    {
-        if (m_TransparentCommands[i]->Material->GetMaterialCastShadows())
+        else if (instancing)
         {
-            commands.push_back(m_TransparentCommands[i]);
+            while (runEnd < count && commands[runEnd]->Mesh == first->Mesh && (!matchMaterial || commands[runEnd]->Material == first->Material) &&
+                   commands[runEnd]->IndexCount == 0)
+            {
+                ++runEnd;
+            }
+
+            batch.InstanceCount = static_cast<uint32_t>(runEnd - runBegin);
+            if (batch.InstanceCount > 1)
+            {
+                for (size_t i = runBegin; i < runEnd; ++i)
+                {
+                    InstanceData instance;
+                    instance.ModelToWorld = commands[i]->Transform;
+                    instance.ModelNormalToWorld = commands[i]->NormalMatrix;
+                    outInstances.push_back(instance);
+                }
+            }
         }
+        outBatches.push_back(batch);
+
+        runBegin = runEnd;
     }
-    return commands;
 }
 
-std::vector<RenderCommand::Ptr>& CommandBuffer::GetDebuggingCommands()
+void CommandBuffer::RadixSortCommands(std::vector<RenderCommand*> &commands)
 {
-    return m_DebuggingCommands;
+    size_t count = commands.size();
+    if (count < 2)
+    {
+        return;
+    }
+
+    m_SortItems.resize(count);
+    m_SortScratch.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        m_SortItems[i].Key = commands[i]->SortKey;
+        m_SortItems[i].Command = commands[i];
+    }
+
+    SortItem* src = m_SortItems.data();
+    SortItem* dst = m_SortScratch.data();
+    for (uint32_t shift = 0; shift < 64; shift += 8)
+    {
+        size_t offsets[256] = { 0 };
+        for (size_t i = 0; i < count; ++i)
+        {
+            ++offsets[(src[i].Key >> shift) & 0xFF];
+        }
+
+        // All the keys share this byte, the pass would not move anything
+        if (offsets[(src[0].Key >> shift) & 0xFF] == count)
+        {
+            continue;
+        }
+
+        size_t sum = 0;
+        for (size_t i = 0; i < 256; ++i)
+        {
+            size_t bucketCount = offsets[i];
+            offsets[i] = sum;
+            sum += bucketCount;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            dst[offsets[(src[i].Key >> shift) & 0xFF]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        commands[i] = src[i].Command;
+    }
 }
@@ -4,6 +4,7 @@
 
 #include "ptr.h"
 #include "renderer/RenderCommand.h"
+#include "utility/FrameArena.h"
 
 class CommandBuffer
 {
@@ -12,20 +13,70 @@ public:
     CommandBuffer() = default;
     ~CommandBuffer();
 
-    void PushCommand(Mesh::Ptr mesh, Material::Ptr mat, glm::mat4 transform = glm::mat4(1.0f));
-    void PushDebuggingCommand(Mesh::Ptr mesh, Material::Ptr mat, glm::mat4 transform = glm::mat4(1.0f));
+    // The returned command lives until the next Clear()
+    RenderCommand* PushCommand(Mesh* mesh, Material* mat, const glm::mat4 &transform = glm::mat4(1.0f), const glm::mat3 &normalMatrix = glm::mat3(1.0f));
+    // Debugging meshes are usually created for one frame, so the buffer keeps them alive until the next Clear()
+    void PushDebuggingCommand(Mesh::Ptr mesh, Material* mat, const glm::mat4 &transform = glm::mat4(1.0f));
     void Clear();
 
-    std::vector<RenderCommand::Ptr>& GetOpaqueCommands();
-    std::vector<RenderCommand::Ptr>& GetSkyboxCommands();
-    std::vector<RenderCommand::Ptr>& GetTransparentCommands();
-    std::vector<RenderCommand::Ptr> GetShadowCasterCommands();
-    std::vector<RenderCommand::Ptr>& GetDebuggingCommands();
+    // Sort the opaque commands by state first and front-to-back inside a state, the view depth is normalized by the far plane
+    void SortOpaqueCommands(const glm::mat4 &view, float farPlane);
+    // Sort the transparent commands back-to-front, blending is only right in this order
+    void SortTransparentCommands(const glm::mat4 &view, float farPlane);
+
+    // Collapse the runs of opaque commands with the same mesh and material into instanced batches.
+    // Without instancing every command gets its own batch. The instance data is rebuilt by every call.
+    void BuildOpaqueBatches(bool instancing);
+
+    // Batch the runs of commands sharing the mesh, and the material if matchMaterial is set.
+    // Adjacent index ranges of a mesh are merged into one range, the other runs are instanced if instancing is set.
+    static void BuildBatches(const RenderCommand* const *commands, size_t count, bool instancing, bool matchMaterial, std::vector<RenderBatch> &outBatches, std::vector<InstanceData> &outInstances);
+
+    // The buckets only hold pointers into the frame arena, their capacity is reused across frames
+    const std::vector<RenderCommand*>& GetOpaqueCommands() const { return m_OpaqueCommands; }
+    const std::vector<RenderCommand*>& GetSkyboxCommands() const { return m_SkyboxCommands; }
+    const std::vector<RenderCommand*>& GetTransparentCommands() const { return m_TransparentCommands; }
+    const std::vector<RenderCommand*>& GetDebuggingCommands() const { return m_DebuggingCommands; }
+
+    const std::vector<RenderBatch>& GetOpaqueBatches() const { return m_OpaqueBatches; }
+    const std::vector<InstanceData>& GetInstanceData() const { return m_InstanceData; }
 
 private:
-    std::vector<RenderCommand::Ptr> m_OpaqueCommands;
-    std::vector<RenderCommand::Ptr> m_SkyboxCommands;
-    std::vector<RenderCommand::Ptr> m_TransparentCommands;
+    // Opaque sort key layout, from the most significant bit:
+    // pass (2) | render face (2) | shader program (12) | texture set (12) | material (12) | mesh (8) | view depth (16)
+    // The mesh comes before the depth so the instances of a mesh end up next to each other.
+    // Index ranges of a mesh have no depth, the stable sort keeps them in the pushed order so adjacent ranges can be merged
+    static uint64_t BuildOpaqueSortKey(const RenderCommand *command, const glm::mat4 &view, float farPlane);
+    // Transparent sort key layout, depth first so the blending order is right:
+    // inverted view depth (24) | shader program (12) | texture set (12) | material (12) | unused (4)
+    static uint64_t BuildTransparentSortKey(const RenderCommand *command, const glm::mat4 &view, float farPlane);
+    // Program, texture set and material packed in 36 bits
+    static uint64_t GetStateBits(Material *mat);
+    // View depth of the command in [0, 2^24 - 1]
+    static uint64_t QuantizeViewDepth(const RenderCommand *command, const glm::mat4 &view, float farPlane);
+
+    // Stable LSD radix sort of the commands by their SortKey, 8 bits per pass
+    void RadixSortCommands(std::vector<RenderCommand*> &commands);
+
+    struct SortItem
+    {
+        uint64_t Key;
+        RenderCommand* Command;
+    };
+
+    FrameArena m_Arena;
+
+    std::vector<RenderCommand*> m_OpaqueCommands;
+    std::vector<RenderCommand*> m_SkyboxCommands;
+    std::vector<RenderCommand*> m_TransparentCommands;
+
+    std::vector<RenderCommand*> m_DebuggingCommands;
+    std::vector<Mesh::Ptr> m_DebuggingMeshes;
+
+    // Ping-pong buffers of the radix sort, kept across frames
+    std::vector<SortItem> m_SortItems;
+    std::vector<SortItem> m_SortScratch;
 
-    std::vector<RenderCommand::Ptr> m_DebuggingCommands;
+    std::vector<RenderBatch> m_OpaqueBatches;
+    std::vector<InstanceData> m_InstanceData;
 };
@@ -1,5 +1,9 @@
 #include "renderer/DirectionalLightShadowMap.h"
 #include "utility/Collision.h"
+#include "utility/StatusRecorder.h"
+
+#include <chrono>
+#include <algorithm>
 
 #include <glm/gtc/type_ptr.hpp>
 
@@ -9,6 +13,7 @@ DirectionalLightShadowMap::DirectionalLightShadowMap()
     : m_UseCascadeShadowMaps(false), m_CascadeParams(vec4(0.0f))
 {
     m_DirectionalShadowCasterMat = Material::New("DirectionalShadowCaster", "shadows/ShadowCaster.vs", "shadows/ShadowCaster.fs");
+    m_InstanceBuffer = InstanceBuffer::New();
     m_MatShadowProjections.resize(MAX_CASCADES, mat4(1.0f));
     m_CascadeScalesAndOffsets.resize(MAX_CASCADES, vec4(1.0f, 1.0f, 0.0f, 0.0f));
 }
@@ -18,7 +23,7 @@ void DirectionalLightShadowMap::SetCascadeShadowMapsEnabled(const bool &enabled)
     m_UseCascadeShadowMaps = enabled;
 }
 
-void DirectionalLightShadowMap::RenderShadowMap(const Camera::Ptr viewCamera, const DirectionalLight::Ptr light, const std::vector<RenderCommand::Ptr> &shadowCasterCommands, const SceneNode::Ptr scene)
+void DirectionalLightShadowMap::RenderShadowMap(const Camera::Ptr viewCamera, const DirectionalLight::Ptr light, const std::vector<RenderCommand> &shadowCasterCommands, const BoundingVolumeHierarchy &casterBVH, const SceneNode::Ptr scene, const DrawUniformBuffer::Ptr drawUniforms)
 {
     m_LightCamera = Camera::New(light->GetLightPosition(), vec3(0.0f), vec3(0.0f, 1.0f, 0.0f));
     mat4 viewCameraProjection = viewCamera->GetProjectionMatrix();
@@ -30,7 +35,10 @@ void DirectionalLightShadowMap::RenderShadowMap(const Camera::Ptr viewCamera, co
     glPolygonOffset(1.1f, 4.0f);
 
     light->GetShadowMapRT()->BindTarget(false, true);
-    m_DirectionalShadowCasterMat->Use();
+
+    StatusRecorder::ShadowCasterDrawCount = 0;
+    StatusRecorder::ShadowCasterCulledCount = 0;
+    StatusRecorder::InstancedShadowBatchCount = 0;
 
     int cascadesCnt = m_UseCascadeShadowMaps ? MAX_CASCADES : 1;
     int shadowMapResolution = light->GetShadowMapRT()->GetSize().x;
@@ -62,7 +70,8 @@ void DirectionalLightShadowMap::RenderShadowMap(const Camera::Ptr viewCamera, co
         viewFrustum.Near = -fFrustumIntervalBegin;
         viewFrustum.Far = -fFrustumIntervalEnd;
 
-        std::vector<vec3> frustumPoints = viewFrustum.GetCorners();
+        vec3 frustumPoints[BoundingFrustum::CORNER_COUNT];
+        viewFrustum.GetCorners(frustumPoints);
         vec3 vLightCameraOrthographicMin = vec3(FLT_MAX);
         vec3 vLightCameraOrthographicMax = vec3(-FLT_MAX);
         ComputeShadowProjectionFitViewFrustum(frustumPoints, viewCameraView, lightCameraView, vLightCameraOrthographicMin, vLightCameraOrthographicMax);
@@ -70,20 +79,71 @@ void DirectionalLightShadowMap::RenderShadowMap(const Camera::Ptr viewCamera, co
         // Remove the shimmering edge effect along the edges of shadows due to the light changing to fit the camera by moving the light in texel-sized increments
         RemoveShimmeringEdgeEffect(frustumPoints, cascadeResolution, vLightCameraOrthographicMin, vLightCameraOrthographicMax);
 
-        // Calculate the near and far plane
-        BoundingBox bb = scene->AABB;
-        std::vector<vec3> sceneAABBPoints = bb.GetCorners();
-        // Transform the scene AABB to light space
-        std::vector<vec3> sceneAABBPointsLightSpace;
-        sceneAABBPointsLightSpace.resize(8);
-        for (int index = 0; index < 8; ++index)
-            sceneAABBPointsLightSpace[index] = glm::make_vec3(lightCameraView * vec4(sceneAABBPoints[index], 1.0f));
+        // Find the casters that can throw shadows into this cascade. The cascade box is extended toward the light (+z in light space),
+        // so casters outside of the view frustum but between the light and the cascade are kept.
+        FrustumPlanes cascadePlanes;
+        ComputeCascadeCullingPlanes(cascadePlanes, lightCameraView, vLightCameraOrthographicMin, vLightCameraOrthographicMax);
+
+        auto queryStart = std::chrono::high_resolution_clock::now();
+        m_CascadeCasterItems.clear();
+        casterBVH.Query(cascadePlanes, m_CascadeCasterItems);
+        auto queryEnd = std::chrono::high_resolution_clock::now();
+        StatusRecorder::BVHQueryTime += std::chrono::duration<float, std::milli>(queryEnd - queryStart).count();
+
+        for (size_t i = casterBVH.GetItemCount(); i < shadowCasterCommands.size(); ++i)
+        {
+            m_CascadeCasterItems.push_back(static_cast<uint32_t>(i));
+        }
+
+        m_CascadeCasters.clear();
+        vec3 castersMin = vec3(FLT_MAX);
+        vec3 castersMax = vec3(-FLT_MAX);
+        bool castersBounded = true;
+        for (size_t i = 0; i < m_CascadeCasterItems.size(); ++i)
+        {
+            const RenderCommand &command = shadowCasterCommands[m_CascadeCasterItems[i]];
+            if (!command.Material->GetMaterialCastShadows())
+            {
+                continue;
+            }
+
+            m_CascadeCasters.push_back(m_CascadeCasterItems[i]);
+            if (command.HasWorldBounds)
+            {
+                BoundingBox lightSpaceAABB;
+                BoundingBox::CreateFromBoundingBoxAndTransform(lightSpaceAABB, command.WorldBounds, lightCameraView);
+                castersMin = min(castersMin, lightSpaceAABB.Center - lightSpaceAABB.Extents);
+                castersMax = max(castersMax, lightSpaceAABB.Center + lightSpaceAABB.Extents);
+            }
+            else
+            {
+                castersBounded = false;
+            }
+        }
+        StatusRecorder::ShadowCasterCulledCount += static_cast<unsigned int>(shadowCasterCommands.size() - m_CascadeCasterItems.size());
+
+        // Calculate the near and far plane from the bounds of the casters, the scene AABB is used if any caster is unbounded
+        vec3 castersAABBPointsLightSpace[BoundingBox::CORNER_COUNT];
+        if (castersBounded && !m_CascadeCasters.empty())
+        {
+            BoundingBox castersAABB;
+            BoundingBox::CreateFromPoints(castersAABB, castersMin, castersMax);
+            castersAABB.GetCorners(castersAABBPointsLightSpace);
+        }
+        else
+        {
+            vec3 sceneAABBPoints[BoundingBox::CORNER_COUNT];
+            scene->AABB.GetCorners(sceneAABBPoints);
+            // Transform the scene AABB to light space
+            for (int index = 0; index < 8; ++index)
+                castersAABBPointsLightSpace[index] = glm::make_vec3(lightCameraView * vec4(sceneAABBPoints[index], 1.0f));
+        }
 
         // Compute the near and far plane
         // Near and far plane are negative in OpenGL right-hand coordinate
         float nearPlane = 0.0f;
         float farPlane = 10000.0f;
-        ComputeNearAndFar(nearPlane, farPlane, vLightCameraOrthographicMin, vLightCameraOrthographicMax, sceneAABBPointsLightSpace);
+        ComputeNearAndFar(nearPlane, farPlane, vLightCameraOrthographicMin, vLightCameraOrthographicMax, castersAABBPointsLightSpace);
 
         // Shadow Pancaking
         if (vLightCameraOrthographicMax.z < nearPlane)
@@ -100,13 +160,60 @@ void DirectionalLightShadowMap::RenderShadowMap(const Camera::Ptr viewCamera, co
         int offsetY = (iCascadeIndex / 2) * cascadeResolution;
         glViewport(offsetX, offsetY, cascadeResolution, cascadeResolution);
 
-        for (size_t i = 0; i < shadowCasterCommands.size(); ++i)
+        // The caster shader does not depend on the material, so the casters only need to share the mesh to be instanced.
+        // The merged index ranges of a static batch stay in ascending order, so the adjacent ones are drawn at once.
+        std::sort(m_CascadeCasters.begin(), m_CascadeCasters.end(), [&shadowCasterCommands](uint32_t a, uint32_t b)
         {
-            RenderCommand::Ptr command = shadowCasterCommands[i];
-            m_DirectionalShadowCasterMat->SetMatrix("uLightMVP", m_MatShadowProjections[iCascadeIndex] * lightCameraView * command->Transform);
-            RenderShadowCasters(command->Mesh);
+            uint32_t meshA = shadowCasterCommands[a].Mesh->GetMeshID();
+            uint32_t meshB = shadowCasterCommands[b].Mesh->GetMeshID();
+            return meshA != meshB ? meshA < meshB : a < b;
+        });
+
+        m_CascadeCasterCommands.clear();
+        for (size_t i = 0; i < m_CascadeCasters.size(); ++i)
+        {
+            m_CascadeCasterCommands.push_back(&shadowCasterCommands[m_CascadeCasters[i]]);
         }
 
+        m_CascadeBatches.clear();
+        m_CascadeInstances.clear();
+        CommandBuffer::BuildBatches(m_CascadeCasterCommands.data(), m_CascadeCasterCommands.size(), StatusRecorder::Instancing, false, m_CascadeBatches, m_CascadeInstances);
+        m_InstanceBuffer->Upload(m_CascadeInstances);
+
+        // The view projection of the cascade is set once per program, the draws without instancing bind the transform of their caster
+        static const int lightViewProjectionID = Shader::PropertyToID("uLightViewProjection");
+        const mat4 lightViewProjection = m_MatShadowProjections[iCascadeIndex] * lightCameraView;
+        bool viewProjectionSet = false;
+        bool instancedViewProjectionSet = false;
+        for (size_t i = 0; i < m_CascadeBatches.size(); ++i)
+        {
+            const RenderBatch &batch = m_CascadeBatches[i];
+            if (batch.InstanceCount > 1)
+            {
+                m_DirectionalShadowCasterMat->Use(true);
+                if (!instancedViewProjectionSet)
+                {
+                    m_DirectionalShadowCasterMat->GetInstancedShader()->SetUniformMatrix(lightViewProjectionID, lightViewProjection);
+                    instancedViewProjectionSet = true;
+                }
+                m_InstanceBuffer->BindToMesh(batch.Command->Mesh, batch.FirstInstance);
+                RenderShadowCastersInstanced(batch.Command->Mesh, batch.InstanceCount);
+                StatusRecorder::InstancedShadowBatchCount++;
+            }
+            else
+            {
+                m_DirectionalShadowCasterMat->Use();
+                if (!viewProjectionSet)
+                {
+                    m_DirectionalShadowCasterMat->GetShader()->SetUniformMatrix(lightViewProjectionID, lightViewProjection);
+                    viewProjectionSet = true;
+                }
+                drawUniforms->Bind(batch.Command->DrawIndex);
+                RenderShadowCasters(batch.Command->Mesh, batch.IndexOffset, batch.IndexCount);
+            }
+        }
+        StatusRecorder::ShadowCasterDrawCount += static_cast<unsigned int>(m_CascadeCasters.size());
+
         // Apply cascade shadow transfom for shadow mapping, convert xyz from [-1, 1] to [0, 1]: xyz * 0.5 + 0.5.
         mat4 textureScaleAndBias = mat4(1.0f);
         // Scale
@@ -130,20 +237,38 @@ void DirectionalLightShadowMap::RenderShadowMap(const Camera::Ptr viewCamera, co
     glDisable(GL_POLYGON_OFFSET_FILL);
 }
 
-void DirectionalLightShadowMap::RenderShadowCasters(Mesh::Ptr mesh)
+void DirectionalLightShadowMap::RenderShadowCasters(Mesh *mesh, uint32_t indexOffset, uint32_t indexCount)
 {
-    glBindVertexArray(mesh->GetVertexArrayID());
+    mesh->Draw(indexOffset, indexCount);
+}
 
-    if (mesh->GetIndicesCount() > 0)
-        glDrawElements(GL_TRIANGLES, mesh->GetIndicesCount(), GL_UNSIGNED_INT, nullptr);
-    else
-        glDrawArrays(GL_TRIANGLES, 0, mesh->GetVerticesCount());
+void DirectionalLightShadowMap::RenderShadowCastersInstanced(Mesh *mesh, uint32_t instanceCount)
+{
+    mesh->DrawInstanced(instanceCount);
+}
 
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindVertexArray(0);
+void DirectionalLightShadowMap::ComputeCascadeCullingPlanes(FrustumPlanes &outPlanes, const mat4 &lightView, const vec3 &lightCameraOrthographicMin, const vec3 &lightCameraOrthographicMax)
+{
+    // Planes of the box in light space, the normals point inside
+    vec4 lightSpacePlanes[FrustumPlanes::PLANE_COUNT] =
+    {
+        vec4(1.0f, 0.0f, 0.0f, -lightCameraOrthographicMin.x),
+        vec4(-1.0f, 0.0f, 0.0f, lightCameraOrthographicMax.x),
+        vec4(0.0f, 1.0f, 0.0f, -lightCameraOrthographicMin.y),
+        vec4(0.0f, -1.0f, 0.0f, lightCameraOrthographicMax.y),
+        vec4(0.0f, 0.0f, 1.0f, -lightCameraOrthographicMin.z),     // Far side of the cascade, away from the light
+        vec4(0.0f, 0.0f, 0.0f, 1.0f)                               // No plane toward the light, always inside
+    };
+
+    // Planes are transformed by the transpose of the matrix that maps world to light space
+    mat4 lightViewTranspose = transpose(lightView);
+    for (size_t i = 0; i < FrustumPlanes::PLANE_COUNT; ++i)
+    {
+        outPlanes.Planes[i] = lightViewTranspose * lightSpacePlanes[i];
+    }
 }
 
-void DirectionalLightShadowMap::ComputeShadowProjectionFitViewFrustum(std::vector<vec3> &frustumPoints, const mat4 &cameraView, const mat4 &lightView,vec3 &lightCameraOrthographicMin, vec3 &lightCameraOrthographicMax)
+void DirectionalLightShadowMap::ComputeShadowProjectionFitViewFrustum(vec3 *frustumPoints, const mat4 &cameraView, const mat4 &lightView,vec3 &lightCameraOrthographicMin, vec3 &lightCameraOrthographicMax)
 {
     mat4 inverseCameraView = inverse(cameraView);
     
@@ -160,7 +285,7 @@ void DirectionalLightShadowMap::ComputeShadowProjectionFitViewFrustum(std::vecto
     }
 }
 
-void DirectionalLightShadowMap::RemoveShimmeringEdgeEffect(const std::vector<vec3> &frustumPoints, const int &bufferSize, vec3 &lightCameraOrthographicMin, vec3 &lightCameraOrthographicMax)
+void DirectionalLightShadowMap::RemoveShimmeringEdgeEffect(const vec3 *frustumPoints, const int &bufferSize, vec3 &lightCameraOrthographicMin, vec3 &lightCameraOrthographicMax)
 {
     vec3 vWorldUnitsPerTexel = vec3(0.0f);
 
@@ -196,7 +321,7 @@ void DirectionalLightShadowMap::RemoveShimmeringEdgeEffect(const std::vector<vec
     lightCameraOrthographicMax *= vWorldUnitsPerTexel;
 }
 
-void DirectionalLightShadowMap::ComputeNearAndFar(float &nearPlane, float &farPlane, const vec3 &lightCameraOrthographicMin, const vec3 &lightCameraOrthographicMax, const std::vector<vec3> &sceneAABBPointsLightSpace)
+void DirectionalLightShadowMap::ComputeNearAndFar(float &nearPlane, float &farPlane, const vec3 &lightCameraOrthographicMin, const vec3 &lightCameraOrthographicMax, const vec3 *sceneAABBPointsLightSpace)
 {
     // Initialize the near and far planes
     // Right-hand coordinates in OpenGL, so all z coordinates are negative
@@ -5,11 +5,15 @@
 
 #include "ptr.h"
 #include "renderer/RenderCommand.h"
+#include "renderer/InstanceBuffer.h"
+#include "renderer/DrawUniformBuffer.h"
+#include "renderer/CommandBuffer.h"
 #include "cameras/Camera.h"
 #include "lights/DirectionalLight.h"
 #include "base/Material.h"
 #include "meshes/Mesh.h"
 #include "scene/SceneNode.h"
+#include "utility/BoundingVolumeHierarchy.h"
 
 using namespace glm;
 
@@ -21,13 +25,21 @@ public:
     ~DirectionalLightShadowMap() = default;
     
     void SetCascadeShadowMapsEnabled(const bool &enabled);
-    void RenderShadowMap(const Camera::Ptr viewCamera, const DirectionalLight::Ptr light, const std::vector<RenderCommand::Ptr> &shadowCasterCommands, const SceneNode::Ptr scene);
+    // The first casterBVH.GetItemCount() caster commands are the items of the BVH, the remaining ones have no bounds and are always drawn.
+    // The casters drawn without instancing bind their DrawIndex entry of drawUniforms.
+    void RenderShadowMap(const Camera::Ptr viewCamera, const DirectionalLight::Ptr light, const std::vector<RenderCommand> &shadowCasterCommands, const Collision::BoundingVolumeHierarchy &casterBVH, const SceneNode::Ptr scene, const DrawUniformBuffer::Ptr drawUniforms);
     
-    void RenderShadowCasters(Mesh::Ptr mesh);
+    // A count of 0 draws all the indices
+    void RenderShadowCasters(Mesh *mesh, uint32_t indexOffset = 0, uint32_t indexCount = 0);
+    void RenderShadowCastersInstanced(Mesh *mesh, uint32_t instanceCount);
+
+    // World space planes of the light space box of a cascade, without the near plane so the casters between the light and the cascade are kept
+    void ComputeCascadeCullingPlanes(Collision::FrustumPlanes &outPlanes, const mat4 &lightView, const vec3 &lightCameraOrthographicMin, const vec3 &lightCameraOrthographicMax);
     
-    void ComputeShadowProjectionFitViewFrustum(std::vector<vec3> &frustumPoints, const mat4 &cameraView, const mat4 &lightView, vec3 &lightCameraOrthographicMin, vec3 &lightCameraOrthographicMax);
-    void RemoveShimmeringEdgeEffect(const std::vector<vec3> &frustumPoints, const int &bufferSize, vec3 &lightCameraOrthographicMin, vec3 &lightCameraOrthographicMax);
-    void ComputeNearAndFar(float &nearPlane, float &farPlane, const vec3 &lightCameraOrthographicMin, const vec3 &lightCameraOrthographicMax, const std::vector<vec3> &sceneAABBPointsLightSpace);
+    // The frustum and AABB points are arrays of 8 corners
+    void ComputeShadowProjectionFitViewFrustum(vec3 *frustumPoints, const mat4 &cameraView, const mat4 &lightView, vec3 &lightCameraOrthographicMin, vec3 &lightCameraOrthographicMax);
+    void RemoveShimmeringEdgeEffect(const vec3 *frustumPoints, const int &bufferSize, vec3 &lightCameraOrthographicMin, vec3 &lightCameraOrthographicMax);
+    void ComputeNearAndFar(float &nearPlane, float &farPlane, const vec3 &lightCameraOrthographicMin, const vec3 &lightCameraOrthographicMax, const vec3 *sceneAABBPointsLightSpace);
     
     mat4& GetLightCameraView();
     std::vector<mat4>& GetShadowProjections();
@@ -69,4 +81,15 @@ private:
     Material::Ptr m_DirectionalShadowCasterMat;
     Camera::Ptr m_LightCamera;
     vec4 m_CascadeParams;
+
+    // Casters returned by the BVH for the current cascade
+    std::vector<uint32_t> m_CascadeCasterItems;
+    // Indices of the casters drawn into the current cascade, the items whose material casts shadows
+    std::vector<uint32_t> m_CascadeCasters;
+
+    // The casters of a cascade sharing a mesh are drawn instanced
+    std::vector<const RenderCommand*> m_CascadeCasterCommands;
+    std::vector<RenderBatch> m_CascadeBatches;
+    std::vector<InstanceData> m_CascadeInstances;
+    InstanceBuffer::Ptr m_InstanceBuffer;
 };
@@ -0,0 +1,66 @@
+#include "renderer/DrawUniformBuffer.h"
+
+#include <cstring>
+
+#include "utility/StatusRecorder.h"
+
+DrawUniformBuffer::DrawUniformBuffer()
+    : m_Stride(sizeof(DrawUniforms)), m_Count(0), m_Dirty(false), m_RegionOffset(0), m_BoundIndex(INVALID_INDEX)
+{
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment > 0)
+    {
+        m_Stride = (m_Stride + alignment - 1) / alignment * alignment;
+    }
+
+    m_RingBuffer = UniformRingBuffer::New(BINDING, m_Stride);
+}
+
+void DrawUniformBuffer::Resize(uint32_t count)
+{
+    if (count != m_Count)
+    {
+        m_Count = count;
+        m_Data.resize(static_cast<size_t>(count) * m_Stride);
+        m_Dirty = true;
+    }
+}
+
+void DrawUniformBuffer::Set(uint32_t index, const glm::mat4 &modelToWorld, const glm::mat3 &modelNormalToWorld)
+{
+    DrawUniforms uniforms;
+    uniforms.ModelToWorld = modelToWorld;
+    uniforms.ModelNormalToWorld[0] = glm::vec4(modelNormalToWorld[0], 0.0f);
+    uniforms.ModelNormalToWorld[1] = glm::vec4(modelNormalToWorld[1], 0.0f);
+    uniforms.ModelNormalToWorld[2] = glm::vec4(modelNormalToWorld[2], 0.0f);
+    std::memcpy(m_Data.data() + static_cast<size_t>(index) * m_Stride, &uniforms, sizeof(DrawUniforms));
+    m_Dirty = true;
+}
+
+void DrawUniformBuffer::Upload()
+{
+    if (!m_Dirty || m_Count == 0)
+    {
+        return;
+    }
+
+    uint32_t size = m_Count * m_Stride;
+    m_RingBuffer->Reserve(size);
+    m_RegionOffset = m_RingBuffer->Upload(m_Data.data(), size);
+    m_BoundIndex = INVALID_INDEX;
+    m_Dirty = false;
+    StatusRecorder::DrawUniformUploadBytes += size;
+}
+
+void DrawUniformBuffer::Bind(uint32_t index)
+{
+    if (index == m_BoundIndex || index >= m_Count)
+    {
+        return;
+    }
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, m_RingBuffer->GetBufferID(), m_RegionOffset + static_cast<GLintptr>(index) * m_Stride, sizeof(DrawUniforms));
+    m_BoundIndex = index;
+    StatusRecorder::UniformBufferBinds++;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ptr.h"
+#include "renderer/UniformRingBuffer.h"
+
+// CPU copy of the DrawUniforms block in common/draw.glsl, a mat3 takes three 16 bytes columns in std140
+struct DrawUniforms
+{
+    glm::mat4 ModelToWorld;
+    glm::vec4 ModelNormalToWorld[3];
+};
+
+static_assert(offsetof(DrawUniforms, ModelToWorld) == 0, "DrawUniforms does not match the std140 layout");
+static_assert(offsetof(DrawUniforms, ModelNormalToWorld) == 64, "DrawUniforms does not match the std140 layout");
+static_assert(sizeof(DrawUniforms) == 112, "DrawUniforms does not match the std140 layout");
+
+// Per-draw uniforms of the draws without instancing. The entries of all the draws are written to a UniformRingBuffer
+// with one upload, and a draw binds its entry with glBindBufferRange instead of setting the matrices as uniforms.
+// The entries are kept across frames, nothing is uploaded while none of them changes.
+class DrawUniformBuffer
+{
+    SHARED_PTR(DrawUniformBuffer)
+public:
+    static constexpr GLuint BINDING = 2;
+    static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFFu;
+
+    DrawUniformBuffer();
+
+    // The entries below the new count are kept
+    void Resize(uint32_t count);
+    void Set(uint32_t index, const glm::mat4 &modelToWorld, const glm::mat3 &modelNormalToWorld);
+    uint32_t GetCount() const { return m_Count; }
+
+    // Upload all the entries if any of them changed since the last upload
+    void Upload();
+    // Bind the entry to the DrawUniforms binding point, nothing is done if it is already bound
+    void Bind(uint32_t index);
+
+private:
+    UniformRingBuffer::Ptr m_RingBuffer;
+    // Entries at m_Stride bytes, the offset alignment of the uniform buffer bindings
+    std::vector<uint8_t> m_Data;
+    uint32_t m_Stride;
+    uint32_t m_Count;
+    bool m_Dirty;
+    // Offset of the region holding the last upload
+    uint32_t m_RegionOffset;
+    uint32_t m_BoundIndex;
+};
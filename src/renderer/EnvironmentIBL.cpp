@@ -10,9 +10,9 @@
 
 #include "renderer/Blitter.h"
 
-EnvironmentIBL::EnvironmentIBL(const std::string &cubemapPath, const GLuint &uniformBufferID)
+EnvironmentIBL::EnvironmentIBL(const std::string &cubemapPath, const UniformRingBuffer::Ptr &globalUniformBuffer)
 {
-    m_UniformBufferID = uniformBufferID;
+    m_GlobalUniformBuffer = globalUniformBuffer;
 
     // Framebuffer and render buffer for off-screen rendering cubemaps
     glGenFramebuffers(1, &m_FrameBufferID);
@@ -150,15 +150,15 @@ void EnvironmentIBL::RenderToCubemap(TextureCube::Ptr cubemap, unsigned int mipL
     // Importent: Render the spherical position to the cube position inside the inner cube box; cull face must be disabled
     glDisable(GL_CULL_FACE);
 
-    // Bind global uniforms
-    glBindBuffer(GL_UNIFORM_BUFFER, m_UniformBufferID);
-
-    glBufferSubData(GL_UNIFORM_BUFFER, 64, 64, &(captureProjection[0].x));
+    // Global uniforms of the capture, only the matrices are read by the cube shaders
+    GlobalUniforms uniforms = GlobalUniforms();
+    uniforms.ClipFromView = captureProjection;
 
     for (unsigned int i = 0; i < 6; ++i)
     {
-        // Set global uniforms
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, 64, &(faceCameras[i]->GetViewMatrix()[0].x));
+        // Set global uniforms, each face is written to another region of the ring
+        uniforms.ViewFromWorld = faceCameras[i]->GetViewMatrix();
+        m_GlobalUniformBuffer->Upload(&uniforms, sizeof(GlobalUniforms));
 
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, cubemap->GetTextureID(), mipLevel);
         // Check framebuffer status
@@ -172,8 +172,6 @@ void EnvironmentIBL::RenderToCubemap(TextureCube::Ptr cubemap, unsigned int mipL
 
     // Unbind framebuffer
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    // Unbind global uniforms
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
     // Set back to default
     glDepthFunc(GL_LESS);
@@ -195,20 +193,7 @@ void EnvironmentIBL::DrawSceneNode(SceneNode::Ptr node)
             mr->GetMaterial()->Use();
         }
 
-        Mesh::Ptr mesh = mr->GetMesh();
-        glBindVertexArray(mesh->GetVertexArrayID());
-
-        if (mesh->GetIndicesCount() > 0)
-        {
-            glDrawElements(GL_TRIANGLES, mesh->GetIndicesCount(), GL_UNSIGNED_INT, nullptr);
-        }
-        else
-        {
-            glDrawArrays(GL_TRIANGLES, 0, mesh->GetVerticesCount());
-        }
-
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glBindVertexArray(0);
+        mr->GetMesh()->Draw();
     }
 
     for (size_t i = 0; i < node->GetChildrenCount(); ++i)
@@ -7,6 +7,8 @@
 #include "base/Texture2D.h"
 #include "base/TextureCube.h"
 #include "renderer/RenderTarget.h"
+#include "renderer/GlobalUniforms.h"
+#include "renderer/UniformRingBuffer.h"
 #include "scene/SceneNode.h"
 #include "base/Material.h"
 
@@ -15,7 +17,7 @@ class EnvironmentIBL
     SHARED_PTR(EnvironmentIBL)
 public:
 
-    EnvironmentIBL(const std::string &cubemapPath, const GLuint &uniformBufferID);
+    EnvironmentIBL(const std::string &cubemapPath, const UniformRingBuffer::Ptr &globalUniformBuffer);
     ~EnvironmentIBL();
 
     void LoadEnvironmentCubemap(const std::string& cubemapPath);
@@ -30,7 +32,7 @@ public:
     TextureCube::Ptr GetPrefiltered();
     Texture2D::Ptr GetBRDFLUTTexture();
 
-    GLuint m_UniformBufferID;
+    UniformRingBuffer::Ptr m_GlobalUniformBuffer;
 
     GLuint m_FrameBufferID, m_DepthRenderBufferID;
     SceneNode::Ptr m_Cube;
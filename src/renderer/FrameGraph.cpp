@@ -0,0 +1,228 @@
+#include "renderer/FrameGraph.h"
+
+#include <iostream>
+
+#include "utility/StatusRecorder.h"
+
+FrameGraph::FrameGraph(const RenderTargetPool::Ptr &renderTargetPool)
+    : m_RenderTargetPool(renderTargetPool)
+{ }
+
+void FrameGraph::Reset()
+{
+    m_Passes.clear();
+    m_Accesses.clear();
+    m_Targets.clear();
+    m_PassInfos.clear();
+    m_ResourceInfos.clear();
+}
+
+FrameGraph::Resource FrameGraph::CreateTarget(const char *name, const TargetDesc &desc)
+{
+    if (desc.DepthSource != INVALID_RESOURCE && (desc.HasDepth || desc.DepthSource >= m_ResourceInfos.size()))
+    {
+        std::cerr << "FrameGraph: target " << name << " has an invalid depth source" << std::endl;
+    }
+
+    ResourceInfo info;
+    info.Name = name;
+    info.Desc = desc;
+    info.Imported = false;
+    info.Output = false;
+    info.FirstPass = -1;
+    info.LastPass = -1;
+    info.PhysicalTarget = -1;
+    m_ResourceInfos.push_back(info);
+    m_Targets.push_back(nullptr);
+    return static_cast<Resource>(m_ResourceInfos.size() - 1);
+}
+
+FrameGraph::Resource FrameGraph::ImportResource(const char *name, const RenderTarget::Ptr &target, bool isOutput)
+{
+    ResourceInfo info;
+    info.Name = name;
+    info.Desc.Size = target != nullptr ? target->GetSize() : glm::u32vec2(0);
+    info.Desc.Type = GL_NONE;
+    info.Desc.ColorAttachmentsNum = 0;
+    info.Desc.HasDepth = false;
+    info.Desc.DepthSource = INVALID_RESOURCE;
+    info.Imported = true;
+    info.Output = isOutput;
+    info.FirstPass = -1;
+    info.LastPass = -1;
+    info.PhysicalTarget = -1;
+    m_ResourceInfos.push_back(info);
+    m_Targets.push_back(target);
+    return static_cast<Resource>(m_ResourceInfos.size() - 1);
+}
+
+uint32_t FrameGraph::AddPass(const char *name, const ExecuteFunction &execute)
+{
+    Pass pass;
+    pass.Execute = execute;
+    m_Passes.push_back(pass);
+
+    PassInfo info;
+    info.Name = name;
+    info.Culled = false;
+    m_PassInfos.push_back(info);
+
+    return static_cast<uint32_t>(m_Passes.size() - 1);
+}
+
+void FrameGraph::Read(uint32_t pass, Resource resource)
+{
+    if (resource >= m_ResourceInfos.size())
+    {
+        std::cerr << "FrameGraph: pass " << m_PassInfos[pass].Name << " reads an invalid resource" << std::endl;
+        return;
+    }
+    m_Accesses.push_back({ pass, resource, false });
+}
+
+void FrameGraph::Write(uint32_t pass, Resource resource)
+{
+    if (resource >= m_ResourceInfos.size())
+    {
+        std::cerr << "FrameGraph: pass " << m_PassInfos[pass].Name << " writes an invalid resource" << std::endl;
+        return;
+    }
+    m_Accesses.push_back({ pass, resource, true });
+}
+
+void FrameGraph::Compile()
+{
+    // An access to a target sharing the depth of another one is an access to that one too
+    size_t accessCount = m_Accesses.size();
+    for (size_t i = 0; i < accessCount; ++i)
+    {
+        Access access = m_Accesses[i];
+        const ResourceInfo &info = m_ResourceInfos[access.ResourceIndex];
+        if (!info.Imported && info.Desc.DepthSource != INVALID_RESOURCE)
+        {
+            access.ResourceIndex = info.Desc.DepthSource;
+            m_Accesses.push_back(access);
+        }
+    }
+
+    // Walk the passes backwards from the outputs, a pass is live if a later live pass uses one of the resources it writes
+    m_NeededResources.assign(m_ResourceInfos.size(), 0);
+    for (size_t i = 0; i < m_ResourceInfos.size(); ++i)
+    {
+        m_NeededResources[i] = m_ResourceInfos[i].Output ? 1 : 0;
+    }
+
+    for (int pass = static_cast<int>(m_Passes.size()) - 1; pass >= 0; --pass)
+    {
+        bool live = false;
+        for (size_t i = 0; i < m_Accesses.size() && !live; ++i)
+        {
+            const Access &access = m_Accesses[i];
+            live = access.PassIndex == static_cast<uint32_t>(pass) && access.IsWrite && m_NeededResources[access.ResourceIndex];
+        }
+
+        m_PassInfos[pass].Culled = !live;
+        if (live)
+        {
+            for (size_t i = 0; i < m_Accesses.size(); ++i)
+            {
+                if (m_Accesses[i].PassIndex == static_cast<uint32_t>(pass))
+                {
+                    m_NeededResources[m_Accesses[i].ResourceIndex] = 1;
+                }
+            }
+        }
+    }
+
+    // Lifetimes over the live passes
+    for (size_t i = 0; i < m_Accesses.size(); ++i)
+    {
+        const Access &access = m_Accesses[i];
+        if (m_PassInfos[access.PassIndex].Culled)
+        {
+            continue;
+        }
+
+        ResourceInfo &info = m_ResourceInfos[access.ResourceIndex];
+        int pass = static_cast<int>(access.PassIndex);
+        info.FirstPass = info.FirstPass < 0 ? pass : glm::min(info.FirstPass, pass);
+        info.LastPass = glm::max(info.LastPass, pass);
+    }
+}
+
+void FrameGraph::Execute()
+{
+    m_PhysicalTargets.clear();
+    size_t transientBytes = 0;
+    size_t physicalBytes = 0;
+    unsigned int transientCount = 0;
+    unsigned int culledCount = 0;
+
+    for (size_t pass = 0; pass < m_Passes.size(); ++pass)
+    {
+        if (m_PassInfos[pass].Culled)
+        {
+            ++culledCount;
+            continue;
+        }
+
+        // Transient targets starting their lifetime
+        for (size_t i = 0; i < m_ResourceInfos.size(); ++i)
+        {
+            ResourceInfo &info = m_ResourceInfos[i];
+            if (info.Imported || info.FirstPass != static_cast<int>(pass))
+            {
+                continue;
+            }
+
+            const TargetDesc &desc = info.Desc;
+            m_Targets[i] = m_RenderTargetPool->Acquire(desc.Size, desc.Type, desc.ColorAttachmentsNum, desc.HasDepth);
+            if (desc.DepthSource != INVALID_RESOURCE)
+            {
+                m_Targets[i]->SetDepthAttachment(m_Targets[desc.DepthSource]->GetDepthTexture());
+            }
+
+            size_t bytes = RenderTargetPool::GetTargetMemorySize(desc.Size, desc.Type, desc.ColorAttachmentsNum, desc.HasDepth);
+            transientBytes += bytes;
+            ++transientCount;
+
+            for (size_t j = 0; j < m_PhysicalTargets.size() && info.PhysicalTarget < 0; ++j)
+            {
+                if (m_PhysicalTargets[j] == m_Targets[i].get())
+                {
+                    info.PhysicalTarget = static_cast<int>(j);
+                }
+            }
+            if (info.PhysicalTarget < 0)
+            {
+                info.PhysicalTarget = static_cast<int>(m_PhysicalTargets.size());
+                m_PhysicalTargets.push_back(m_Targets[i].get());
+                physicalBytes += bytes;
+            }
+        }
+
+        m_Passes[pass].Execute();
+
+        // Transient targets ending their lifetime go back to the pool for the later passes
+        for (size_t i = 0; i < m_ResourceInfos.size(); ++i)
+        {
+            const ResourceInfo &info = m_ResourceInfos[i];
+            if (!info.Imported && info.LastPass == static_cast<int>(pass))
+            {
+                m_RenderTargetPool->Release(m_Targets[i]);
+                m_Targets[i] = nullptr;
+            }
+        }
+    }
+
+    StatusRecorder::FrameGraphPassCount = static_cast<unsigned int>(m_Passes.size());
+    StatusRecorder::FrameGraphCulledPassCount = culledCount;
+    StatusRecorder::FrameGraphTransientTargets = transientCount;
+    StatusRecorder::FrameGraphPhysicalTargets = static_cast<unsigned int>(m_PhysicalTargets.size());
+    StatusRecorder::FrameGraphAliasedMemory = (transientBytes - physicalBytes) / (1024.0f * 1024.0f);
+}
+
+RenderTarget::Ptr FrameGraph::GetTarget(Resource resource) const
+{
+    return resource < m_Targets.size() ? m_Targets[resource] : nullptr;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ptr.h"
+#include "renderer/RenderTarget.h"
+#include "renderer/RenderTargetPool.h"
+
+// The passes of a frame with the resources they read and write, rebuilt every frame.
+// Compile() culls the passes whose writes are not read by a later pass and do not reach an output resource, and finds
+// the first and last pass using each transient target. Execute() acquires a transient target from the pool before
+// its first pass and releases it after its last one, so targets with disjoint lifetimes and the same format share
+// one framebuffer in the frame.
+// A write keeps the previous content, so a pass writing a resource depends on the earlier passes writing it.
+class FrameGraph
+{
+    SHARED_PTR(FrameGraph)
+public:
+    typedef uint32_t Resource;
+    typedef std::function<void()> ExecuteFunction;
+
+    static constexpr Resource INVALID_RESOURCE = 0xFFFFFFFFu;
+
+    struct TargetDesc
+    {
+        glm::u32vec2 Size;
+        GLenum Type;
+        unsigned int ColorAttachmentsNum;
+        bool HasDepth;
+        // Attach the depth of this target instead of an own one, the passes using the target also use the depth source
+        Resource DepthSource = INVALID_RESOURCE;
+    };
+
+    struct PassInfo
+    {
+        const char *Name;
+        bool Culled;
+    };
+
+    struct ResourceInfo
+    {
+        const char *Name;
+        TargetDesc Desc;
+        bool Imported;
+        bool Output;
+        // Range of the live passes using the resource, -1 if no live pass uses it
+        int FirstPass;
+        int LastPass;
+        // Index of the pooled target a transient resource was given, resources sharing a target have the same index
+        int PhysicalTarget;
+    };
+
+    FrameGraph(const RenderTargetPool::Ptr &renderTargetPool);
+
+    // Remove the passes and the resources of the last frame, the names must outlive the frame
+    void Reset();
+
+    Resource CreateTarget(const char *name, const TargetDesc &desc);
+    // A resource owned outside of the graph, the target can be null for the default framebuffer or a non target resource.
+    // The passes writing an output resource are never culled.
+    Resource ImportResource(const char *name, const RenderTarget::Ptr &target, bool isOutput = false);
+
+    // Passes are executed in the order they are added
+    uint32_t AddPass(const char *name, const ExecuteFunction &execute);
+    void Read(uint32_t pass, Resource resource);
+    void Write(uint32_t pass, Resource resource);
+
+    void Compile();
+    void Execute();
+
+    // Only valid in the passes between the first and the last use of the resource
+    RenderTarget::Ptr GetTarget(Resource resource) const;
+
+    const std::vector<PassInfo>& GetPassInfos() const { return m_PassInfos; }
+    const std::vector<ResourceInfo>& GetResourceInfos() const { return m_ResourceInfos; }
+
+private:
+    struct Pass
+    {
+        ExecuteFunction Execute;
+    };
+
+    struct Access
+    {
+        uint32_t PassIndex;
+        Resource ResourceIndex;
+        bool IsWrite;
+    };
+
+    RenderTargetPool::Ptr m_RenderTargetPool;
+
+    std::vector<Pass> m_Passes;
+    std::vector<Access> m_Accesses;
+    // Current target of each resource, transient ones only have one while they are alive
+    std::vector<RenderTarget::Ptr> m_Targets;
+
+    // Report of the last frame
+    std::vector<PassInfo> m_PassInfos;
+    std::vector<ResourceInfo> m_ResourceInfos;
+    std::vector<RenderTarget*> m_PhysicalTargets;
+    std::vector<uint8_t> m_NeededResources;
+};
@@ -18,6 +18,9 @@ void GLStateCache::InitState()
     SetCullFace(GL_BACK);
     
     SetPolygonMode(GL_FILL);
+
+    m_ColorWriteMask = false;
+    SetColorWriteMask(true);
 }
 
 void GLStateCache::SetDepthTest(bool enable)
@@ -113,3 +116,13 @@ void GLStateCache::SetPolygonMode(GLenum mode)
         glPolygonMode(GL_FRONT_AND_BACK, mode);
     }
 }
+
+void GLStateCache::SetColorWriteMask(bool enable)
+{
+    if (m_ColorWriteMask != enable)
+    {
+        m_ColorWriteMask = enable;
+        GLboolean mask = enable ? GL_TRUE : GL_FALSE;
+        glColorMask(mask, mask, mask, mask);
+    }
+}
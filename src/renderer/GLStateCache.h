@@ -26,6 +26,8 @@ public:
     void SetCullFace(GLenum face);
     
     void SetPolygonMode(GLenum mode);
+
+    void SetColorWriteMask(bool enable);
     
 private:
     
@@ -35,6 +37,8 @@ private:
     bool m_Blend;
     // Cull face
     bool m_CullFace;
+    // Color write of all the channels
+    bool m_ColorWriteMask;
 
     // Depth write, this only has effect if depth testing is enabled
     GLenum m_DepthWriteMask;
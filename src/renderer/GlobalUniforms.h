@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// CPU copy of the GlobalUniforms block in common/uniforms.glsl, filled every frame and uploaded with one write.
+// The members follow the std140 rules of the block: a vec3 takes 16 bytes, arrays and matrices are aligned to 16 bytes.
+struct GlobalUniforms
+{
+    glm::mat4 ViewFromWorld;                // view matrix
+    glm::mat4 ClipFromView;                 // projection matrix
+    glm::vec3 MainLightPosition;
+    float Padding0;
+    glm::vec3 MainLightColor;
+    float Padding1;
+    glm::vec3 CameraPosition;
+    float Padding2;
+    glm::mat4 ShadowClipFromView[4];
+    glm::mat4 ShadowViewFromWorld;
+    glm::vec4 CascadeScalesAndOffsets[4];
+    glm::vec4 CascadeParams;                // { x: cascades count, y: min border padding, z: max border padding, w: unused }
+    glm::vec4 ShadowMapTexelSize;           // { x: 1.0 / width, y: 1.0 / height, z: width, w: height }
+    glm::mat4 ViewFromClip;                 // inverse projection matrix
+    glm::vec4 ZBufferParams;                // { x: near (positive), y: far (positive), zw: unused }
+};
+
+// The std140 offsets of common/uniforms.glsl, a member added to the block must be added here at the same offset
+static_assert(offsetof(GlobalUniforms, ViewFromWorld) == 0, "GlobalUniforms does not match the std140 layout");
+static_assert(offsetof(GlobalUniforms, ClipFromView) == 64, "GlobalUniforms does not match the std140 layout");
+static_assert(offsetof(GlobalUniforms, MainLightPosition) == 128, "GlobalUniforms does not match the std140 layout");
+static_assert(offsetof(GlobalUniforms, MainLightColor) == 144, "GlobalUniforms does not match the std140 layout");
+static_assert(offsetof(GlobalUniforms, CameraPosition) == 160, "GlobalUniforms does not match the std140 layout");
+static_assert(offsetof(GlobalUniforms, ShadowClipFromView) == 176, "GlobalUniforms does not match the std140 layout");
+static_assert(offsetof(GlobalUniforms, ShadowViewFromWorld) == 432, "GlobalUniforms does not match the std140 layout");
+static_assert(offsetof(GlobalUniforms, CascadeScalesAndOffsets) == 496, "GlobalUniforms does not match the std140 layout");
+static_assert(offsetof(GlobalUniforms, CascadeParams) == 560, "GlobalUniforms does not match the std140 layout");
+static_assert(offsetof(GlobalUniforms, ShadowMapTexelSize) == 576, "GlobalUniforms does not match the std140 layout");
+static_assert(offsetof(GlobalUniforms, ViewFromClip) == 592, "GlobalUniforms does not match the std140 layout");
+static_assert(offsetof(GlobalUniforms, ZBufferParams) == 656, "GlobalUniforms does not match the std140 layout");
+static_assert(sizeof(GlobalUniforms) == 672, "GlobalUniforms does not match the std140 layout");
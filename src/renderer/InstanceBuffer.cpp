@@ -0,0 +1,38 @@
+#include "renderer/InstanceBuffer.h"
+
+InstanceBuffer::InstanceBuffer()
+    : m_BufferID(0), m_Capacity(0)
+{
+    glGenBuffers(1, &m_BufferID);
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+    glDeleteBuffers(1, &m_BufferID);
+    m_BufferID = 0;
+}
+
+void InstanceBuffer::Upload(const std::vector<InstanceData> &instances)
+{
+    if (instances.empty())
+    {
+        return;
+    }
+
+    size_t size = instances.size() * sizeof(InstanceData);
+    if (size > m_Capacity)
+    {
+        // Grow geometrically, so the storage is not reallocated every time the count changes
+        m_Capacity = size + size / 2;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_BufferID);
+    glBufferData(GL_ARRAY_BUFFER, m_Capacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::BindToMesh(Mesh *mesh, uint32_t firstInstance)
+{
+    mesh->BindInstanceAttributes(m_BufferID, firstInstance * sizeof(InstanceData), sizeof(InstanceData));
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <glad/glad.h>
+
+#include "ptr.h"
+#include "renderer/RenderCommand.h"
+
+// Dynamic vertex buffer of per-instance data, filled again every time it is used
+class InstanceBuffer
+{
+    SHARED_PTR(InstanceBuffer)
+public:
+    InstanceBuffer();
+    ~InstanceBuffer();
+
+    // The previous storage is orphaned, so the draws still reading it do not stall the upload
+    void Upload(const std::vector<InstanceData> &instances);
+
+    // Bind the instances from firstInstance to the per-instance attributes of the mesh
+    void BindToMesh(Mesh *mesh, uint32_t firstInstance);
+
+    GLuint GetBufferID() { return m_BufferID; }
+
+private:
+    GLuint m_BufferID;
+    size_t m_Capacity;
+};
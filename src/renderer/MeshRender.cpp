@@ -1,5 +1,5 @@
 #include "renderer/MeshRender.h"
 
 MeshRender::MeshRender(Mesh::Ptr mesh, Material::Ptr mat)
-    : m_Mesh(mesh), m_Material(mat)
+    : m_Mesh(mesh), m_Material(mat), m_HasBounds(false), m_IndexOffset(0), m_IndexCount(0)
 { }
\ No newline at end of file
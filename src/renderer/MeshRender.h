@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cstdint>
+
 #include "ptr.h"
 #include "meshes/Mesh.h"
 #include "base/Material.h"
+#include "utility/Collision.h"
 
 class MeshRender
 {
@@ -11,9 +14,25 @@ public:
     MeshRender(Mesh::Ptr mesh, Material::Ptr mat);
     ~MeshRender() = default;
 
-    Mesh::Ptr GetMesh() { return m_Mesh; }
-    Material::Ptr GetMaterial() { return m_Material; }
+    const Mesh::Ptr& GetMesh() { return m_Mesh; }
+    const Material::Ptr& GetMaterial() { return m_Material; }
+
+    // Bounding box of the mesh in model space, meshes without bounds are never culled
+    void SetBounds(const Collision::BoundingBox &bounds) { m_Bounds = bounds; m_HasBounds = true; }
+    const Collision::BoundingBox& GetBounds() { return m_Bounds; }
+    bool HasBounds() { return m_HasBounds; }
+
+    // Draw only a range of the indices, e.g. one of the meshes merged by the static batching. A count of 0 draws the whole mesh
+    void SetIndexRange(uint32_t indexOffset, uint32_t indexCount) { m_IndexOffset = indexOffset; m_IndexCount = indexCount; }
+    uint32_t GetIndexOffset() { return m_IndexOffset; }
+    uint32_t GetIndexCount() { return m_IndexCount; }
 private:
     Mesh::Ptr m_Mesh;
     Material::Ptr m_Material;
+
+    Collision::BoundingBox m_Bounds;
+    bool m_HasBounds;
+
+    uint32_t m_IndexOffset;
+    uint32_t m_IndexCount;
 };
\ No newline at end of file
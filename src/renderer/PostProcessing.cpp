@@ -7,7 +7,8 @@
 
 #include "utility/StatusRecorder.h"
 
-PostProcessing::PostProcessing()
+PostProcessing::PostProcessing(const RenderTargetPool::Ptr &renderTargetPool)
+    : m_RenderTargetPool(renderTargetPool)
 {
     m_BloomDownsample2xMat = Material::New("Bloom Prefilter", "utils/FullScreenTriangle.vs", "post_processing/bloom/BloomDownsample2x.fs");
 
@@ -26,22 +27,15 @@ PostProcessing::~PostProcessing()
     m_BloomMipDown.clear();
 }
 
-void PostProcessing::Render(const RenderTarget::Ptr source, const Camera::Ptr targetCamera)
+void PostProcessing::Render(const RenderTarget::Ptr source, const RenderTarget::Ptr bloom, const Camera::Ptr targetCamera)
 {
-    bool bloomActive = StatusRecorder::Bloom;
+    bool bloomActive = bloom != nullptr;
     if (bloomActive)
     {
-        // Bloom
-        RenderTarget::Ptr bloom = RenderTarget::New(1, 1, GL_HALF_FLOAT, 1);
-        Bloom(source, bloom);
-
-        m_CombinePostMat->AddOrSetFloat("uBloomSet", 1.0f);
         m_CombinePostMat->AddOrSetTexture("uBloomTex", bloom->GetColorTexture(0));
     }
-    else
-    {
-        m_CombinePostMat->AddOrSetFloat("uBloomSet", -1.0f);
-    }
+    m_CombinePostMat->SetFeature(ShaderFeature::BLOOM, bloomActive);
+    m_CombinePostMat->SetFeature(ShaderFeature::TONE_MAPPING, StatusRecorder::ToneMapping);
     
     bool fxaaActive = StatusRecorder::FXAA;
     if (fxaaActive)
@@ -49,51 +43,47 @@ void PostProcessing::Render(const RenderTarget::Ptr source, const Camera::Ptr ta
         // Combine post-processing
         m_CombinePostMat->AddOrSetFloat("uBloomIntensity", StatusRecorder::BloomIntensity);
         m_CombinePostMat->AddOrSetFloat("uBlitToCamera", -1.0f);
-        m_CombinePostMat->AddOrSetFloat("uToneMappingSet", StatusRecorder::ToneMapping ? 1.0 : -1.0);
-        RenderTarget::Ptr tempRT = RenderTarget::New(source->GetSize(), GL_HALF_FLOAT, 1);
+        RenderTarget::Ptr tempRT = m_RenderTargetPool->Acquire(source->GetSize(), GL_HALF_FLOAT, 1);
         Blitter::BlitCameraTexture(source, tempRT, m_CombinePostMat);
 
         // Blit to camera with FXAA
-        m_FinalPostMat->AddOrSetFloat("uFXAASet", 1.0f);
-        m_FinalPostMat->AddOrSetFloat("uToneMappingSet", StatusRecorder::ToneMapping ? 1.0 : -1.0);
+        m_FinalPostMat->SetFeature(ShaderFeature::FXAA, true);
+        m_FinalPostMat->SetFeature(ShaderFeature::TONE_MAPPING, StatusRecorder::ToneMapping);
         Blitter::BlitCamera(tempRT, targetCamera, m_FinalPostMat);
+
+        m_RenderTargetPool->Release(tempRT);
     }
     else
     {
         // Combine post-processing
         m_CombinePostMat->AddOrSetFloat("uBloomIntensity", StatusRecorder::BloomIntensity);
         m_CombinePostMat->AddOrSetFloat("uBlitToCamera", 1.0f);
-        m_CombinePostMat->AddOrSetFloat("uToneMappingSet", StatusRecorder::ToneMapping ? 1.0 : -1.0);
         Blitter::BlitCamera(source, targetCamera, m_CombinePostMat);
     }
 }
 
-void PostProcessing::Bloom(const RenderTarget::Ptr source, RenderTarget::Ptr &bloomRT)
+glm::u32vec2 PostProcessing::GetBloomSize(const glm::u32vec2 &sourceSize)
 {
-    glm::u32vec2 size = source->GetSize();
+    return glm::u32vec2(sourceSize.x >> 1, sourceSize.y >> 1);
+}
+
+void PostProcessing::Bloom(const RenderTarget::Ptr source, const RenderTarget::Ptr bloomRT)
+{
+    glm::u32vec2 bloomSize = GetBloomSize(source->GetSize());
     
-    int tw = size.x >> 1;
-    int th = size.y >> 1;
+    int tw = bloomSize.x;
+    int th = bloomSize.y;
 
     int maxSize = glm::max(tw, th);
     int mipCount = glm::floor(std::log2(maxSize) - 1);
 
-    // Resize final bloom texture
-    bloomRT->SetSize(tw, th);
-    
-    if (m_BloomMipUp.size() < mipCount)
-    {
-        m_BloomMipUp.resize(mipCount);
-    }
-    if (m_BloomMipDown.size() < mipCount)
-    {
-        m_BloomMipDown.resize(mipCount);
-    }
+    m_BloomMipUp.resize(mipCount);
+    m_BloomMipDown.resize(mipCount);
     
     for (size_t i = 0; i < mipCount; ++i)
     {
-        ReAllocateOrReSetSizeBloomRT(m_BloomMipUp[i], tw, th);
-        ReAllocateOrReSetSizeBloomRT(m_BloomMipDown[i], tw, th);
+        m_BloomMipUp[i] = m_RenderTargetPool->Acquire(glm::u32vec2(tw, th), GL_HALF_FLOAT, 1);
+        m_BloomMipDown[i] = m_RenderTargetPool->Acquire(glm::u32vec2(tw, th), GL_HALF_FLOAT, 1);
         
         tw = glm::max(1, tw >> 1);
         th = glm::max(1, th >> 1);
@@ -129,19 +119,13 @@ void PostProcessing::Bloom(const RenderTarget::Ptr source, RenderTarget::Ptr &bl
     }
     
     Blitter::BlitCameraTexture(m_BloomMipUp[0], bloomRT);
-}
 
-void PostProcessing::ReAllocateOrReSetSizeBloomRT(RenderTarget::Ptr &rt, const unsigned int &width, const unsigned int &height)
-{
-    if (rt == nullptr)
-    {
-        rt = RenderTarget::New(width, height, GL_HALF_FLOAT, 1);
-    }
-    else
+    for (size_t i = 0; i < mipCount; ++i)
     {
-        if (rt->GetSize().x != width || rt->GetSize().y != height)
-        {
-            rt->SetSize(width, height);
-        }
+        m_RenderTargetPool->Release(m_BloomMipUp[i]);
+        m_RenderTargetPool->Release(m_BloomMipDown[i]);
     }
+    // Keep the capacity but not the targets, an evicted target is deleted by the pool
+    m_BloomMipUp.clear();
+    m_BloomMipDown.clear();
 }
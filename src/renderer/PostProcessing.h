@@ -5,24 +5,29 @@
 #include "ptr.h"
 #include "base/Material.h"
 #include "renderer/RenderTarget.h"
+#include "renderer/RenderTargetPool.h"
 #include "cameras/Camera.h"
 
 class PostProcessing
 {
     SHARED_PTR(PostProcessing)
 public:
-    PostProcessing();
+    PostProcessing(const RenderTargetPool::Ptr &renderTargetPool);
     ~PostProcessing();
     
-    void Render(const RenderTarget::Ptr source, const Camera::Ptr targetCamera);
+    // Bloom of the source, the bloom target has the size of GetBloomSize()
+    void Bloom(const RenderTarget::Ptr source, const RenderTarget::Ptr bloomRT);
+    static glm::u32vec2 GetBloomSize(const glm::u32vec2 &sourceSize);
 
-private:
+    // Combine the source with the bloom and blit it to the camera, the bloom is null if it is disabled
+    void Render(const RenderTarget::Ptr source, const RenderTarget::Ptr bloom, const Camera::Ptr targetCamera);
 
-    void Bloom(const RenderTarget::Ptr source, RenderTarget::Ptr &bloomRT);
+private:
 
-    void ReAllocateOrReSetSizeBloomRT(RenderTarget::Ptr &rt, const unsigned int &width, const unsigned int &height);
+    // All the intermediate targets are acquired from the pool every frame
+    RenderTargetPool::Ptr m_RenderTargetPool;
 
-    // Bloom
+    // Bloom, the mip chain of the current frame
     std::vector<RenderTarget::Ptr> m_BloomMipUp;
     std::vector<RenderTarget::Ptr> m_BloomMipDown;
 
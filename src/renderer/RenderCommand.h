@@ -1,18 +1,54 @@
 #pragma once
 
+#include <cstdint>
 #include <glm/glm.hpp>
 
-#include "ptr.h"
 #include "meshes/Mesh.h"
 #include "base/Material.h"
+#include "renderer/DrawUniformBuffer.h"
+#include "utility/Collision.h"
 
+// Plain data record of a draw, allocated in the frame arena of the CommandBuffer.
+// The mesh and the material are borrowed from the scene, they must outlive the frame.
 struct RenderCommand
 {
-    SHARED_PTR_STRUCT(RenderCommand)
-
-    Mesh::Ptr Mesh;
-    Material::Ptr Material;
+    Mesh* Mesh;
+    Material* Material;
     glm::mat4 Transform;
+    glm::mat3 NormalMatrix;
+
+    // World space bounds of the mesh, only valid if HasWorldBounds is true
+    Collision::BoundingBox WorldBounds;
+    bool HasWorldBounds;
+
+    // Range of the indices to draw, a count of 0 draws the whole mesh
+    uint32_t IndexOffset;
+    uint32_t IndexCount;
+
+    // Draw order of the command in its bucket, built by CommandBuffer::SortOpaqueCommands() and SortTransparentCommands()
+    uint64_t SortKey;
+
+    // Entry of the transform in the DrawUniformBuffer, bound when the command is drawn without instancing
+    uint32_t DrawIndex;
 
-    RenderCommand() : Transform(glm::mat4(1.0f)) { }
-};
\ No newline at end of file
+    RenderCommand() : Mesh(nullptr), Material(nullptr), Transform(glm::mat4(1.0f)), NormalMatrix(glm::mat3(1.0f)), HasWorldBounds(false), IndexOffset(0), IndexCount(0), SortKey(0), DrawIndex(DrawUniformBuffer::INVALID_INDEX) { }
+};
+
+// Per-instance attributes of the instanced shaders, locations 3 to 6 hold the model matrix and 7 to 9 the normal matrix
+struct InstanceData
+{
+    glm::mat4 ModelToWorld;
+    glm::mat3 ModelNormalToWorld;
+};
+
+// A run of commands sharing the mesh and the material, drawn with one call.
+// A single command is drawn without instancing, the instances start at FirstInstance in the instance buffer otherwise.
+// Commands drawing adjacent index ranges of the same mesh are merged into one range instead.
+struct RenderBatch
+{
+    const RenderCommand* Command;
+    uint32_t InstanceCount;
+    uint32_t FirstInstance;
+    uint32_t IndexOffset;
+    uint32_t IndexCount;
+};
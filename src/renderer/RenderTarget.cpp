@@ -5,7 +5,7 @@ RenderTarget::RenderTarget(const unsigned int &width, const unsigned int &height
 { }
 
 RenderTarget::RenderTarget(const glm::u32vec2 &size, GLenum type, unsigned int colorAttachmentsNum, bool hasDepth, bool isShadowMap)
-    : m_FrameBufferID(0), m_Size(size), m_Type(type), m_HasDepthAttachment(hasDepth), m_IsShadowMap(isShadowMap)
+    : m_FrameBufferID(0), m_Size(size), m_Type(type), m_HasDepthAttachment(hasDepth), m_OwnsDepthAttachment(hasDepth), m_IsShadowMap(isShadowMap)
 {
     glGenFramebuffers(1, &m_FrameBufferID);
     glBindFramebuffer(GL_FRAMEBUFFER, m_FrameBufferID);
@@ -102,7 +102,7 @@ void RenderTarget::SetSize(const glm::u32vec2 &size)
         m_ColorAttachments[i]->SetSize(size);
     }
 
-    if (m_HasDepthAttachment)
+    if (m_OwnsDepthAttachment)
     {
         m_DepthAttachment->SetSize(size);
     }
@@ -117,12 +117,38 @@ void RenderTarget::SetSize(const size_t &width, const size_t &height)
         m_ColorAttachments[i]->SetSize(m_Size);
     }
 
-    if (m_HasDepthAttachment)
+    if (m_OwnsDepthAttachment)
     {
         m_DepthAttachment->SetSize(m_Size);
     }
 }
 
+void RenderTarget::SetDepthAttachment(const Texture2D::Ptr &depthTexture)
+{
+    if (m_OwnsDepthAttachment || m_IsShadowMap)
+    {
+        std::cerr << "Error, the render target already has its own depth attachment" << std::endl;
+        return;
+    }
+
+    if (depthTexture == m_DepthAttachment)
+    {
+        return;
+    }
+
+    if (depthTexture != nullptr && depthTexture->GetSize() != m_Size)
+    {
+        std::cerr << "Error, the shared depth attachment does not match the size of the render target" << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_FrameBufferID);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture != nullptr ? depthTexture->GetTextureID() : 0, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    m_DepthAttachment = depthTexture;
+    m_HasDepthAttachment = depthTexture != nullptr;
+}
+
 void RenderTarget::BindTarget(const bool &clearColor, const bool &clearDepth)
 {
     glBindFramebuffer(GL_FRAMEBUFFER, m_FrameBufferID);
@@ -133,7 +159,7 @@ void RenderTarget::BindTarget(const bool &clearColor, const bool &clearDepth)
     {
         mask |= GL_COLOR_BUFFER_BIT;
     }
-    if (clearDepth)
+    if (clearDepth && !IsDepthShared())
     {
         mask |= GL_DEPTH_BUFFER_BIT;
     }
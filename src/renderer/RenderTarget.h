@@ -16,6 +16,7 @@ public:
     ~RenderTarget();
 
     Texture2D::Ptr GetColorTexture(const unsigned int &index);
+    // The own depth attachment or the shared one
     Texture2D::Ptr GetDepthTexture();
     Texture2D::Ptr GetShadowMapTexture();
 
@@ -23,6 +24,12 @@ public:
     void SetSize(const glm::u32vec2 &size);
     void SetSize(const size_t &width, const size_t &height);
 
+    // Attach the depth texture of another target instead of copying it, or detach it with null.
+    // Only for targets created without depth, the shared depth is never resized nor cleared by this target.
+    void SetDepthAttachment(const Texture2D::Ptr &depthTexture);
+    bool IsDepthShared() const { return m_HasDepthAttachment && !m_OwnsDepthAttachment; }
+
+    // A shared depth is not cleared, its owner does
     void BindTarget(const bool &clearColor, const bool &clearDepth);
     void UnbindTarget();
     
@@ -34,6 +41,7 @@ private:
     glm::u32vec2 m_Size;
 
     bool m_HasDepthAttachment;
+    bool m_OwnsDepthAttachment;
     bool m_IsShadowMap;
     std::vector<Texture2D::Ptr> m_ColorAttachments;
     Texture2D::Ptr m_DepthAttachment;
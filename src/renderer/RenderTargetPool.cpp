@@ -0,0 +1,131 @@
+#include "renderer/RenderTargetPool.h"
+
+#include <iostream>
+
+#include "utility/StatusRecorder.h"
+
+RenderTargetPool::RenderTargetPool()
+    : m_FrameIndex(0)
+{ }
+
+void RenderTargetPool::BeginFrame()
+{
+    ++m_FrameIndex;
+
+    for (size_t i = 0; i < m_Entries.size(); )
+    {
+        Entry &entry = m_Entries[i];
+        if (entry.InUse && entry.Target->IsDepthShared())
+        {
+            entry.Target->SetDepthAttachment(nullptr);
+        }
+        entry.InUse = false;
+
+        if (m_FrameIndex - entry.LastUsedFrame > EVICTION_FRAMES)
+        {
+            entry = m_Entries.back();
+            m_Entries.pop_back();
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+RenderTarget::Ptr RenderTargetPool::Acquire(const glm::u32vec2 &size, GLenum type, unsigned int colorAttachmentsNum, bool hasDepth)
+{
+    Entry *match = nullptr;
+    Entry *resizable = nullptr;
+    for (size_t i = 0; i < m_Entries.size(); ++i)
+    {
+        Entry &entry = m_Entries[i];
+        if (entry.InUse || entry.Type != type || entry.ColorAttachmentsNum != colorAttachmentsNum || entry.HasDepth != hasDepth)
+        {
+            continue;
+        }
+
+        if (entry.Size == size)
+        {
+            match = &entry;
+            break;
+        }
+
+        // The least recently used one, a target of this frame may be asked again with its size by a later pass
+        if (entry.LastUsedFrame < m_FrameIndex && (resizable == nullptr || entry.LastUsedFrame < resizable->LastUsedFrame))
+        {
+            resizable = &entry;
+        }
+    }
+
+    if (match == nullptr && resizable != nullptr)
+    {
+        resizable->Target->SetSize(size);
+        resizable->Size = size;
+        match = resizable;
+        ++StatusRecorder::RenderTargetAllocations;
+    }
+
+    if (match == nullptr)
+    {
+        Entry entry;
+        entry.Target = RenderTarget::New(size, type, colorAttachmentsNum, hasDepth);
+        entry.Size = size;
+        entry.Type = type;
+        entry.ColorAttachmentsNum = colorAttachmentsNum;
+        entry.HasDepth = hasDepth;
+        m_Entries.push_back(entry);
+        match = &m_Entries.back();
+        ++StatusRecorder::RenderTargetAllocations;
+    }
+
+    match->InUse = true;
+    match->LastUsedFrame = m_FrameIndex;
+    return match->Target;
+}
+
+void RenderTargetPool::Release(const RenderTarget::Ptr &target)
+{
+    for (size_t i = 0; i < m_Entries.size(); ++i)
+    {
+        if (m_Entries[i].Target == target)
+        {
+            // A shared depth belongs to another target, which may be released or resized before this one is acquired again
+            if (target->IsDepthShared())
+            {
+                target->SetDepthAttachment(nullptr);
+            }
+            m_Entries[i].InUse = false;
+            return;
+        }
+    }
+
+    std::cerr << "RenderTargetPool: releasing a target which is not from the pool" << std::endl;
+}
+
+size_t RenderTargetPool::GetMemorySize() const
+{
+    size_t size = 0;
+    for (size_t i = 0; i < m_Entries.size(); ++i)
+    {
+        const Entry &entry = m_Entries[i];
+        size += GetTargetMemorySize(entry.Size, entry.Type, entry.ColorAttachmentsNum, entry.HasDepth);
+    }
+    return size;
+}
+
+size_t RenderTargetPool::GetTargetMemorySize(const glm::u32vec2 &size, GLenum type, unsigned int colorAttachmentsNum, bool hasDepth)
+{
+    // Matches the internal formats chosen by RenderTarget
+    size_t colorBytes = 4;
+    if (type == GL_HALF_FLOAT)
+    {
+        colorBytes = 8;
+    }
+    else if (type == GL_FLOAT)
+    {
+        colorBytes = 16;
+    }
+
+    return static_cast<size_t>(size.x) * size.y * (colorBytes * colorAttachmentsNum + (hasDepth ? 4 : 0));
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ptr.h"
+#include "renderer/RenderTarget.h"
+
+// Transient render targets shared by the passes of a frame. A target is acquired by its size, type and attachment set,
+// and goes back to the pool when released or at the start of the next frame, so the same framebuffer is reused every frame.
+// If no free target matches, a free target of the same format which was not used in this frame is resized instead of
+// allocating a new one, so a resize reallocates the storage once, the first time a pass asks for the new size.
+// Targets not acquired for EVICTION_FRAMES frames are deleted. A shared depth attachment is detached when the target goes back.
+class RenderTargetPool
+{
+    SHARED_PTR(RenderTargetPool)
+public:
+    static constexpr uint32_t EVICTION_FRAMES = 8;
+
+    RenderTargetPool();
+
+    // Release all the targets of the last frame and delete the unused ones
+    void BeginFrame();
+
+    // The target is only valid until it is released or the next BeginFrame()
+    RenderTarget::Ptr Acquire(const glm::u32vec2 &size, GLenum type = GL_UNSIGNED_BYTE, unsigned int colorAttachmentsNum = 1, bool hasDepth = false);
+    // Hand the target back before the end of the frame, so a later pass can reuse it
+    void Release(const RenderTarget::Ptr &target);
+
+    size_t GetTargetCount() const { return m_Entries.size(); }
+    // Estimated bytes of all the attachments of the pooled targets
+    size_t GetMemorySize() const;
+    // Estimated bytes of the attachments of a target
+    static size_t GetTargetMemorySize(const glm::u32vec2 &size, GLenum type, unsigned int colorAttachmentsNum, bool hasDepth);
+
+private:
+    struct Entry
+    {
+        RenderTarget::Ptr Target;
+        glm::u32vec2 Size;
+        GLenum Type;
+        unsigned int ColorAttachmentsNum;
+        bool HasDepth;
+        bool InUse;
+        uint64_t LastUsedFrame;
+    };
+
+    std::vector<Entry> m_Entries;
+    uint64_t m_FrameIndex;
+};
@@ -2,33 +2,20 @@
 
 #include "renderer/Blitter.h"
 
-ScreenSpaceAmbientOcclusion::ScreenSpaceAmbientOcclusion()
+ScreenSpaceAmbientOcclusion::ScreenSpaceAmbientOcclusion(const RenderTargetPool::Ptr &renderTargetPool)
+    : m_RenderTargetPool(renderTargetPool)
 {
     m_SSAOMat = Material::New("SSAO", "ssao/SSAO.vs", "ssao/SSAO.fs");
     m_BilateralBlurMat = Material::New("Bilateral Blur", "ssao/SSAO.vs", "ssao/BilateralBlur.fs");
     m_FinalBilateralBlurMat = Material::New("Final Bilateral Blur", "ssao/SSAO.vs", "ssao/FinalBilateralBlur.fs");
-    
-    m_SSAORenderTarget = RenderTarget::New(1, 1, GL_HALF_FLOAT, 1, true);
-    m_FinalSSAO = RenderTarget::New(1, 1, GL_HALF_FLOAT, 1);
-}
-
-void ScreenSpaceAmbientOcclusion::SetRenderSize(const size_t &width, const size_t &height)
-{
-    m_SSAORenderTarget->SetSize(width, height);
-    m_FinalSSAO->SetSize(width, height);
 }
 
-void ScreenSpaceAmbientOcclusion::CopyDepth(const RenderTarget::Ptr source)
+void ScreenSpaceAmbientOcclusion::Render(const RenderTarget::Ptr source, const RenderTarget::Ptr destination, const GLStateCache::Ptr glStateCache)
 {
-    Blitter::CopyDepth(source, m_SSAORenderTarget);
-}
-
-void ScreenSpaceAmbientOcclusion::Render(const RenderTarget::Ptr source, const GLStateCache::Ptr glStateCache)
-{
-    // Copy depth to ssao render target for depth testing to skip pixels at max 1.0 (i.e. the skybox)
-    CopyDepth(source);
+    // No depth attachment, the shader skips the pixels at max depth (i.e. the skybox) itself
+    m_SSAORenderTarget = m_RenderTargetPool->Acquire(source->GetSize(), GL_HALF_FLOAT, 1);
 
-    glStateCache->SetDepthFunc(GL_NOTEQUAL);
+    glStateCache->SetDepthTest(false);
 
     m_SSAOMat->AddOrSetTexture("uDepthTexture", source->GetDepthTexture());
 
@@ -38,29 +25,20 @@ void ScreenSpaceAmbientOcclusion::Render(const RenderTarget::Ptr source, const G
 
     Blitter::RenderToTarget(m_SSAORenderTarget, m_SSAOMat, true, false);
 
-    glStateCache->SetDepthTest(false);
-
     // bilateral blur horizontal
     glm::u32vec2 size = m_SSAORenderTarget->GetSize();
     glm::vec4 offset = glm::vec4(1.0f / size.x, 0.0f, 0.0f, 0.0f);
     m_BilateralBlurMat->AddOrSetVector("uOffset", offset);
-    Blitter::BlitCameraTexture(m_SSAORenderTarget, m_FinalSSAO, m_BilateralBlurMat);
+    Blitter::BlitCameraTexture(m_SSAORenderTarget, destination, m_BilateralBlurMat);
     
     // bilateral blur vertical
     offset = glm::vec4(0.0f, 1.0f / size.y, 0.0f, 0.0f);
     m_BilateralBlurMat->AddOrSetVector("uOffset", offset);
-    Blitter::BlitCameraTexture(m_FinalSSAO, m_SSAORenderTarget, m_BilateralBlurMat);
+    Blitter::BlitCameraTexture(destination, m_SSAORenderTarget, m_BilateralBlurMat);
     
     // final bilateral blur
-    Blitter::BlitCameraTexture(m_SSAORenderTarget, m_FinalSSAO, m_FinalBilateralBlurMat);
-}
+    Blitter::BlitCameraTexture(m_SSAORenderTarget, destination, m_FinalBilateralBlurMat);
 
-Texture2D::Ptr ScreenSpaceAmbientOcclusion::GetSSAO()
-{
-    return m_SSAORenderTarget->GetColorTexture(0);
-}
-
-Texture2D::Ptr ScreenSpaceAmbientOcclusion::GetFinalSSAO()
-{
-    return m_FinalSSAO->GetColorTexture(0);
+    m_RenderTargetPool->Release(m_SSAORenderTarget);
+    m_SSAORenderTarget = nullptr;
 }
@@ -4,6 +4,7 @@
 #include "ptr.h"
 #include "base/Texture2D.h"
 #include "renderer/RenderTarget.h"
+#include "renderer/RenderTargetPool.h"
 #include "base/Material.h"
 
 #include "renderer/GLStateCache.h"
@@ -12,15 +13,11 @@ class ScreenSpaceAmbientOcclusion
 {
     SHARED_PTR(ScreenSpaceAmbientOcclusion)
 public:
-    ScreenSpaceAmbientOcclusion();
+    ScreenSpaceAmbientOcclusion(const RenderTargetPool::Ptr &renderTargetPool);
     ~ScreenSpaceAmbientOcclusion() = default;
     
-    void SetRenderSize(const size_t &width, const size_t &height);
-    void CopyDepth(const RenderTarget::Ptr source);
-    void Render(const RenderTarget::Ptr source, const GLStateCache::Ptr glStateCache);
-
-    Texture2D::Ptr GetSSAO();
-    Texture2D::Ptr GetFinalSSAO();
+    // Render the blurred occlusion of the depth of the source to the destination, the intermediate target is taken from the pool
+    void Render(const RenderTarget::Ptr source, const RenderTarget::Ptr destination, const GLStateCache::Ptr glStateCache);
     
 private:
     
@@ -28,8 +25,8 @@ private:
     Material::Ptr m_BilateralBlurMat;
     Material::Ptr m_FinalBilateralBlurMat;
     
+    RenderTargetPool::Ptr m_RenderTargetPool;
     RenderTarget::Ptr m_SSAORenderTarget;
-    RenderTarget::Ptr m_FinalSSAO;
 };
 
 #endif
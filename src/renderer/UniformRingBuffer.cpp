@@ -0,0 +1,124 @@
+#include "renderer/UniformRingBuffer.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "utility/StatusRecorder.h"
+
+UniformRingBuffer::UniformRingBuffer(GLuint binding, uint32_t regionSize)
+    : m_BufferID(0), m_Binding(binding), m_RegionSize(regionSize), m_RegionStride(regionSize), m_CurrentRegion(0), m_RegionWritten(false)
+{
+    for (uint32_t i = 0; i < REGION_COUNT; ++i)
+    {
+        m_Fences[i] = nullptr;
+    }
+
+    glGenBuffers(1, &m_BufferID);
+    CreateStorage();
+}
+
+UniformRingBuffer::~UniformRingBuffer()
+{
+    for (uint32_t i = 0; i < REGION_COUNT; ++i)
+    {
+        if (m_Fences[i])
+        {
+            glDeleteSync(m_Fences[i]);
+            m_Fences[i] = nullptr;
+        }
+    }
+    glDeleteBuffers(1, &m_BufferID);
+    m_BufferID = 0;
+}
+
+void UniformRingBuffer::Reserve(uint32_t regionSize)
+{
+    if (regionSize <= m_RegionSize)
+    {
+        return;
+    }
+
+    // glBufferData orphans the storage the GPU may still read, the fences of the old regions are not needed anymore
+    for (uint32_t i = 0; i < REGION_COUNT; ++i)
+    {
+        if (m_Fences[i])
+        {
+            glDeleteSync(m_Fences[i]);
+            m_Fences[i] = nullptr;
+        }
+    }
+    m_RegionSize = regionSize;
+    m_CurrentRegion = 0;
+    m_RegionWritten = false;
+    CreateStorage();
+}
+
+void UniformRingBuffer::CreateStorage()
+{
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_RegionStride = alignment > 0 ? (m_RegionSize + alignment - 1) / alignment * alignment : m_RegionSize;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_BufferID);
+    glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(m_RegionStride) * REGION_COUNT, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferRange(GL_UNIFORM_BUFFER, m_Binding, m_BufferID, 0, m_RegionSize);
+}
+
+uint32_t UniformRingBuffer::Upload(const void *data, uint32_t size)
+{
+    if (size > m_RegionSize)
+    {
+        std::cerr << "Uniform ring buffer upload of " << size << " bytes is larger than the region of " << m_RegionSize << " bytes" << std::endl;
+        size = m_RegionSize;
+    }
+
+    // The draws reading the current region have all been submitted
+    if (m_RegionWritten)
+    {
+        m_Fences[m_CurrentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_CurrentRegion = (m_CurrentRegion + 1) % REGION_COUNT;
+    }
+    WaitForRegion(m_CurrentRegion);
+
+    GLintptr offset = static_cast<GLintptr>(m_CurrentRegion) * m_RegionStride;
+    glBindBuffer(GL_UNIFORM_BUFFER, m_BufferID);
+    void *mapped = glMapBufferRange(GL_UNIFORM_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (mapped)
+    {
+        std::memcpy(mapped, data, size);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+    }
+    else
+    {
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, m_Binding, m_BufferID, offset, m_RegionSize);
+    m_RegionWritten = true;
+    return static_cast<uint32_t>(offset);
+}
+
+void UniformRingBuffer::WaitForRegion(uint32_t region)
+{
+    GLsync fence = m_Fences[region];
+    if (!fence)
+    {
+        return;
+    }
+
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        // The GPU is REGION_COUNT uploads behind, wait for it, flushing the commands so the fence can be signaled
+        StatusRecorder::UniformRingWaits++;
+        do
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+
+    glDeleteSync(fence);
+    m_Fences[region] = nullptr;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h>
+
+#include "ptr.h"
+
+// Uniform buffer split into REGION_COUNT regions which are written in turn, so the CPU never writes the region the GPU is reading.
+// A region is written through an unsynchronized mapping, which does not wait for the draws still using the buffer.
+// The fence inserted when the next region is written guards the previous one, it is only waited for if the GPU is
+// more than REGION_COUNT - 1 uploads behind.
+class UniformRingBuffer
+{
+    SHARED_PTR(UniformRingBuffer)
+public:
+    static constexpr uint32_t REGION_COUNT = 3;
+
+    UniformRingBuffer(GLuint binding, uint32_t regionSize);
+    ~UniformRingBuffer();
+
+    // Write the data to the next region and bind that region to the binding point, returns the offset of the region
+    uint32_t Upload(const void *data, uint32_t size);
+    // Make the regions at least regionSize bytes, the content is lost if they grow
+    void Reserve(uint32_t regionSize);
+
+    GLuint GetBufferID() const { return m_BufferID; }
+    uint32_t GetCurrentOffset() const { return m_CurrentRegion * m_RegionStride; }
+    uint32_t GetRegionSize() const { return m_RegionSize; }
+
+private:
+    void CreateStorage();
+    // Wait until the GPU has finished the draws of the region
+    void WaitForRegion(uint32_t region);
+
+    GLuint m_BufferID;
+    GLuint m_Binding;
+    uint32_t m_RegionSize;
+    uint32_t m_RegionStride;        // The region size aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    uint32_t m_CurrentRegion;
+    bool m_RegionWritten;
+    GLsync m_Fences[REGION_COUNT];
+};
@@ -6,25 +6,37 @@
 #include <assert.h>
 
 SceneNode::SceneNode()
-    : ModelMatrix(glm::mat4(1.0f)), Transform(glm::mat4(1.0f)), IsAABBCalculated(false)
-{ }
+    : IsAABBCalculated(false), IsStatic(false), m_ModelMatrix(glm::mat4(1.0f)), m_Transform(glm::mat4(1.0f))
+{
+    m_TransformHandle = TransformHierarchy::Get().Allocate();
+}
 
 SceneNode::~SceneNode()
 {
     m_Children.clear();
+
+    TransformHierarchy::Get().Release(m_TransformHandle);
 }
 
-glm::mat4 SceneNode::GetModelMatrix()
+const glm::mat4& SceneNode::GetModelMatrix()
 {
-    glm::mat4 model = ModelMatrix;
-    SceneNode::Ptr currentParent = m_Parent.lock();
-    while (currentParent)
-    {
-        model = currentParent->Transform * currentParent->ModelMatrix * model;
-        currentParent = currentParent->m_Parent.lock();
-    }
+    return TransformHierarchy::Get().GetWorldMatrix(m_TransformHandle);
+}
 
-    return Transform * model;
+const glm::mat3& SceneNode::GetNormalMatrix()
+{
+    return TransformHierarchy::Get().GetNormalMatrix(m_TransformHandle);
+}
+
+void SceneNode::SetModelMatrix(const glm::mat4 &model)
+{
+    m_ModelMatrix = model;
+    UpdateLocalMatrix();
+}
+
+void SceneNode::UpdateLocalMatrix()
+{
+    TransformHierarchy::Get().SetLocalMatrix(m_TransformHandle, m_Transform * m_ModelMatrix);
 }
 
 void SceneNode::SetOverrideMaterial(Material::Ptr mat)
@@ -36,19 +48,34 @@ void SceneNode::SetOverrideMaterial(Material::Ptr mat)
     }
 }
 
+void SceneNode::SetStatic(bool isStatic, bool recursive)
+{
+    IsStatic = isStatic;
+    if (recursive)
+    {
+        for (size_t i = 0; i < m_Children.size(); ++i)
+        {
+            m_Children[i]->SetStatic(isStatic, recursive);
+        }
+    }
+}
+
 void SceneNode::Translate(const glm::vec3 &p)
 {
-    Transform = glm::translate(Transform, p);
+    m_Transform = glm::translate(m_Transform, p);
+    UpdateLocalMatrix();
 }
 
 void SceneNode::Rotate(const glm::vec3 &axis, const float &radians)
 {
-    Transform = glm::rotate(Transform, radians, axis);
+    m_Transform = glm::rotate(m_Transform, radians, axis);
+    UpdateLocalMatrix();
 }
 
 void SceneNode::Scale(const glm::vec3 &scale)
 {
-    Transform = glm::scale(Transform, scale);
+    m_Transform = glm::scale(m_Transform, scale);
+    UpdateLocalMatrix();
 }
 
 void SceneNode::AddChild(SceneNode::Ptr node)
@@ -58,27 +85,21 @@ void SceneNode::AddChild(SceneNode::Ptr node)
 
     node->m_Parent = getWeakPtr();
     m_Children.push_back(node);
+
+    TransformHierarchy::Get().SetParent(node->m_TransformHandle, m_TransformHandle);
 }
 
-void SceneNode::MergeChildrenAABBs(BoundingBox &boundingBox, bool &firstMerge)
+void SceneNode::SetAABB(const BoundingBox &aabb)
 {
-    if (IsAABBCalculated)
-    {
-        if (firstMerge)
-        {
-            firstMerge = !firstMerge;
-            BoundingBox::CreateFromBoundingBoxAndTransform(boundingBox, AABB, GetModelMatrix());
-        }
-        else
-        {
-            boundingBox.MergeBoundingBox(AABB, GetModelMatrix());
-        }
-    }
+    AABB = aabb;
+    IsAABBCalculated = true;
 
-    for (size_t i = 0; i < m_Children.size(); ++i)
-    {
-        m_Children[i]->MergeChildrenAABBs(boundingBox, firstMerge);
-    }
+    TransformHierarchy::Get().SetLocalBounds(m_TransformHandle, aabb);
+}
+
+bool SceneNode::GetSubtreeAABB(BoundingBox &outAABB)
+{
+    return TransformHierarchy::Get().GetSubtreeBounds(m_TransformHandle, outAABB);
 }
 
 size_t SceneNode::GetChildrenCount()
@@ -6,6 +6,7 @@
 
 #include "ptr.h"
 #include "renderer/MeshRender.h"
+#include "scene/TransformHierarchy.h"
 
 #include "utility/Collision.h"
 
@@ -22,7 +23,17 @@ public:
     SceneNode();
     ~SceneNode();
 
-    glm::mat4 GetModelMatrix();
+    // World matrices are stored in the TransformHierarchy, they are valid after TransformHierarchy::UpdateWorldMatrices() was called in current frame
+    const glm::mat4& GetModelMatrix();
+    const glm::mat3& GetNormalMatrix();
+
+    // Transform of this node relative to its parent (e.g. the transformation of an assimp node)
+    void SetModelMatrix(const glm::mat4 &model);
+    // Full transform of this node relative to its parent, Translate/Rotate/Scale included
+    glm::mat4 GetLocalMatrix() const { return m_Transform * m_ModelMatrix; }
+
+    // Static nodes never move after they are loaded, so their meshes can be merged by StaticBatcher
+    void SetStatic(bool isStatic, bool recursive = true);
 
     void SetOverrideMaterial(Material::Ptr mat);
 
@@ -34,19 +45,28 @@ public:
     SceneNode::Ptr GetChildByIndex(size_t index);
     void AddChild(SceneNode::Ptr node);
 
-    void MergeChildrenAABBs(BoundingBox &boundingBox, bool &firstMerge);
+    // Bounding box of the meshes of this node in model space
+    void SetAABB(const BoundingBox &aabb);
+    // Cached world space bounds of this node and all its children
+    bool GetSubtreeAABB(BoundingBox &outAABB);
 
     std::vector<MeshRender::Ptr> MeshRenders;
-    glm::mat4 ModelMatrix;
 
     Material::Ptr OverrideMat;
-    
-    glm::mat4 Transform;
 
     bool IsAABBCalculated;
+    bool IsStatic;
     BoundingBox AABB;
 
 private:
+    // Push Transform * ModelMatrix to the hierarchy, this marks the node dirty
+    void UpdateLocalMatrix();
+
     std::weak_ptr<SceneNode> m_Parent;
     std::vector<SceneNode::Ptr> m_Children;
+
+    TransformHierarchy::Handle m_TransformHandle;
+
+    glm::mat4 m_ModelMatrix;
+    glm::mat4 m_Transform;
 };
@@ -1,5 +1,8 @@
 #include "scene/SceneRenderGraph.h"
 
+#include <chrono>
+#include <algorithm>
+
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -10,11 +13,12 @@
 #include "lights/DirectionalLight.h"
 
 #include "utility/StatusRecorder.h"
+#include "utility/AllocationCounter.h"
 
 using namespace Collision;
 
 SceneRenderGraph::SceneRenderGraph()
-    : m_GlobalUniformBufferID(0), m_RenderSize(u32vec2(1))
+    : m_RenderSize(u32vec2(1)), m_BoundedSceneMeshCount(0), m_SceneMeshesDirty(true), m_SceneMeshesWorldVersion(0), m_GlobalUniforms()
 { }
 
 void SceneRenderGraph::Init()
@@ -22,39 +26,40 @@ void SceneRenderGraph::Init()
     m_Scene = SceneNode::New();
 
     m_CommandBuffer = CommandBuffer::New();
+    m_InstanceBuffer = InstanceBuffer::New();
+    m_DrawUniformBuffer = DrawUniformBuffer::New();
     
     // OpenGL state
     m_GLStateCache = GLStateCache::New();
     m_GLStateCache->InitState();
 
-    // Global uniform buffer object
-    glGenBuffers(1, &m_GlobalUniformBufferID);
-    glBindBuffer(GL_UNIFORM_BUFFER, m_GlobalUniformBufferID);
-    glBufferData(GL_UNIFORM_BUFFER, 672, nullptr, GL_STATIC_DRAW);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, m_GlobalUniformBufferID); // Set global uniform to binding point 0
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    // Global uniform buffer object, bound to binding point 0
+    m_GlobalUniformBuffer = UniformRingBuffer::New(0, static_cast<uint32_t>(sizeof(GlobalUniforms)));
 
     // Initialize Blitter
     Blitter::Init();
 
-    m_IntermediateRT = RenderTarget::New(1, 1, GL_HALF_FLOAT, 1, true);
+    m_RenderTargetPool = RenderTargetPool::New();
+    m_FrameGraph = FrameGraph::New(m_RenderTargetPool);
 
     // Environment IBL
-    m_EnvIBL = EnvironmentIBL::New("textures/environments/papermill.hdr", m_GlobalUniformBufferID);
+    m_EnvIBL = EnvironmentIBL::New("textures/environments/papermill.hdr", m_GlobalUniformBuffer);
 
     // Directional shadow map
     m_DirectionalShadowMap = DirectionalLightShadowMap::New();
     m_DirectionalShadowMap->SetCascadeShadowMapsEnabled(true);
     
     // Post processing
-    m_PostProcessing = PostProcessing::New();
+    m_PostProcessing = PostProcessing::New(m_RenderTargetPool);
     
     // Deffered rendering gbuffer
-    m_GBufferRT = RenderTarget::New(1, 1, GL_HALF_FLOAT, 4, true);
     m_DeferredLightingMat = Material::New("Deferred Lighting", "utils/FullScreenTriangle.vs", "DeferredLit.fs");
+
+    // Forward rendering depth pre-pass
+    m_DepthPrePassMat = Material::New("Depth Pre-Pass", "DepthOnly.vs", "DepthOnly.fs");
     
     // SSAO
-    m_ScreenSpaceAmbientOcclusion = ScreenSpaceAmbientOcclusion::New();
+    m_ScreenSpaceAmbientOcclusion = ScreenSpaceAmbientOcclusion::New(m_RenderTargetPool);
 
     m_DebuggingAABBMat = Material::New("Draw AABB", "utils/DrawBoundingBox.vs", "utils/DrawBoundingBox.fs");
     m_DebuggingAABBMat->SetRenderFace(Material::RenderFace::BOTH);
@@ -65,7 +70,7 @@ void SceneRenderGraph::Cleanup()
     // Cleanup Blitter
     Blitter::Cleanup();
     
-    glDeleteBuffers(1, &m_GlobalUniformBufferID);
+    m_GlobalUniformBuffer = nullptr;
 }
 
 void SceneRenderGraph::SetRenderSize(const int &width, const int &height)
@@ -75,11 +80,7 @@ void SceneRenderGraph::SetRenderSize(const int &width, const int &height)
 
     m_Camera->SetScreenSize(width, height);
 
-    m_IntermediateRT->SetSize(glm::u32vec2(width, height));
-
-    m_GBufferRT->SetSize(width, height);
-
-    m_ScreenSpaceAmbientOcclusion->SetRenderSize(width, height);
+    // The render targets are acquired from the pool at the new size in the next frame
 }
 
 void SceneRenderGraph::SetCamera(Camera::Ptr camera)
@@ -95,6 +96,38 @@ void SceneRenderGraph::SetMainLight(DirectionalLight::Ptr light)
 void SceneRenderGraph::AddSceneNode(SceneNode::Ptr sceneNode)
 {
     m_Scene->AddChild(sceneNode);
+
+    // The BVH is rebuilt in the next frame, the node and its children must be complete when added
+    m_SceneMeshesDirty = true;
+
+    PrewarmShaderVariants(sceneNode);
+}
+
+void SceneRenderGraph::PrewarmShaderVariants(SceneNode::Ptr sceneNode)
+{
+    // The same lighting features as the frame sets, the variants only change later if a setting is toggled
+    bool forwardSSAO = !StatusRecorder::DeferredRendering && StatusRecorder::DepthPrePass && StatusRecorder::SSAO;
+    bool shadows = m_MainLight && m_MainLight->IsCastShadow();
+    for (size_t i = 0; i < sceneNode->MeshRenders.size(); ++i)
+    {
+        Material *mat = sceneNode->OverrideMat ? sceneNode->OverrideMat.get() : sceneNode->MeshRenders[i]->GetMaterial().get();
+        if (mat->GetMaterialCastShadows())
+        {
+            mat->SetFeature(ShaderFeature::SHADOW_MAP, shadows);
+        }
+        mat->SetFeature(ShaderFeature::SSAO, forwardSSAO && mat->GetAlphaMode() != Material::AlphaMode::BLEND);
+
+        mat->GetShader();
+        if (StatusRecorder::Instancing && mat->GetAlphaMode() != Material::AlphaMode::BLEND)
+        {
+            mat->GetInstancedShader();
+        }
+    }
+
+    for (size_t i = 0; i < sceneNode->GetChildrenCount(); ++i)
+    {
+        PrewarmShaderVariants(sceneNode->GetChildByIndex(i));
+    }
 }
 
 void SceneRenderGraph::BuildSkyboxRenderCommands()
@@ -104,17 +137,20 @@ void SceneRenderGraph::BuildSkyboxRenderCommands()
 
 void SceneRenderGraph::BuildRenderCommands(SceneNode::Ptr sceneNode)
 {
-    mat4 model = sceneNode->GetModelMatrix();
-    Material::Ptr overrideMat = sceneNode->OverrideMat;
+    const mat4 &model = sceneNode->GetModelMatrix();
+    const mat3 &normalMatrix = sceneNode->GetNormalMatrix();
+    const Material::Ptr &overrideMat = sceneNode->OverrideMat;
     for (size_t i = 0; i < sceneNode->MeshRenders.size(); ++i)
     {
-        m_CommandBuffer->PushCommand(sceneNode->MeshRenders[i]->GetMesh(), overrideMat ? overrideMat : sceneNode->MeshRenders[i]->GetMaterial(), model);
+        m_CommandBuffer->PushCommand(sceneNode->MeshRenders[i]->GetMesh().get(), overrideMat ? overrideMat.get() : sceneNode->MeshRenders[i]->GetMaterial().get(), model, normalMatrix);
     }
 
     // Debugging render node AABB
     if (sceneNode->IsAABBCalculated && false)
     {
-        m_CommandBuffer->PushDebuggingCommand(AABBCube::New(sceneNode->AABB.GetCorners()), m_DebuggingAABBMat, model);
+        vec3 corners[BoundingBox::CORNER_COUNT];
+        sceneNode->AABB.GetCorners(corners);
+        m_CommandBuffer->PushDebuggingCommand(AABBCube::New(std::vector<vec3>(corners, corners + BoundingBox::CORNER_COUNT)), m_DebuggingAABBMat.get(), model);
     }
 
     for (size_t i = 0; i < sceneNode->GetChildrenCount(); ++i)
@@ -123,10 +159,150 @@ void SceneRenderGraph::BuildRenderCommands(SceneNode::Ptr sceneNode)
     }
 }
 
+void SceneRenderGraph::CollectSceneMeshes(SceneNode::Ptr sceneNode)
+{
+    for (size_t i = 0; i < sceneNode->MeshRenders.size(); ++i)
+    {
+        SceneMesh sceneMesh;
+        sceneMesh.Node = sceneNode;
+        sceneMesh.Render = sceneNode->MeshRenders[i];
+        m_SceneMeshes.push_back(sceneMesh);
+    }
+
+    for (size_t i = 0; i < sceneNode->GetChildrenCount(); ++i)
+    {
+        CollectSceneMeshes(sceneNode->GetChildByIndex(i));
+    }
+}
+
+void SceneRenderGraph::UpdateSceneMeshes()
+{
+    const uint32_t worldVersion = TransformHierarchy::Get().GetWorldVersion();
+    const bool rebuild = m_SceneMeshesDirty;
+    if (!rebuild && worldVersion == m_SceneMeshesWorldVersion)
+    {
+        return;
+    }
+
+    if (rebuild)
+    {
+        m_SceneMeshes.clear();
+        CollectSceneMeshes(m_Scene);
+
+        // Meshes with bounds first, they are the items of the BVH
+        auto boundedEnd = std::stable_partition(m_SceneMeshes.begin(), m_SceneMeshes.end(), [](const SceneMesh &sceneMesh) { return sceneMesh.Render->HasBounds(); });
+        m_BoundedSceneMeshCount = static_cast<size_t>(boundedEnd - m_SceneMeshes.begin());
+
+        m_SceneShadowCasters.assign(m_SceneMeshes.size(), ::RenderCommand());
+        for (size_t i = 0; i < m_SceneMeshes.size(); ++i)
+        {
+            m_SceneShadowCasters[i].Mesh = m_SceneMeshes[i].Render->GetMesh().get();
+            m_SceneShadowCasters[i].IndexOffset = m_SceneMeshes[i].Render->GetIndexOffset();
+            m_SceneShadowCasters[i].IndexCount = m_SceneMeshes[i].Render->GetIndexCount();
+            m_SceneShadowCasters[i].DrawIndex = static_cast<uint32_t>(i);
+        }
+        m_DrawUniformBuffer->Resize(static_cast<uint32_t>(m_SceneMeshes.size()));
+        m_SceneMeshBounds.resize(m_BoundedSceneMeshCount);
+    }
+
+    for (size_t i = 0; i < m_SceneMeshes.size(); ++i)
+    {
+        const mat4 &model = m_SceneMeshes[i].Node->GetModelMatrix();
+        ::RenderCommand &caster = m_SceneShadowCasters[i];
+        caster.Transform = model;
+        // The entry of the scene mesh is shared by its draws in all the passes
+        m_DrawUniformBuffer->Set(static_cast<uint32_t>(i), model, m_SceneMeshes[i].Node->GetNormalMatrix());
+        if (i < m_BoundedSceneMeshCount)
+        {
+            BoundingBox::CreateFromBoundingBoxAndTransform(m_SceneMeshBounds[i], m_SceneMeshes[i].Render->GetBounds(), model);
+            caster.WorldBounds = m_SceneMeshBounds[i];
+            caster.HasWorldBounds = true;
+        }
+    }
+
+    auto bvhStart = std::chrono::high_resolution_clock::now();
+    if (rebuild)
+    {
+        m_SceneBVH.Build(m_SceneMeshBounds);
+    }
+    else
+    {
+        m_SceneBVH.Refit(m_SceneMeshBounds);
+    }
+    auto bvhEnd = std::chrono::high_resolution_clock::now();
+    (rebuild ? StatusRecorder::BVHBuildTime : StatusRecorder::BVHRefitTime) = std::chrono::duration<float, std::milli>(bvhEnd - bvhStart).count();
+
+    m_SceneMeshesDirty = false;
+    m_SceneMeshesWorldVersion = worldVersion;
+}
+
+void SceneRenderGraph::BuildSceneRenderCommands()
+{
+    UpdateSceneMeshes();
+
+    // Find the meshes inside the camera frustum, the meshes without bounds are always visible
+    StatusRecorder::BVHQueryTime = 0.0f;
+    m_VisibleSceneMeshes.clear();
+    if (StatusRecorder::FrustumCulling)
+    {
+        FrustumPlanes::CreateFromMatrix(m_CameraFrustumPlanes, m_Camera->GetProjectionMatrix() * m_Camera->GetViewMatrix());
+
+        auto queryStart = std::chrono::high_resolution_clock::now();
+        m_SceneBVH.Query(m_CameraFrustumPlanes, m_VisibleSceneMeshes);
+        auto queryEnd = std::chrono::high_resolution_clock::now();
+        StatusRecorder::BVHQueryTime += std::chrono::duration<float, std::milli>(queryEnd - queryStart).count();
+
+        for (size_t i = m_BoundedSceneMeshCount; i < m_SceneMeshes.size(); ++i)
+        {
+            m_VisibleSceneMeshes.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < m_SceneMeshes.size(); ++i)
+        {
+            m_VisibleSceneMeshes.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    StatusRecorder::VisibleMeshCount = static_cast<unsigned int>(m_VisibleSceneMeshes.size());
+    StatusRecorder::CulledMeshCount = static_cast<unsigned int>(m_SceneMeshes.size() - m_VisibleSceneMeshes.size());
+
+    // The BVH returns the meshes in the order of its leaves, restore the scene order
+    std::sort(m_VisibleSceneMeshes.begin(), m_VisibleSceneMeshes.end());
+
+    for (size_t i = 0; i < m_VisibleSceneMeshes.size(); ++i)
+    {
+        const uint32_t index = m_VisibleSceneMeshes[i];
+        const SceneMesh &sceneMesh = m_SceneMeshes[index];
+        Material* mat = sceneMesh.Node->OverrideMat ? sceneMesh.Node->OverrideMat.get() : sceneMesh.Render->GetMaterial().get();
+
+        ::RenderCommand* command = m_CommandBuffer->PushCommand(sceneMesh.Render->GetMesh().get(), mat, sceneMesh.Node->GetModelMatrix(), sceneMesh.Node->GetNormalMatrix());
+        command->IndexOffset = sceneMesh.Render->GetIndexOffset();
+        command->IndexCount = sceneMesh.Render->GetIndexCount();
+        command->DrawIndex = index;
+        if (index < m_BoundedSceneMeshCount)
+        {
+            command->WorldBounds = m_SceneMeshBounds[index];
+            command->HasWorldBounds = true;
+        }
+    }
+
+    // Materials of the shadow casters may be overridden at any time
+    for (size_t i = 0; i < m_SceneMeshes.size(); ++i)
+    {
+        const SceneMesh &sceneMesh = m_SceneMeshes[i];
+        m_SceneShadowCasters[i].Material = sceneMesh.Node->OverrideMat ? sceneMesh.Node->OverrideMat.get() : sceneMesh.Render->GetMaterial().get();
+    }
+}
+
 void SceneRenderGraph::CalculateSceneAABB()
 {
-    bool firstMerge = true;
-    m_Scene->MergeChildrenAABBs(m_Scene->AABB, firstMerge);
+    // Only the nodes whose transform changed since the last frame are re-merged
+    auto boundsUpdateStart = std::chrono::high_resolution_clock::now();
+    TransformHierarchy::Get().UpdateBounds();
+    m_Scene->GetSubtreeAABB(m_Scene->AABB);
+    auto boundsUpdateEnd = std::chrono::high_resolution_clock::now();
+    StatusRecorder::SceneBoundsUpdateTime = std::chrono::duration<float, std::milli>(boundsUpdateEnd - boundsUpdateStart).count();
 
 //    // Debugging camera's frustum
 //    BoundingFrustum bf;
@@ -142,191 +318,484 @@ void SceneRenderGraph::CalculateSceneAABB()
 void SceneRenderGraph::PepareRenderCommands()
 {
     m_CommandBuffer->Clear();
+
+    // Update the cached world matrices of the nodes whose transform changed
+    auto transformUpdateStart = std::chrono::high_resolution_clock::now();
+    TransformHierarchy::Get().UpdateWorldMatrices();
+    auto transformUpdateEnd = std::chrono::high_resolution_clock::now();
+    StatusRecorder::TransformUpdateTime = std::chrono::duration<float, std::milli>(transformUpdateEnd - transformUpdateStart).count();
     
     // Calculate the scene AABB
     CalculateSceneAABB();
 
     // Build scene render commands
-    BuildRenderCommands(m_Scene);
+    BuildSceneRenderCommands();
     
     // Build skybox render commands
     BuildSkyboxRenderCommands();
+
+    // Group the opaque draws by program, textures and material, front-to-back inside a group
+    if (StatusRecorder::SortCommands)
+    {
+        m_CommandBuffer->SortOpaqueCommands(m_Camera->GetViewMatrix(), m_Camera->GetFar());
+    }
+    m_CommandBuffer->SortTransparentCommands(m_Camera->GetViewMatrix(), m_Camera->GetFar());
+
+    // Draw the runs of identical mesh and material with one instanced call
+    m_CommandBuffer->BuildOpaqueBatches(StatusRecorder::Instancing);
+
+    StatusRecorder::InstancedBatchCount = 0;
+    StatusRecorder::InstancedCommandCount = 0;
+    const std::vector<::RenderBatch> &opaqueBatches = m_CommandBuffer->GetOpaqueBatches();
+    StatusRecorder::OpaqueDrawCount = static_cast<unsigned int>(opaqueBatches.size());
+    for (size_t i = 0; i < opaqueBatches.size(); ++i)
+    {
+        if (opaqueBatches[i].InstanceCount > 1)
+        {
+            StatusRecorder::InstancedBatchCount++;
+            StatusRecorder::InstancedCommandCount += opaqueBatches[i].InstanceCount;
+        }
+    }
 }
 
 void SceneRenderGraph::UpdateGlobalUniformsData(const Camera::Ptr camera, const Light::Ptr light)
 {
-    // Set global uniforms
-    glBindBuffer(GL_UNIFORM_BUFFER, m_GlobalUniformBufferID);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, 64, &(camera->GetViewMatrix()[0].x));
-    glBufferSubData(GL_UNIFORM_BUFFER, 64, 64, &(camera->GetProjectionMatrix()[0].x));
-    glBufferSubData(GL_UNIFORM_BUFFER, 128, 16, &(light->GetLightPosition().x));
-    glBufferSubData(GL_UNIFORM_BUFFER, 144, 16, &(light->GetLightColor().x));
-    glBufferSubData(GL_UNIFORM_BUFFER, 160, 16, &(camera->GetEyePosition().x));
-
-    // Set light cascade data
+    GlobalUniforms &uniforms = m_GlobalUniforms;
+    uniforms.ViewFromWorld = camera->GetViewMatrix();
+    uniforms.ClipFromView = camera->GetProjectionMatrix();
+    uniforms.MainLightPosition = light->GetLightPosition();
+    uniforms.MainLightColor = light->GetLightColor();
+    uniforms.CameraPosition = camera->GetEyePosition();
+
+    // Set light cascade data, the last values are kept when the light does not cast shadows
     if (light->IsCastShadow())
     {
-        glBufferSubData(GL_UNIFORM_BUFFER, 176, 256, &(m_DirectionalShadowMap->GetShadowProjections()[0][0].x));
-        glBufferSubData(GL_UNIFORM_BUFFER, 432, 64, &(m_DirectionalShadowMap->GetLightCameraView()[0].x));
-        glBufferSubData(GL_UNIFORM_BUFFER, 496, 64, &(m_DirectionalShadowMap->GetCascadeScalesAndOffsets()[0].x));
-        glBufferSubData(GL_UNIFORM_BUFFER, 560, 16, &(m_DirectionalShadowMap->GetShadowCascadeParams()));
+        const std::vector<mat4> &shadowProjections = m_DirectionalShadowMap->GetShadowProjections();
+        const std::vector<vec4> &cascadeScalesAndOffsets = m_DirectionalShadowMap->GetCascadeScalesAndOffsets();
+        for (size_t i = 0; i < 4 && i < shadowProjections.size(); ++i)
+        {
+            uniforms.ShadowClipFromView[i] = shadowProjections[i];
+        }
+        for (size_t i = 0; i < 4 && i < cascadeScalesAndOffsets.size(); ++i)
+        {
+            uniforms.CascadeScalesAndOffsets[i] = cascadeScalesAndOffsets[i];
+        }
+        uniforms.ShadowViewFromWorld = m_DirectionalShadowMap->GetLightCameraView();
+        uniforms.CascadeParams = m_DirectionalShadowMap->GetShadowCascadeParams();
     }
 
     glm::u32vec2 shadowMapSize = light->GetShadowMapSize();
-    glm::vec4 shadowMapTexelSize = glm::vec4(1.0f / shadowMapSize.x, 1.0f / shadowMapSize.y, shadowMapSize.x, shadowMapSize.y);
-    glBufferSubData(GL_UNIFORM_BUFFER, 576, 16, &shadowMapTexelSize.x);
-    
-    glBufferSubData(GL_UNIFORM_BUFFER, 592, 64, &(glm::inverse(camera->GetProjectionMatrix())[0].x));
-    glm::vec4 zBufferParams = glm::vec4(camera->GetNear(), camera->GetFar(), 0.0f, 0.0f);
-    glBufferSubData(GL_UNIFORM_BUFFER, 656, 16, &zBufferParams.x);
-
-    // Set float[4];
-    // glBufferSubData(GL_UNIFORM_BUFFER, 496, 64, &cascadeScales); does not work?
-    // for (size_t i = 0; i < 4; ++i)
-    //     glBufferSubData(GL_UNIFORM_BUFFER, 496 + (i * 16), 16, &cascadeScales[i]);
+    uniforms.ShadowMapTexelSize = glm::vec4(1.0f / shadowMapSize.x, 1.0f / shadowMapSize.y, shadowMapSize.x, shadowMapSize.y);
+    uniforms.ViewFromClip = camera->GetInverseProjectionMatrix();
+    uniforms.ZBufferParams = glm::vec4(camera->GetNear(), camera->GetFar(), 0.0f, 0.0f);
 
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    // One write per frame, into a region the GPU is not reading
+    m_GlobalUniformBuffer->Upload(&uniforms, sizeof(GlobalUniforms));
 }
 
 void SceneRenderGraph::Render()
 {
-    // Build render commands
+    StatusRecorder::ProgramSwitches = 0;
+    StatusRecorder::TextureBinds = 0;
+    StatusRecorder::UniformUploads = 0;
+    StatusRecorder::UniformBufferBinds = 0;
+    StatusRecorder::DrawUniformUploadBytes = 0;
+    StatusRecorder::VertexArrayBinds = 0;
+    StatusRecorder::RenderTargetAllocations = 0;
+
+    m_RenderTargetPool->BeginFrame();
+
+    // Build render commands, this should not allocate once the arena and the buckets reached the size of the scene
+    size_t allocationCount = AllocationCounter::GetAllocationCount();
     PepareRenderCommands();
+    StatusRecorder::CommandBuildAllocations = static_cast<unsigned int>(AllocationCounter::GetAllocationCount() - allocationCount);
+
+    // Debugging commands are pushed every frame, their entries follow the ones of the scene meshes
+    const std::vector<::RenderCommand*> &debuggingCommands = m_CommandBuffer->GetDebuggingCommands();
+    uint32_t sceneEntryCount = static_cast<uint32_t>(m_SceneMeshes.size());
+    m_DrawUniformBuffer->Resize(sceneEntryCount + static_cast<uint32_t>(debuggingCommands.size()));
+    for (size_t i = 0; i < debuggingCommands.size(); ++i)
+    {
+        debuggingCommands[i]->DrawIndex = sceneEntryCount + static_cast<uint32_t>(i);
+        m_DrawUniformBuffer->Set(debuggingCommands[i]->DrawIndex, debuggingCommands[i]->Transform, debuggingCommands[i]->NormalMatrix);
+    }
+    // The per-draw data of the frame in one write, skipped if no transform changed
+    m_DrawUniformBuffer->Upload();
     
     m_GLStateCache->SetDepthTest(true);
     m_GLStateCache->SetDepthFunc(GL_LESS);
     m_GLStateCache->SetDepthWriteMask(GL_TRUE);
 
-    DirectionalLight::Ptr currentLight = m_MainLight;
-    Camera::Ptr currentCamera = m_Camera;
+    BuildFrameGraph();
+    m_FrameGraph->Compile();
+    m_FrameGraph->Execute();
 
-    // Render shadow map
-    if (currentLight->IsCastShadow())
-    {
-        m_DirectionalShadowMap->RenderShadowMap(currentCamera, currentLight, m_CommandBuffer->GetShadowCasterCommands(), m_Scene);
-    }
+    StatusRecorder::PooledRenderTargetCount = static_cast<unsigned int>(m_RenderTargetPool->GetTargetCount());
+    StatusRecorder::PooledRenderTargetMemory = m_RenderTargetPool->GetMemorySize() / (1024.0f * 1024.0f);
+}
+
+void SceneRenderGraph::BuildFrameGraph()
+{
+    m_FrameGraph->Reset();
 
-    UpdateGlobalUniformsData(currentCamera, currentLight);
-    
     bool isDeferred = StatusRecorder::DeferredRendering;
-    if (isDeferred)
+    bool castShadow = m_MainLight->IsCastShadow();
+
+    // Resources, the passes skip the optional ones they would not use so their producers are culled
+    FrameResources &resources = m_FrameResources;
+    resources.ShadowMap = castShadow ? m_FrameGraph->ImportResource("Shadow Map", m_MainLight->GetShadowMapRT()) : FrameGraph::INVALID_RESOURCE;
+    resources.FrameData = m_FrameGraph->ImportResource("Frame Uniforms", nullptr);
+    resources.Backbuffer = m_FrameGraph->ImportResource("Backbuffer", nullptr, true);
+    resources.GBuffer = isDeferred ? m_FrameGraph->CreateTarget("GBuffer", { m_RenderSize, GL_HALF_FLOAT, 4, true }) : FrameGraph::INVALID_RESOURCE;
+    resources.SSAO = m_FrameGraph->CreateTarget("SSAO", { m_RenderSize, GL_HALF_FLOAT, 1, false });
+    // The deferred path keeps drawing with the depth of the gbuffer instead of a copy of it
+    FrameGraph::TargetDesc intermediateDesc = { m_RenderSize, GL_HALF_FLOAT, 1, !isDeferred, resources.GBuffer };
+    resources.Intermediate = m_FrameGraph->CreateTarget("Intermediate HDR", intermediateDesc);
+    resources.Bloom = m_FrameGraph->CreateTarget("Bloom", { PostProcessing::GetBloomSize(m_RenderSize), GL_HALF_FLOAT, 1, false });
+
+    uint32_t pass;
+    if (castShadow)
     {
-        m_GBufferRT->BindTarget(true, true);
+        pass = m_FrameGraph->AddPass("Shadow Map", [this]() { ExecuteShadowMapPass(); });
+        m_FrameGraph->Write(pass, resources.ShadowMap);
+    }
 
-        unsigned int attachments[4] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
-        glDrawBuffers(4, attachments);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    pass = m_FrameGraph->AddPass("Frame Uniforms", [this]() { ExecuteFrameUniformsPass(); });
+    if (castShadow)
+    {
+        m_FrameGraph->Read(pass, resources.ShadowMap);
+    }
+    m_FrameGraph->Write(pass, resources.FrameData);
 
-        // Opaque
-        std::vector<RenderCommand::Ptr> opaqueCommands = m_CommandBuffer->GetOpaqueCommands();
-        for (size_t i = 0; i < opaqueCommands.size(); ++i)
+    if (isDeferred)
+    {
+        pass = m_FrameGraph->AddPass("GBuffer", [this]() { ExecuteGBufferPass(); });
+        m_FrameGraph->Read(pass, resources.FrameData);
+        m_FrameGraph->Write(pass, resources.GBuffer);
+
+        pass = m_FrameGraph->AddPass("SSAO", [this]() { ExecuteSSAOPass(m_FrameResources.GBuffer); });
+        m_FrameGraph->Read(pass, resources.FrameData);
+        m_FrameGraph->Read(pass, resources.GBuffer);
+        m_FrameGraph->Write(pass, resources.SSAO);
+
+        pass = m_FrameGraph->AddPass("Deferred Lighting", [this]() { ExecuteDeferredLightingPass(); });
+        m_FrameGraph->Read(pass, resources.FrameData);
+        m_FrameGraph->Read(pass, resources.GBuffer);
+        if (castShadow)
         {
-            RenderCommand::Ptr command = opaqueCommands[i];
-            RenderCommand(command, currentLight);
+            m_FrameGraph->Read(pass, resources.ShadowMap);
         }
-
-        attachments[1] = GL_NONE;
-        attachments[2] = GL_NONE;
-        attachments[3] = GL_NONE;
-        glDrawBuffers(4, attachments);
- 
-        // SSAO
         if (StatusRecorder::SSAO)
         {
-            m_ScreenSpaceAmbientOcclusion->Render(m_GBufferRT, m_GLStateCache);
-            // Blitter::BlitCamera(m_ScreenSpaceAmbientOcclusion->GetFinalSSAO(), currentCamera); return;
+            m_FrameGraph->Read(pass, resources.SSAO);
+        }
+        m_FrameGraph->Write(pass, resources.Intermediate);
+    }
+    else
+    {
+        // The depth pre-pass resolves the visibility, so the lighting shader only runs once per pixel
+        bool depthPrePass = StatusRecorder::DepthPrePass;
+        if (depthPrePass)
+        {
+            pass = m_FrameGraph->AddPass("Depth Pre-Pass", [this]() { ExecuteDepthPrePass(); });
+            m_FrameGraph->Read(pass, resources.FrameData);
+            m_FrameGraph->Write(pass, resources.Intermediate);
+
+            // SSAO only needs the depth
+            pass = m_FrameGraph->AddPass("SSAO", [this]() { ExecuteSSAOPass(m_FrameResources.Intermediate); });
+            m_FrameGraph->Read(pass, resources.FrameData);
+            m_FrameGraph->Read(pass, resources.Intermediate);
+            m_FrameGraph->Write(pass, resources.SSAO);
         }
 
-        m_GLStateCache->SetDepthFunc(GL_ALWAYS);
-        // Deferred lighting
-        m_GLStateCache->SetDepthTest(false);
-
-        m_DeferredLightingMat->AddOrSetTexture("uGBuffer0", m_GBufferRT->GetColorTexture(0));
-        m_DeferredLightingMat->AddOrSetTexture("uGBuffer1", m_GBufferRT->GetColorTexture(1));
-        m_DeferredLightingMat->AddOrSetTexture("uGBuffer2", m_GBufferRT->GetColorTexture(2));
-        m_DeferredLightingMat->AddOrSetTexture("uGBuffer3", m_GBufferRT->GetColorTexture(3));
-
-        SetMatIBLAndShadow(m_DeferredLightingMat, currentLight);
-        
-        if (StatusRecorder::SSAO)
+        pass = m_FrameGraph->AddPass("Forward Opaque", [this, depthPrePass]() { ExecuteForwardOpaquePass(depthPrePass); });
+        m_FrameGraph->Read(pass, resources.FrameData);
+        if (castShadow)
         {
-            m_DeferredLightingMat->AddOrSetFloat("uSSAOSet", 1.0f);
-            m_DeferredLightingMat->AddOrSetTexture("uSSAOTexture", m_ScreenSpaceAmbientOcclusion->GetFinalSSAO());
+            m_FrameGraph->Read(pass, resources.ShadowMap);
         }
-        else
+        if (depthPrePass && StatusRecorder::SSAO)
         {
-            m_DeferredLightingMat->AddOrSetFloat("uSSAOSet", -1.0f);
+            m_FrameGraph->Read(pass, resources.SSAO);
         }
+        m_FrameGraph->Write(pass, resources.Intermediate);
+    }
 
-        Blitter::RenderToTarget(m_IntermediateRT, m_DeferredLightingMat);
-        
-        m_GLStateCache->SetDepthTest(true);
+    pass = m_FrameGraph->AddPass("Skybox", [this]() { ExecuteSkyboxPass(); });
+    m_FrameGraph->Read(pass, resources.FrameData);
+    m_FrameGraph->Write(pass, resources.Intermediate);
 
-        // Copy depth
-        Blitter::CopyDepth(m_GBufferRT, m_IntermediateRT);
+    if (!m_CommandBuffer->GetDebuggingCommands().empty())
+    {
+        pass = m_FrameGraph->AddPass("Debugging AABB", [this]() { ExecuteDebuggingPass(); });
+        m_FrameGraph->Read(pass, resources.FrameData);
+        m_FrameGraph->Write(pass, resources.Intermediate);
+    }
 
-        // Bind intermediate framebuffer
-        m_IntermediateRT->BindTarget(false, false);
+    pass = m_FrameGraph->AddPass("Transparent", [this]() { ExecuteTransparentPass(); });
+    m_FrameGraph->Read(pass, resources.FrameData);
+    if (castShadow)
+    {
+        m_FrameGraph->Read(pass, resources.ShadowMap);
     }
-    else
+    m_FrameGraph->Write(pass, resources.Intermediate);
+
+    pass = m_FrameGraph->AddPass("Bloom", [this]() { ExecuteBloomPass(); });
+    m_FrameGraph->Read(pass, resources.Intermediate);
+    m_FrameGraph->Write(pass, resources.Bloom);
+
+    pass = m_FrameGraph->AddPass("Post Processing", [this]() { ExecutePostProcessingPass(); });
+    m_FrameGraph->Read(pass, resources.Intermediate);
+    if (StatusRecorder::Bloom)
     {
-        // Bind intermediate framebuffer
-        m_IntermediateRT->BindTarget(true, true);
+        m_FrameGraph->Read(pass, resources.Bloom);
+    }
+    m_FrameGraph->Write(pass, resources.Backbuffer);
+}
 
-        // Opaque
-        std::vector<RenderCommand::Ptr> opaqueCommands = m_CommandBuffer->GetOpaqueCommands();
-        for (size_t i = 0; i < opaqueCommands.size(); ++i)
+void SceneRenderGraph::ExecuteShadowMapPass()
+{
+    m_DirectionalShadowMap->RenderShadowMap(m_Camera, m_MainLight, m_SceneShadowCasters, m_SceneBVH, m_Scene, m_DrawUniformBuffer);
+}
+
+void SceneRenderGraph::ExecuteFrameUniformsPass()
+{
+    // After the shadow map, the cascades are part of the global uniforms
+    UpdateGlobalUniformsData(m_Camera, m_MainLight);
+
+    m_InstanceBuffer->Upload(m_CommandBuffer->GetInstanceData());
+}
+
+void SceneRenderGraph::ExecuteGBufferPass()
+{
+    m_FrameGraph->GetTarget(m_FrameResources.GBuffer)->BindTarget(true, true);
+
+    unsigned int attachments[4] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
+    glDrawBuffers(4, attachments);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Opaque
+    const std::vector<::RenderBatch> &opaqueBatches = m_CommandBuffer->GetOpaqueBatches();
+    for (size_t i = 0; i < opaqueBatches.size(); ++i)
+    {
+        RenderBatch(opaqueBatches[i], m_MainLight);
+    }
+
+    attachments[1] = GL_NONE;
+    attachments[2] = GL_NONE;
+    attachments[3] = GL_NONE;
+    glDrawBuffers(4, attachments);
+}
+
+void SceneRenderGraph::ExecuteSSAOPass(FrameGraph::Resource depthSource)
+{
+    m_ScreenSpaceAmbientOcclusion->Render(m_FrameGraph->GetTarget(depthSource), m_FrameGraph->GetTarget(m_FrameResources.SSAO), m_GLStateCache);
+    // Blitter::BlitCamera(m_FrameGraph->GetTarget(m_FrameResources.SSAO), m_Camera); return;
+
+    m_GLStateCache->SetDepthTest(true);
+    m_GLStateCache->SetDepthFunc(GL_LESS);
+}
+
+void SceneRenderGraph::ExecuteDeferredLightingPass()
+{
+    RenderTarget::Ptr gbuffer = m_FrameGraph->GetTarget(m_FrameResources.GBuffer);
+    RenderTarget::Ptr intermediate = m_FrameGraph->GetTarget(m_FrameResources.Intermediate);
+    // Null if the SSAO pass was culled
+    RenderTarget::Ptr ssao = m_FrameGraph->GetTarget(m_FrameResources.SSAO);
+
+    m_GLStateCache->SetDepthFunc(GL_ALWAYS);
+    // Deferred lighting
+    m_GLStateCache->SetDepthTest(false);
+
+    m_DeferredLightingMat->AddOrSetTexture("uGBuffer0", gbuffer->GetColorTexture(0));
+    m_DeferredLightingMat->AddOrSetTexture("uGBuffer1", gbuffer->GetColorTexture(1));
+    m_DeferredLightingMat->AddOrSetTexture("uGBuffer2", gbuffer->GetColorTexture(2));
+    m_DeferredLightingMat->AddOrSetTexture("uGBuffer3", gbuffer->GetColorTexture(3));
+
+    SetMatIBLAndShadow(m_DeferredLightingMat.get(), m_MainLight);
+    
+    m_DeferredLightingMat->SetFeature(ShaderFeature::SSAO, ssao != nullptr);
+    if (ssao != nullptr)
+    {
+        m_DeferredLightingMat->AddOrSetTexture("uSSAOTexture", ssao->GetColorTexture(0));
+    }
+
+    // The shared depth of the gbuffer is not cleared
+    Blitter::RenderToTarget(intermediate, m_DeferredLightingMat);
+    
+    m_GLStateCache->SetDepthTest(true);
+}
+
+void SceneRenderGraph::ExecuteDepthPrePass()
+{
+    // Bind intermediate framebuffer
+    m_FrameGraph->GetTarget(m_FrameResources.Intermediate)->BindTarget(true, true);
+
+    RenderDepthPrePass(m_CommandBuffer->GetOpaqueBatches());
+}
+
+void SceneRenderGraph::ExecuteForwardOpaquePass(bool afterDepthPrePass)
+{
+    // Keep the depth of the pre-pass
+    m_FrameGraph->GetTarget(m_FrameResources.Intermediate)->BindTarget(!afterDepthPrePass, !afterDepthPrePass);
+    // Null if the SSAO pass was culled
+    RenderTarget::Ptr ssao = m_FrameGraph->GetTarget(m_FrameResources.SSAO);
+
+    if (afterDepthPrePass)
+    {
+        m_GLStateCache->SetDepthFunc(GL_EQUAL);
+        m_GLStateCache->SetDepthWriteMask(GL_FALSE);
+    }
+
+    // Opaque
+    const std::vector<::RenderBatch> &opaqueBatches = m_CommandBuffer->GetOpaqueBatches();
+    for (size_t i = 0; i < opaqueBatches.size(); ++i)
+    {
+        Material* mat = opaqueBatches[i].Command->Material;
+        mat->SetFeature(ShaderFeature::SSAO, ssao != nullptr);
+        if (ssao != nullptr)
         {
-           RenderCommand::Ptr command = opaqueCommands[i];
-           RenderCommand(command, currentLight);
+            mat->AddOrSetTexture("uSSAOTexture", ssao->GetColorTexture(0));
         }
+        RenderBatch(opaqueBatches[i], m_MainLight);
     }
 
-    // Blitter::BlitCamera(m_IntermediateRT->GetDepthTexture(), currentCamera); return;
+    m_GLStateCache->SetDepthFunc(GL_LESS);
+    m_GLStateCache->SetDepthWriteMask(GL_TRUE);
+}
+
+void SceneRenderGraph::ExecuteSkyboxPass()
+{
+    // Blitter::BlitCamera(m_FrameGraph->GetTarget(m_FrameResources.Intermediate)->GetDepthTexture(), m_Camera); return;
+    m_FrameGraph->GetTarget(m_FrameResources.Intermediate)->BindTarget(false, false);
 
-    // Skybox start ----------------
     // Skybox's depth always is 1.0, is equal to the max depth buffer, rendering skybox after opauqe objects and setting depth func to less&equal will
     // ensure that the skybox is only renderered in pixels that are not covered by the opaque objects.
     // Pixels covered by opaque objects have a depth less than 1.0. Therefore, the depth test will never pass when rendering the skybox.
     m_GLStateCache->SetDepthWriteMask(GL_FALSE);
     m_GLStateCache->SetDepthFunc(GL_LEQUAL);
-    std::vector<RenderCommand::Ptr> skyboxCommands = m_CommandBuffer->GetSkyboxCommands();
+    const std::vector<::RenderCommand*> &skyboxCommands = m_CommandBuffer->GetSkyboxCommands();
     for (size_t i = 0; i < skyboxCommands.size(); ++i)
     {
-        RenderCommand::Ptr command = skyboxCommands[i];
-        RenderCommand(command, currentLight);
+        RenderCommand(skyboxCommands[i], m_MainLight);
     }
     m_GLStateCache->SetDepthWriteMask(GL_TRUE);
     m_GLStateCache->SetDepthFunc(GL_LESS);
-    // Skybox end ----------------
+}
+
+void SceneRenderGraph::ExecuteDebuggingPass()
+{
+    m_FrameGraph->GetTarget(m_FrameResources.Intermediate)->BindTarget(false, false);
 
-    // Debugging AABB
     m_GLStateCache->SetPolygonMode(GL_LINE);
-    std::vector<RenderCommand::Ptr> debuggingCommands = m_CommandBuffer->GetDebuggingCommands();
+    const std::vector<::RenderCommand*> &debuggingCommands = m_CommandBuffer->GetDebuggingCommands();
     for (size_t i = 0; i < debuggingCommands.size(); ++i)
     {
-        RenderCommand::Ptr command = debuggingCommands[i];
-        RenderCommand(command, currentLight);
+        RenderCommand(debuggingCommands[i], m_MainLight);
     }
     m_GLStateCache->SetPolygonMode(GL_FILL);
+}
+
+void SceneRenderGraph::ExecuteTransparentPass()
+{
+    m_FrameGraph->GetTarget(m_FrameResources.Intermediate)->BindTarget(false, false);
+
+    // Transparent, sorted back-to-front. They are hidden by the opaque objects but do not occlude each other
+    m_GLStateCache->SetDepthTest(true);
+    m_GLStateCache->SetDepthFunc(GL_LESS);
+    m_GLStateCache->SetDepthWriteMask(GL_FALSE);
+    const std::vector<::RenderCommand*> &transparentCommands = m_CommandBuffer->GetTransparentCommands();
+
+    // The sorted indices are stored in the mesh, so a mesh drawn by several commands is left unsorted. Sorting it for each
+    // eye in turn would rewrite the shared element buffer between the draws reading it
+    if (StatusRecorder::SortTransparentTriangles)
+    {
+        m_TransparentMeshes.clear();
+        for (size_t i = 0; i < transparentCommands.size(); ++i)
+        {
+            m_TransparentMeshes.push_back(transparentCommands[i]->Mesh);
+        }
+        std::sort(m_TransparentMeshes.begin(), m_TransparentMeshes.end());
+    }
 
-    m_GLStateCache->SetDepthTest(false);
-    // Transparent
-    std::vector<RenderCommand::Ptr> transparentCommands = m_CommandBuffer->GetTransparentCommands();
     for (size_t i = 0; i < transparentCommands.size(); ++i)
     {
-       RenderCommand::Ptr command = transparentCommands[i];
-       RenderCommand(command, currentLight);
+        Mesh *mesh = transparentCommands[i]->Mesh;
+        if (StatusRecorder::SortTransparentTriangles)
+        {
+            auto range = std::equal_range(m_TransparentMeshes.begin(), m_TransparentMeshes.end(), mesh);
+            if (range.second - range.first == 1)
+            {
+                glm::vec3 eyeInModelSpace = glm::vec3(glm::inverse(transparentCommands[i]->Transform) * glm::vec4(m_Camera->GetEyePosition(), 1.0f));
+                mesh->SortTrianglesBackToFront(eyeInModelSpace);
+            }
+        }
+        RenderCommand(transparentCommands[i], m_MainLight);
+    }
+    m_GLStateCache->SetDepthWriteMask(GL_TRUE);
+}
+
+void SceneRenderGraph::ExecuteBloomPass()
+{
+    // Post processing draws full screen quads
+    m_GLStateCache->SetDepthTest(false);
+    m_PostProcessing->Bloom(m_FrameGraph->GetTarget(m_FrameResources.Intermediate), m_FrameGraph->GetTarget(m_FrameResources.Bloom));
+}
+
+void SceneRenderGraph::ExecutePostProcessingPass()
+{
+    m_GLStateCache->SetDepthTest(false);
+    // The bloom is null if its pass was culled
+    m_PostProcessing->Render(m_FrameGraph->GetTarget(m_FrameResources.Intermediate), m_FrameGraph->GetTarget(m_FrameResources.Bloom), m_Camera);
+}
+
+void SceneRenderGraph::RenderCommand(const ::RenderCommand *command, Light::Ptr light)
+{
+    Mesh* mesh = command->Mesh;
+    Material* mat = command->Material;
+
+    ApplyMaterialState(mat);
+
+    SetMatIBLAndShadow(mat, light);
+
+    mat->Use();
+    
+    if (!mat->IsUsedForSkybox())
+    {
+        m_DrawUniformBuffer->Bind(command->DrawIndex);
     }
 
-    m_PostProcessing->Render(m_IntermediateRT, currentCamera);
+    RenderMesh(mesh, command->IndexOffset, command->IndexCount);
 }
 
-void SceneRenderGraph::RenderCommand(RenderCommand::Ptr command, Light::Ptr light)
+void SceneRenderGraph::RenderBatch(const ::RenderBatch &batch, Light::Ptr light)
 {
-    Mesh::Ptr mesh = command->Mesh;
-    Material::Ptr mat = command->Material;
+    Mesh* mesh = batch.Command->Mesh;
+    Material* mat = batch.Command->Material;
+
+    ApplyMaterialState(mat);
+
+    SetMatIBLAndShadow(mat, light);
+
+    if (batch.InstanceCount > 1)
+    {
+        mat->Use(true);
 
+        m_InstanceBuffer->BindToMesh(mesh, batch.FirstInstance);
+        RenderMeshInstanced(mesh, batch.InstanceCount);
+    }
+    else
+    {
+        mat->Use();
+        m_DrawUniformBuffer->Bind(batch.Command->DrawIndex);
+
+        // The range may cover several merged commands
+        RenderMesh(mesh, batch.IndexOffset, batch.IndexCount);
+    }
+}
+
+void SceneRenderGraph::ApplyMaterialState(Material *mat)
+{
     Material::RenderFace face = mat->GetRenderFace();
     if (face == Material::RenderFace::BOTH)
     {
@@ -348,65 +817,63 @@ void SceneRenderGraph::RenderCommand(RenderCommand::Ptr command, Light::Ptr ligh
         m_GLStateCache->SetBlend(false);
         m_GLStateCache->SetBlendFactor(GL_ONE, GL_ZERO);
     }
-
-    SetMatIBLAndShadow(mat, light);
-
-    mat->Use();
-    
-    if (!mat->IsUsedForSkybox())
-    {
-        mat->SetMatrix("uModelToWorld", command->Transform);
-        mat->SetMatrix("uModelNormalToWorld", FastCofactor(mat3x3(command->Transform)));
-    }
-
-    RenderMesh(mesh);
 }
 
-glm::mat3 SceneRenderGraph::FastCofactor(const glm::mat3 &m)
+void SceneRenderGraph::RenderDepthPrePass(const std::vector<::RenderBatch> &batches)
 {
-    // Assuming the input matrix is:
-    // | a b c |
-    // | d e f |
-    // | g h i |
-    //
-    // The cofactor are
-    // | A B C |
-    // | D E F |
-    // | G H I |
-
-    // Where:
-    // A = (ei - fh), B = (fg - di), C = (dh - eg)
-    // D = (ch - bi), E = (ai - cg), F = (bg - ah)
-    // G = (bf - ce), H = (cd - af), I = (ae - bd)
+    m_GLStateCache->SetDepthTest(true);
+    m_GLStateCache->SetDepthFunc(GL_LESS);
+    m_GLStateCache->SetDepthWriteMask(GL_TRUE);
+    m_GLStateCache->SetColorWriteMask(false);
 
-    // Importantly, matrices are column-major!
+    for (size_t i = 0; i < batches.size(); ++i)
+    {
+        const ::RenderBatch &batch = batches[i];
+        Material* mat = batch.Command->Material;
 
-    glm::mat3 cof;
+        ApplyMaterialState(mat);
 
-    const float a = m[0][0];
-    const float b = m[1][0];
-    const float c = m[2][0];
-    const float d = m[0][1];
-    const float e = m[1][1];
-    const float f = m[2][1];
-    const float g = m[0][2];
-    const float h = m[1][2];
-    const float i = m[2][2];
+        // Alpha tested materials must cut the same holes as in the colour pass
+        bool alphaTest = mat->GetAlphaMode() == Material::AlphaMode::MASK;
+        if (alphaTest)
+        {
+            Texture2D::Ptr baseMap = mat->GetTexture("uBaseMap");
+            if (baseMap)
+            {
+                m_DepthPrePassMat->AddOrSetTexture("uBaseMap", baseMap);
+            }
+            m_DepthPrePassMat->SetFeature(ShaderFeature::BASE_MAP, baseMap != nullptr);
+        }
+        m_DepthPrePassMat->SetFeature(ShaderFeature::ALPHA_TEST, alphaTest);
 
-    cof[0][0] = e * i - f * h; // A
-    cof[0][1] = c * h - b * i; // D
-    cof[0][2] = b * f - c * e; // G
-    cof[1][0] = f * g - d * i; // B
-    cof[1][1] = a * i - c * g; // E
-    cof[1][2] = c * d - a * f; // H
-    cof[2][0] = d * h - e * g; // C
-    cof[2][1] = b * g - a * h; // F
-    cof[2][2] = a * e - b * d; // I
+        // The instanced draws must also be instanced here, GL_EQUAL needs the same vertex shader inputs
+        if (batch.InstanceCount > 1)
+        {
+            m_DepthPrePassMat->Use(true);
+            if (alphaTest)
+            {
+                // The base colour and the cutoff are read from the parameter block of the material
+                mat->BindParameterBlock();
+            }
+            m_InstanceBuffer->BindToMesh(batch.Command->Mesh, batch.FirstInstance);
+            RenderMeshInstanced(batch.Command->Mesh, batch.InstanceCount);
+        }
+        else
+        {
+            m_DepthPrePassMat->Use();
+            if (alphaTest)
+            {
+                mat->BindParameterBlock();
+            }
+            m_DrawUniformBuffer->Bind(batch.Command->DrawIndex);
+            RenderMesh(batch.Command->Mesh, batch.IndexOffset, batch.IndexCount);
+        }
+    }
 
-    return cof;
+    m_GLStateCache->SetColorWriteMask(true);
 }
 
-void SceneRenderGraph::SetMatIBLAndShadow(Material::Ptr &mat, Light::Ptr light)
+void SceneRenderGraph::SetMatIBLAndShadow(Material *mat, Light::Ptr light)
 {
     if (!mat->IsUsedForSkybox())
     {
@@ -417,32 +884,20 @@ void SceneRenderGraph::SetMatIBLAndShadow(Material::Ptr &mat, Light::Ptr light)
 
     if (mat->GetMaterialCastShadows())
     {
+        mat->SetFeature(ShaderFeature::SHADOW_MAP, light->IsCastShadow());
         if (light->IsCastShadow())
         {
-            mat->AddOrSetFloat("uShadowMapSet", 1.0f);
             mat->AddOrSetTexture(light->GetShadowMapRT()->GetShadowMapTexture());
         }
-        else
-        {
-            mat->AddOrSetFloat("uShadowMapSet", -1.0f);
-            mat->AddOrSetTexture(light->GetEmptyShadowMapTexture());
-        }
     }
 }
 
-void SceneRenderGraph::RenderMesh(Mesh::Ptr mesh)
+void SceneRenderGraph::RenderMeshInstanced(Mesh *mesh, uint32_t instanceCount)
 {
-    glBindVertexArray(mesh->GetVertexArrayID());
-
-    if (mesh->GetIndicesCount() > 0)
-    {
-        glDrawElements(GL_TRIANGLES, mesh->GetIndicesCount(), GL_UNSIGNED_INT, nullptr);
-    }
-    else
-    {
-        glDrawArrays(GL_TRIANGLES, 0, mesh->GetVerticesCount());
-    }
+    mesh->DrawInstanced(instanceCount);
+}
 
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindVertexArray(0);
+void SceneRenderGraph::RenderMesh(Mesh *mesh, uint32_t indexOffset, uint32_t indexCount)
+{
+    mesh->Draw(indexOffset, indexCount);
 }
@@ -12,10 +12,18 @@
 
 #include "renderer/RenderCommand.h"
 #include "renderer/CommandBuffer.h"
+#include "renderer/InstanceBuffer.h"
+#include "renderer/DrawUniformBuffer.h"
+#include "renderer/GlobalUniforms.h"
+#include "renderer/UniformRingBuffer.h"
 #include "renderer/RenderTarget.h"
+#include "renderer/RenderTargetPool.h"
+#include "renderer/FrameGraph.h"
 
 #include "scene/SceneNode.h"
 
+#include "utility/BoundingVolumeHierarchy.h"
+
 #include "renderer/EnvironmentIBL.h"
 #include "renderer/DirectionalLightShadowMap.h"
 #include "renderer/PostProcessing.h"
@@ -46,21 +54,51 @@ public:
 
     void Render();
     
-    void RenderCommand(RenderCommand::Ptr command, Light::Ptr light);
-    void RenderMesh(Mesh::Ptr mesh);
+    void RenderCommand(const RenderCommand *command, Light::Ptr light);
+    // A batch of one command goes through RenderCommand(), the others are drawn instanced
+    void RenderBatch(const ::RenderBatch &batch, Light::Ptr light);
+    void ApplyMaterialState(Material *mat);
+    // A count of 0 draws all the indices
+    void RenderMesh(Mesh *mesh, uint32_t indexOffset = 0, uint32_t indexCount = 0);
+    void RenderMeshInstanced(Mesh *mesh, uint32_t instanceCount);
+    // Depth only draws of the opaque batches, alpha tested materials still discard
+    void RenderDepthPrePass(const std::vector<::RenderBatch> &batches);
     void CalculateSceneAABB();
 
+    // The passes and resources of the last frame
+    const FrameGraph::Ptr GetFrameGraph() const { return m_FrameGraph; }
+
 private:
 
     void PepareRenderCommands();
     void UpdateGlobalUniformsData(const Camera::Ptr camera, const Light::Ptr light);
 
+    // Declare the passes of the frame with the resources they use, see FrameGraph.h
+    void BuildFrameGraph();
+    void ExecuteShadowMapPass();
+    void ExecuteFrameUniformsPass();
+    void ExecuteGBufferPass();
+    void ExecuteSSAOPass(FrameGraph::Resource depthSource);
+    void ExecuteDeferredLightingPass();
+    void ExecuteDepthPrePass();
+    void ExecuteForwardOpaquePass(bool afterDepthPrePass);
+    void ExecuteSkyboxPass();
+    void ExecuteDebuggingPass();
+    void ExecuteTransparentPass();
+    void ExecuteBloomPass();
+    void ExecutePostProcessingPass();
+
     void BuildSkyboxRenderCommands();
     void BuildRenderCommands(SceneNode::Ptr sceneNode);
 
-    glm::mat3 FastCofactor(const glm::mat3 &matrix);
+    // Flatten the scene into a list of meshes and build the BVH over their world bounds, or refit it if any transform changed
+    void UpdateSceneMeshes();
+    void CollectSceneMeshes(SceneNode::Ptr sceneNode);
+    void BuildSceneRenderCommands();
 
-    void SetMatIBLAndShadow(Material::Ptr &mat, Light::Ptr light);
+    void SetMatIBLAndShadow(Material *mat, Light::Ptr light);
+    // Compile the shader variants the materials of the node will be drawn with, before the first frame needs them
+    void PrewarmShaderVariants(SceneNode::Ptr sceneNode);
 
     // OpenGL state cache
     GLStateCache::Ptr m_GLStateCache;
@@ -70,12 +108,52 @@ private:
     SceneNode::Ptr m_Scene;
 
     CommandBuffer::Ptr m_CommandBuffer;
+    // Per-instance matrices of the instanced opaque batches
+    InstanceBuffer::Ptr m_InstanceBuffer;
+    // Transforms of the scene meshes followed by the debugging commands, indexed by RenderCommand::DrawIndex
+    DrawUniformBuffer::Ptr m_DrawUniformBuffer;
     Camera::Ptr m_Camera;
+    FrustumPlanes m_CameraFrustumPlanes;
+
+    // Flattened scene meshes, the meshes with bounds come first and are the items of the BVH
+    struct SceneMesh
+    {
+        SceneNode::Ptr Node;
+        MeshRender::Ptr Render;
+    };
+    std::vector<SceneMesh> m_SceneMeshes;
+    size_t m_BoundedSceneMeshCount;
+    std::vector<BoundingBox> m_SceneMeshBounds;
+    BoundingVolumeHierarchy m_SceneBVH;
+    bool m_SceneMeshesDirty;
+    uint32_t m_SceneMeshesWorldVersion;
+    std::vector<uint32_t> m_VisibleSceneMeshes;
+    // Shadow caster command of each scene mesh, kept across frames and refreshed when the transforms change
+    std::vector<::RenderCommand> m_SceneShadowCasters;
+    // Meshes of the transparent commands of the frame, sorted by address to find the meshes drawn more than once
+    std::vector<Mesh*> m_TransparentMeshes;
     DirectionalLight::Ptr m_MainLight;
 
-    GLuint m_GlobalUniformBufferID;
-
-    RenderTarget::Ptr m_IntermediateRT;
+    // Filled every frame and uploaded as a whole, see GlobalUniforms.h for the std140 layout
+    GlobalUniforms m_GlobalUniforms;
+    UniformRingBuffer::Ptr m_GlobalUniformBuffer;
+
+    // Transient targets of the frame, acquired at the render size so a resize only reallocates them once in the next frame
+    RenderTargetPool::Ptr m_RenderTargetPool;
+
+    // Passes of the frame, rebuilt every frame from the settings
+    FrameGraph::Ptr m_FrameGraph;
+    struct FrameResources
+    {
+        FrameGraph::Resource ShadowMap;
+        FrameGraph::Resource FrameData;     // Global uniforms and instance data of the frame
+        FrameGraph::Resource Backbuffer;
+        FrameGraph::Resource GBuffer;
+        FrameGraph::Resource SSAO;
+        FrameGraph::Resource Intermediate;
+        FrameGraph::Resource Bloom;
+    };
+    FrameResources m_FrameResources;
 
     // Environment IBL
     EnvironmentIBL::Ptr m_EnvIBL;
@@ -86,30 +164,14 @@ private:
     // Post processing
     PostProcessing::Ptr m_PostProcessing;
 
-    // Deferred rendering gbuffer
-    RenderTarget::Ptr m_GBufferRT;
+    // Deferred rendering
     Material::Ptr m_DeferredLightingMat;
 
+    // Forward rendering depth pre-pass
+    Material::Ptr m_DepthPrePassMat;
+
     // SSAO
     ScreenSpaceAmbientOcclusion::Ptr m_ScreenSpaceAmbientOcclusion;
 
-    // m_GlobalUniformBufferID
-    // Should match GlobalUniforms in Uniforms.glsl
-    // struct GlobalUniforms
-    // {
-    //     mat4 ViewFromWorld;                    // 64 bytes;   byte offset = 0;
-    //     mat4 ClipFromView;                     // 64 bytes;   byte offset = 64;
-    //     vec3 MainLightPosition;                // 16 bytes;   byte offset = 128;
-    //     vec3 MainLightColor;                   // 16 bytes;   byte offset = 144;
-    //     vec3 CameraPosition;                   // 16 bytes;   byte offset = 160;
-    //     mat4 ShadowClipFromView[4];            // 256 bytes;  byte offset = 176;
-    //     mat4 ShadowViewFromWorld;              // 64 bytes;   byte offset = 432;
-    //     vec4 CascadeScalesAndOffsets[4];       // 64 bytes;   byte offset = 496;
-    //     vec4 CascadeParams;                    // 16 bytes;   byte offset = 560;
-    //     vec4 ShadowMapTexelSize;               // 16 bytes;   byte offset = 576;
-    //     mat4 ViewFromClip;                     // 64 bytes;   byte offset = 592;
-    //     vec4 ZBufferParams;                    // 16 bytes;   byte offset = 656;
-    // };                                         // Total bytes = 672
-
     Material::Ptr m_DebuggingAABBMat;
 };
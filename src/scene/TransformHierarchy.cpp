@@ -0,0 +1,390 @@
+#include "scene/TransformHierarchy.h"
+
+#include <assert.h>
+#include <cfloat>
+
+using namespace Collision;
+
+TransformHierarchy& TransformHierarchy::Get()
+{
+    // Intentionally never destroyed, scene nodes may still release their handles during static destruction
+    static TransformHierarchy* instance = new TransformHierarchy();
+    return *instance;
+}
+
+TransformHierarchy::Handle TransformHierarchy::Allocate()
+{
+    Handle handle;
+    if (!m_FreeHandles.empty())
+    {
+        handle = m_FreeHandles.back();
+        m_FreeHandles.pop_back();
+    }
+    else
+    {
+        handle = static_cast<Handle>(m_HandleToSlot.size());
+        m_HandleToSlot.push_back(INVALID_INDEX);
+    }
+
+    // New nodes are roots, appending them never breaks the parent-before-child order
+    uint32_t slot = static_cast<uint32_t>(m_SlotToHandle.size());
+    m_HandleToSlot[handle] = slot;
+    m_SlotToHandle.push_back(handle);
+    m_Parents.push_back(INVALID_INDEX);
+    m_LocalMatrices.push_back(glm::mat4(1.0f));
+    m_WorldMatrices.push_back(glm::mat4(1.0f));
+    m_NormalMatrices.push_back(glm::mat3(1.0f));
+    m_Dirty.push_back(1);
+    m_Changed.push_back(0);
+    m_LocalBounds.push_back(BoundingBox());
+    m_HasLocalBounds.push_back(0);
+    m_SubtreeBoundsMin.push_back(glm::vec3(FLT_MAX));
+    m_SubtreeBoundsMax.push_back(glm::vec3(-FLT_MAX));
+    m_BoundsDirty.push_back(1);
+
+    m_AnyDirty = true;
+    m_AnyBoundsDirty = true;
+
+    return handle;
+}
+
+void TransformHierarchy::Release(Handle handle)
+{
+    uint32_t slot = m_HandleToSlot[handle];
+    assert(slot != INVALID_INDEX);
+
+    // The slot is only marked as dead here, and it will be removed by the next sort
+    m_SlotToHandle[slot] = INVALID_INDEX;
+    m_HandleToSlot[handle] = INVALID_INDEX;
+    m_FreeHandles.push_back(handle);
+
+    m_NeedsSort = true;
+}
+
+void TransformHierarchy::SetParent(Handle child, Handle parent)
+{
+    uint32_t childSlot = m_HandleToSlot[child];
+    uint32_t parentSlot = parent == INVALID_INDEX ? INVALID_INDEX : m_HandleToSlot[parent];
+
+    m_Parents[childSlot] = parentSlot;
+    m_Dirty[childSlot] = 1;
+    m_AnyDirty = true;
+
+    // The previous parent has lost this subtree, so its bounds must be re-merged too
+    m_AllBoundsDirty = true;
+    m_AnyBoundsDirty = true;
+
+    if (parentSlot != INVALID_INDEX && parentSlot > childSlot)
+    {
+        m_NeedsSort = true;
+    }
+}
+
+void TransformHierarchy::SetLocalMatrix(Handle handle, const glm::mat4 &local)
+{
+    uint32_t slot = m_HandleToSlot[handle];
+    m_LocalMatrices[slot] = local;
+    m_Dirty[slot] = 1;
+    m_AnyDirty = true;
+}
+
+void TransformHierarchy::SetLocalBounds(Handle handle, const BoundingBox &bounds)
+{
+    uint32_t slot = m_HandleToSlot[handle];
+    m_LocalBounds[slot] = bounds;
+    m_HasLocalBounds[slot] = 1;
+    m_BoundsDirty[slot] = 1;
+    m_AnyBoundsDirty = true;
+}
+
+void TransformHierarchy::UpdateWorldMatrices()
+{
+    if (m_NeedsSort)
+    {
+        SortHierarchy();
+    }
+
+    if (!m_AnyDirty)
+    {
+        return;
+    }
+
+    const size_t count = m_SlotToHandle.size();
+    const uint32_t* parents = m_Parents.data();
+    const glm::mat4* locals = m_LocalMatrices.data();
+    glm::mat4* worlds = m_WorldMatrices.data();
+    glm::mat3* normals = m_NormalMatrices.data();
+    uint8_t* dirty = m_Dirty.data();
+    uint8_t* changed = m_Changed.data();
+    uint8_t* boundsDirty = m_BoundsDirty.data();
+
+    // Parents always come before their children, so the parent world matrix is final when a child is visited
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint32_t parent = parents[i];
+        const bool isChanged = dirty[i] || (parent != INVALID_INDEX && changed[parent]);
+        changed[i] = isChanged;
+        dirty[i] = 0;
+
+        if (isChanged)
+        {
+            worlds[i] = parent != INVALID_INDEX ? worlds[parent] * locals[i] : locals[i];
+            normals[i] = FastCofactor(glm::mat3(worlds[i]));
+            boundsDirty[i] = 1;
+            m_AnyBoundsDirty = true;
+        }
+    }
+
+    m_AnyDirty = false;
+    m_WorldVersion++;
+}
+
+void TransformHierarchy::UpdateBounds()
+{
+    if (m_NeedsSort || m_AnyDirty)
+    {
+        UpdateWorldMatrices();
+    }
+
+    if (!m_AnyBoundsDirty)
+    {
+        return;
+    }
+
+    if (m_AllBoundsDirty)
+    {
+        m_BoundsDirty.assign(m_BoundsDirty.size(), 1);
+        m_AllBoundsDirty = false;
+    }
+
+    const size_t count = m_SlotToHandle.size();
+    const uint32_t* parents = m_Parents.data();
+    uint8_t* boundsDirty = m_BoundsDirty.data();
+    glm::vec3* subtreeMin = m_SubtreeBoundsMin.data();
+    glm::vec3* subtreeMax = m_SubtreeBoundsMax.data();
+
+    // Propagate the dirty flags up to the root, children are always visited before their parent in reverse order
+    for (size_t i = count; i-- > 0;)
+    {
+        if (boundsDirty[i] && parents[i] != INVALID_INDEX)
+        {
+            boundsDirty[parents[i]] = 1;
+        }
+    }
+
+    // Reset the dirty subtrees to the bounds of the node itself
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!boundsDirty[i])
+        {
+            continue;
+        }
+
+        if (m_HasLocalBounds[i])
+        {
+            BoundingBox worldBounds;
+            BoundingBox::CreateFromBoundingBoxAndTransform(worldBounds, m_LocalBounds[i], m_WorldMatrices[i]);
+            subtreeMin[i] = worldBounds.Center - worldBounds.Extents;
+            subtreeMax[i] = worldBounds.Center + worldBounds.Extents;
+        }
+        else
+        {
+            subtreeMin[i] = glm::vec3(FLT_MAX);
+            subtreeMax[i] = glm::vec3(-FLT_MAX);
+        }
+    }
+
+    // Merge the subtrees into the dirty parents, the clean subtrees contribute their cached bounds
+    for (size_t i = count; i-- > 0;)
+    {
+        const uint32_t parent = parents[i];
+        if (parent != INVALID_INDEX && boundsDirty[parent])
+        {
+            subtreeMin[parent] = glm::min(subtreeMin[parent], subtreeMin[i]);
+            subtreeMax[parent] = glm::max(subtreeMax[parent], subtreeMax[i]);
+        }
+        boundsDirty[i] = 0;
+    }
+
+    m_AnyBoundsDirty = false;
+}
+
+bool TransformHierarchy::GetSubtreeBounds(Handle handle, BoundingBox &outBounds) const
+{
+    uint32_t slot = m_HandleToSlot[handle];
+    const glm::vec3 &bMin = m_SubtreeBoundsMin[slot];
+    const glm::vec3 &bMax = m_SubtreeBoundsMax[slot];
+    if (bMin.x > bMax.x)
+    {
+        return false;
+    }
+
+    BoundingBox::CreateFromPoints(outBounds, bMin, bMax);
+    return true;
+}
+
+void TransformHierarchy::SortHierarchy()
+{
+    const size_t count = m_SlotToHandle.size();
+
+    // Children of the released nodes become roots
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (m_Parents[i] != INVALID_INDEX && m_SlotToHandle[m_Parents[i]] == INVALID_INDEX)
+        {
+            m_Parents[i] = INVALID_INDEX;
+            m_Dirty[i] = 1;
+            m_AnyDirty = true;
+        }
+    }
+
+    // Depth of each live slot, parents may currently be stored after their children
+    std::vector<uint32_t> depths(count, INVALID_INDEX);
+    uint32_t maxDepth = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (m_SlotToHandle[i] == INVALID_INDEX || depths[i] != INVALID_INDEX)
+        {
+            continue;
+        }
+
+        // Walk up until a slot with a known depth
+        uint32_t depth = 0;
+        uint32_t current = static_cast<uint32_t>(i);
+        while (m_Parents[current] != INVALID_INDEX && depths[m_Parents[current]] == INVALID_INDEX)
+        {
+            current = m_Parents[current];
+            ++depth;
+        }
+        uint32_t baseDepth = m_Parents[current] != INVALID_INDEX ? depths[m_Parents[current]] + 1 : 0;
+
+        // Assign the depths down the visited chain
+        current = static_cast<uint32_t>(i);
+        uint32_t currentDepth = baseDepth + depth;
+        while (depths[current] == INVALID_INDEX)
+        {
+            depths[current] = currentDepth;
+            maxDepth = glm::max(maxDepth, currentDepth);
+            if (m_Parents[current] == INVALID_INDEX)
+            {
+                break;
+            }
+            current = m_Parents[current];
+            --currentDepth;
+        }
+    }
+
+    // Stable counting sort by depth
+    std::vector<uint32_t> offsets(maxDepth + 2, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (depths[i] != INVALID_INDEX)
+        {
+            ++offsets[depths[i] + 1];
+        }
+    }
+    for (size_t d = 1; d < offsets.size(); ++d)
+    {
+        offsets[d] += offsets[d - 1];
+    }
+    const size_t liveCount = offsets.back();
+
+    std::vector<uint32_t> newSlots(count, INVALID_INDEX);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (depths[i] != INVALID_INDEX)
+        {
+            newSlots[i] = offsets[depths[i]]++;
+        }
+    }
+
+    std::vector<Handle> slotToHandle(liveCount);
+    std::vector<uint32_t> parents(liveCount);
+    std::vector<glm::mat4> localMatrices(liveCount);
+    std::vector<glm::mat4> worldMatrices(liveCount);
+    std::vector<glm::mat3> normalMatrices(liveCount);
+    std::vector<uint8_t> dirty(liveCount);
+    std::vector<BoundingBox> localBounds(liveCount);
+    std::vector<uint8_t> hasLocalBounds(liveCount);
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t slot = newSlots[i];
+        if (slot == INVALID_INDEX)
+        {
+            continue;
+        }
+
+        slotToHandle[slot] = m_SlotToHandle[i];
+        parents[slot] = m_Parents[i] != INVALID_INDEX ? newSlots[m_Parents[i]] : INVALID_INDEX;
+        localMatrices[slot] = m_LocalMatrices[i];
+        worldMatrices[slot] = m_WorldMatrices[i];
+        normalMatrices[slot] = m_NormalMatrices[i];
+        dirty[slot] = m_Dirty[i];
+        localBounds[slot] = m_LocalBounds[i];
+        hasLocalBounds[slot] = m_HasLocalBounds[i];
+        m_HandleToSlot[m_SlotToHandle[i]] = slot;
+    }
+
+    m_SlotToHandle.swap(slotToHandle);
+    m_Parents.swap(parents);
+    m_LocalMatrices.swap(localMatrices);
+    m_WorldMatrices.swap(worldMatrices);
+    m_NormalMatrices.swap(normalMatrices);
+    m_Dirty.swap(dirty);
+    m_Changed.assign(liveCount, 0);
+    m_LocalBounds.swap(localBounds);
+    m_HasLocalBounds.swap(hasLocalBounds);
+
+    // The subtrees have changed, all the bounds are re-merged in the next update
+    m_SubtreeBoundsMin.assign(liveCount, glm::vec3(FLT_MAX));
+    m_SubtreeBoundsMax.assign(liveCount, glm::vec3(-FLT_MAX));
+    m_BoundsDirty.assign(liveCount, 0);
+    m_AllBoundsDirty = true;
+    m_AnyBoundsDirty = true;
+
+    m_NeedsSort = false;
+}
+
+glm::mat3 TransformHierarchy::FastCofactor(const glm::mat3 &m)
+{
+    // Assuming the input matrix is:
+    // | a b c |
+    // | d e f |
+    // | g h i |
+    //
+    // The cofactor are
+    // | A B C |
+    // | D E F |
+    // | G H I |
+
+    // Where:
+    // A = (ei - fh), B = (fg - di), C = (dh - eg)
+    // D = (ch - bi), E = (ai - cg), F = (bg - ah)
+    // G = (bf - ce), H = (cd - af), I = (ae - bd)
+
+    // Importantly, matrices are column-major!
+
+    glm::mat3 cof;
+
+    const float a = m[0][0];
+    const float b = m[1][0];
+    const float c = m[2][0];
+    const float d = m[0][1];
+    const float e = m[1][1];
+    const float f = m[2][1];
+    const float g = m[0][2];
+    const float h = m[1][2];
+    const float i = m[2][2];
+
+    cof[0][0] = e * i - f * h; // A
+    cof[0][1] = c * h - b * i; // D
+    cof[0][2] = b * f - c * e; // G
+    cof[1][0] = f * g - d * i; // B
+    cof[1][1] = a * i - c * g; // E
+    cof[1][2] = c * d - a * f; // H
+    cof[2][0] = d * h - e * g; // C
+    cof[2][1] = b * g - a * h; // F
+    cof[2][2] = a * e - b * d; // I
+
+    return cof;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "utility/Collision.h"
+
+// Flattened, data-oriented storage of the scene node transforms.
+// All the matrices live in contiguous arrays indexed by slot, and the slots are kept sorted so that a parent always comes
+// before its children, so the world and normal matrices can be propagated in a single linear sweep.
+// Scene nodes only keep a handle, since the slot of a node changes whenever the hierarchy is re-sorted.
+// The world space bounds of each subtree are cached as well, and only the paths from the changed nodes to the root are re-merged.
+class TransformHierarchy
+{
+public:
+    using Handle = uint32_t;
+    static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+    // Process-wide store shared by all the scene nodes
+    static TransformHierarchy& Get();
+
+    Handle Allocate();
+    void Release(Handle handle);
+
+    void SetParent(Handle child, Handle parent);
+    void SetLocalMatrix(Handle handle, const glm::mat4 &local);
+    void SetLocalBounds(Handle handle, const Collision::BoundingBox &bounds);
+
+    const glm::mat4& GetWorldMatrix(Handle handle) const { return m_WorldMatrices[m_HandleToSlot[handle]]; }
+    const glm::mat3& GetNormalMatrix(Handle handle) const { return m_NormalMatrices[m_HandleToSlot[handle]]; }
+
+    // Linear sweep over all the slots, world and normal matrices are only recomputed for the dirty nodes and their descendants
+    void UpdateWorldMatrices();
+
+    // Re-merge the cached subtree bounds of the nodes whose transform or bounds changed, must be called after UpdateWorldMatrices()
+    void UpdateBounds();
+
+    // World space bounds of the whole subtree below the node, returns false if no node in the subtree has bounds
+    bool GetSubtreeBounds(Handle handle, Collision::BoundingBox &outBounds) const;
+
+    size_t GetNodeCount() const { return m_SlotToHandle.size(); }
+
+    // Incremented whenever any world matrix changed, used to know if cached world space data must be refreshed
+    uint32_t GetWorldVersion() const { return m_WorldVersion; }
+
+    // Cofactor matrix, equal to the inverse transpose scaled by the determinant, used to transform the normals
+    static glm::mat3 FastCofactor(const glm::mat3 &matrix);
+
+private:
+    TransformHierarchy() = default;
+
+    // Re-order the slots by depth and drop the released slots
+    void SortHierarchy();
+
+    // Handle -> slot indirection
+    std::vector<uint32_t> m_HandleToSlot;
+    std::vector<Handle> m_FreeHandles;
+
+    // Per-slot data
+    std::vector<Handle> m_SlotToHandle;
+    std::vector<uint32_t> m_Parents;                // Slot of the parent, INVALID_INDEX for roots
+    std::vector<glm::mat4> m_LocalMatrices;
+    std::vector<glm::mat4> m_WorldMatrices;
+    std::vector<glm::mat3> m_NormalMatrices;
+    std::vector<uint8_t> m_Dirty;                   // Local matrix changed since the last update
+    std::vector<uint8_t> m_Changed;                 // World matrix changed in the last update
+
+    std::vector<Collision::BoundingBox> m_LocalBounds;
+    std::vector<uint8_t> m_HasLocalBounds;
+    std::vector<glm::vec3> m_SubtreeBoundsMin;      // Min > max if the subtree is empty
+    std::vector<glm::vec3> m_SubtreeBoundsMax;
+    std::vector<uint8_t> m_BoundsDirty;
+
+    bool m_NeedsSort = false;
+    bool m_AnyDirty = false;
+    bool m_AnyBoundsDirty = false;
+    bool m_AllBoundsDirty = false;
+    uint32_t m_WorldVersion = 0;
+};
@@ -0,0 +1,83 @@
+#include "utility/AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<size_t> g_AllocationCount(0);
+
+    void* CountedAllocate(size_t size)
+    {
+        g_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+        void* ptr = std::malloc(size > 0 ? size : 1);
+        return ptr;
+    }
+}
+
+size_t AllocationCounter::GetAllocationCount()
+{
+    return g_AllocationCount.load(std::memory_order_relaxed);
+}
+
+// Replacements of the global allocation functions, the aligned overloads are left to the standard library
+void* operator new(size_t size)
+{
+    void* ptr = CountedAllocate(size);
+    if (!ptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    void* ptr = CountedAllocate(size);
+    if (!ptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
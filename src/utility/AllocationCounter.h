@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+// Counts the calls to the global operator new, used to check that the per-frame code paths do not allocate.
+// The count is process-wide, so it should be sampled around a section of code on the render thread.
+class AllocationCounter
+{
+public:
+    static size_t GetAllocationCount();
+};
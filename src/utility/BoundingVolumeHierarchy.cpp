@@ -0,0 +1,422 @@
+#include "utility/BoundingVolumeHierarchy.h"
+
+#include <cfloat>
+
+namespace
+{
+    // Surface area heuristic helpers
+    float HalfArea(const glm::vec3 &min, const glm::vec3 &max)
+    {
+        glm::vec3 e = max - min;
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+
+    struct Bin
+    {
+        glm::vec3 Min = glm::vec3(FLT_MAX);
+        glm::vec3 Max = glm::vec3(-FLT_MAX);
+        uint32_t Count = 0;
+    };
+}
+
+namespace Collision
+{
+    void BoundingVolumeHierarchy::Clear()
+    {
+        m_Nodes.clear();
+        m_ItemIndices.clear();
+        m_ItemBounds.clear();
+        m_LeafItemBounds.Resize(0);
+    }
+
+    void BoundingVolumeHierarchy::UpdateLeafItemBounds()
+    {
+        m_LeafItemBounds.Resize(m_ItemIndices.size());
+        for (size_t i = 0; i < m_ItemIndices.size(); ++i)
+        {
+            m_LeafItemBounds.Set(i, m_ItemBounds[m_ItemIndices[i]]);
+        }
+    }
+
+    void BoundingVolumeHierarchy::Build(const std::vector<BoundingBox> &itemBounds)
+    {
+        Clear();
+        if (itemBounds.empty())
+        {
+            return;
+        }
+
+        const uint32_t itemCount = static_cast<uint32_t>(itemBounds.size());
+        m_ItemBounds = itemBounds;
+        m_ItemIndices.resize(itemCount);
+        std::vector<vec3> centroids(itemCount);
+        for (uint32_t i = 0; i < itemCount; ++i)
+        {
+            m_ItemIndices[i] = i;
+            centroids[i] = itemBounds[i].Center;
+        }
+
+        // A binary tree with leaves of at least one item has at most 2n - 1 nodes
+        m_Nodes.reserve(itemCount * 2);
+
+        Node root;
+        root.LeftOrFirst = 0;
+        root.Count = itemCount;
+        UpdateNodeBounds(root);
+        m_Nodes.push_back(root);
+
+        // Subdivide depth-first with an explicit stack, children are always stored after their parent
+        std::vector<uint32_t> stack;
+        stack.push_back(0);
+        while (!stack.empty())
+        {
+            uint32_t nodeIndex = stack.back();
+            stack.pop_back();
+
+            if (Subdivide(nodeIndex, centroids))
+            {
+                stack.push_back(m_Nodes[nodeIndex].LeftOrFirst);
+                stack.push_back(m_Nodes[nodeIndex].LeftOrFirst + 1);
+            }
+        }
+
+        UpdateLeafItemBounds();
+    }
+
+    bool BoundingVolumeHierarchy::Subdivide(uint32_t nodeIndex, const std::vector<vec3> &centroids)
+    {
+        Node &node = m_Nodes[nodeIndex];
+        if (node.Count <= MAX_LEAF_SIZE)
+        {
+            return false;
+        }
+
+        const uint32_t first = node.LeftOrFirst;
+        const uint32_t count = node.Count;
+
+        // Bin the items by centroid, the bins span the bounds of the centroids and not of the boxes
+        vec3 centroidMin = vec3(FLT_MAX);
+        vec3 centroidMax = vec3(-FLT_MAX);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const vec3 &c = centroids[m_ItemIndices[first + i]];
+            centroidMin = glm::min(centroidMin, c);
+            centroidMax = glm::max(centroidMax, c);
+        }
+
+        float bestCost = FLT_MAX;
+        int bestAxis = -1;
+        uint32_t bestSplit = 0;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const float extent = centroidMax[axis] - centroidMin[axis];
+            if (extent <= 0.0f)
+            {
+                continue;
+            }
+
+            Bin bins[BIN_COUNT];
+            const float scale = BIN_COUNT / extent;
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const uint32_t item = m_ItemIndices[first + i];
+                uint32_t binIndex = glm::min(BIN_COUNT - 1, static_cast<uint32_t>((centroids[item][axis] - centroidMin[axis]) * scale));
+                Bin &bin = bins[binIndex];
+                bin.Count++;
+                bin.Min = glm::min(bin.Min, m_ItemBounds[item].Center - m_ItemBounds[item].Extents);
+                bin.Max = glm::max(bin.Max, m_ItemBounds[item].Center + m_ItemBounds[item].Extents);
+            }
+
+            // Sweep from both sides to get the cost of each of the BIN_COUNT - 1 split planes
+            float leftArea[BIN_COUNT - 1];
+            uint32_t leftCount[BIN_COUNT - 1];
+            vec3 sweepMin = vec3(FLT_MAX);
+            vec3 sweepMax = vec3(-FLT_MAX);
+            uint32_t sweepCount = 0;
+            for (uint32_t i = 0; i < BIN_COUNT - 1; ++i)
+            {
+                sweepCount += bins[i].Count;
+                sweepMin = glm::min(sweepMin, bins[i].Min);
+                sweepMax = glm::max(sweepMax, bins[i].Max);
+                leftCount[i] = sweepCount;
+                leftArea[i] = sweepCount > 0 ? HalfArea(sweepMin, sweepMax) : 0.0f;
+            }
+
+            sweepMin = vec3(FLT_MAX);
+            sweepMax = vec3(-FLT_MAX);
+            sweepCount = 0;
+            for (uint32_t i = BIN_COUNT - 1; i > 0; --i)
+            {
+                sweepCount += bins[i].Count;
+                sweepMin = glm::min(sweepMin, bins[i].Min);
+                sweepMax = glm::max(sweepMax, bins[i].Max);
+                const float rightArea = sweepCount > 0 ? HalfArea(sweepMin, sweepMax) : 0.0f;
+
+                const float cost = leftCount[i - 1] * leftArea[i - 1] + sweepCount * rightArea;
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = i;
+                }
+            }
+        }
+
+        // All the centroids are at the same position, or splitting costs more than testing all the items of a leaf
+        const float leafCost = count * HalfArea(node.Min, node.Max);
+        if (bestAxis < 0 || bestCost >= leafCost)
+        {
+            return false;
+        }
+
+        // Partition the items in place
+        const float scale = BIN_COUNT / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+        uint32_t i = first;
+        uint32_t j = first + count - 1;
+        while (i <= j)
+        {
+            const uint32_t item = m_ItemIndices[i];
+            uint32_t binIndex = glm::min(BIN_COUNT - 1, static_cast<uint32_t>((centroids[item][bestAxis] - centroidMin[bestAxis]) * scale));
+            if (binIndex < bestSplit)
+            {
+                ++i;
+            }
+            else
+            {
+                std::swap(m_ItemIndices[i], m_ItemIndices[j]);
+                if (j == 0)
+                {
+                    break;
+                }
+                --j;
+            }
+        }
+
+        const uint32_t leftCountSplit = i - first;
+        if (leftCountSplit == 0 || leftCountSplit == count)
+        {
+            return false;
+        }
+
+        // The node reference is invalidated by push_back, so it is not used below
+        const uint32_t leftIndex = static_cast<uint32_t>(m_Nodes.size());
+
+        Node left;
+        left.LeftOrFirst = first;
+        left.Count = leftCountSplit;
+        UpdateNodeBounds(left);
+
+        Node right;
+        right.LeftOrFirst = i;
+        right.Count = count - leftCountSplit;
+        UpdateNodeBounds(right);
+
+        m_Nodes.push_back(left);
+        m_Nodes.push_back(right);
+
+        m_Nodes[nodeIndex].LeftOrFirst = leftIndex;
+        m_Nodes[nodeIndex].Count = 0;
+        return true;
+    }
+
+    void BoundingVolumeHierarchy::UpdateNodeBounds(Node &node) const
+    {
+        node.Min = vec3(FLT_MAX);
+        node.Max = vec3(-FLT_MAX);
+        for (uint32_t i = 0; i < node.Count; ++i)
+        {
+            const BoundingBox &box = m_ItemBounds[m_ItemIndices[node.LeftOrFirst + i]];
+            node.Min = glm::min(node.Min, box.Center - box.Extents);
+            node.Max = glm::max(node.Max, box.Center + box.Extents);
+        }
+    }
+
+    void BoundingVolumeHierarchy::Refit(const std::vector<BoundingBox> &itemBounds)
+    {
+        if (itemBounds.size() != m_ItemBounds.size())
+        {
+            Build(itemBounds);
+            return;
+        }
+
+        m_ItemBounds = itemBounds;
+
+        // Children are always stored after their parent, so a reverse sweep visits them first
+        for (size_t i = m_Nodes.size(); i-- > 0;)
+        {
+            Node &node = m_Nodes[i];
+            if (node.Count > 0)
+            {
+                UpdateNodeBounds(node);
+            }
+            else
+            {
+                const Node &left = m_Nodes[node.LeftOrFirst];
+                const Node &right = m_Nodes[node.LeftOrFirst + 1];
+                node.Min = glm::min(left.Min, right.Min);
+                node.Max = glm::max(left.Max, right.Max);
+            }
+        }
+
+        UpdateLeafItemBounds();
+    }
+
+    void BoundingVolumeHierarchy::CollectItems(uint32_t nodeIndex, std::vector<uint32_t> &outItems) const
+    {
+        // The items of a subtree are contiguous, so only the first and the last leaf have to be found
+        uint32_t firstLeaf = nodeIndex;
+        while (m_Nodes[firstLeaf].Count == 0)
+        {
+            firstLeaf = m_Nodes[firstLeaf].LeftOrFirst;
+        }
+        uint32_t lastLeaf = nodeIndex;
+        while (m_Nodes[lastLeaf].Count == 0)
+        {
+            lastLeaf = m_Nodes[lastLeaf].LeftOrFirst + 1;
+        }
+
+        const uint32_t begin = m_Nodes[firstLeaf].LeftOrFirst;
+        const uint32_t end = m_Nodes[lastLeaf].LeftOrFirst + m_Nodes[lastLeaf].Count;
+        outItems.insert(outItems.end(), m_ItemIndices.begin() + begin, m_ItemIndices.begin() + end);
+    }
+
+    void BoundingVolumeHierarchy::Query(const FrustumPlanes &planes, std::vector<uint32_t> &outItems) const
+    {
+        if (m_Nodes.empty())
+        {
+            return;
+        }
+
+        // Each entry carries the mask of the planes its parent was not completely inside of
+        const uint32_t allPlanes = (1u << FrustumPlanes::PLANE_COUNT) - 1;
+        uint32_t stack[64][2];
+        int stackSize = 0;
+        stack[stackSize][0] = 0;
+        stack[stackSize][1] = allPlanes;
+        ++stackSize;
+
+        while (stackSize > 0)
+        {
+            --stackSize;
+            const uint32_t nodeIndex = stack[stackSize][0];
+            uint32_t planeMask = stack[stackSize][1];
+            const Node &node = m_Nodes[nodeIndex];
+
+            const vec3 center = (node.Min + node.Max) * 0.5f;
+            const vec3 extents = (node.Max - node.Min) * 0.5f;
+            bool outside = false;
+            for (uint32_t p = 0; p < FrustumPlanes::PLANE_COUNT; ++p)
+            {
+                if (!(planeMask & (1u << p)))
+                {
+                    continue;
+                }
+
+                const vec4 &plane = planes.Planes[p];
+                const float radius = glm::dot(extents, glm::abs(vec3(plane)));
+                const float distance = glm::dot(vec3(plane), center) + plane.w;
+                if (distance + radius < 0.0f)
+                {
+                    outside = true;
+                    break;
+                }
+                if (distance - radius >= 0.0f)
+                {
+                    planeMask &= ~(1u << p);
+                }
+            }
+
+            if (outside)
+            {
+                continue;
+            }
+
+            // Completely inside, the whole subtree is accepted without any further test
+            if (planeMask == 0)
+            {
+                CollectItems(nodeIndex, outItems);
+                continue;
+            }
+
+            if (node.Count > 0)
+            {
+                // Leaves may hold more than MAX_LEAF_SIZE items when no split helps, e.g. with coincident centroids,
+                // so they are tested MAX_LEAF_SIZE items at a time
+                uint8_t results[MAX_LEAF_SIZE];
+                for (uint32_t first = 0; first < node.Count; first += MAX_LEAF_SIZE)
+                {
+                    const uint32_t count = glm::min(MAX_LEAF_SIZE, node.Count - first);
+                    IntersectBatch(planes, m_LeafItemBounds, node.LeftOrFirst + first, count, results);
+                    for (uint32_t i = 0; i < count; ++i)
+                    {
+                        if (results[i])
+                        {
+                            outItems.push_back(m_ItemIndices[node.LeftOrFirst + first + i]);
+                        }
+                    }
+                }
+            }
+            else if (stackSize + 2 <= 64)
+            {
+                stack[stackSize][0] = node.LeftOrFirst;
+                stack[stackSize][1] = planeMask;
+                ++stackSize;
+                stack[stackSize][0] = node.LeftOrFirst + 1;
+                stack[stackSize][1] = planeMask;
+                ++stackSize;
+            }
+            else
+            {
+                // Too deep for the stack, accept the subtree conservatively
+                CollectItems(nodeIndex, outItems);
+            }
+        }
+    }
+
+    void BoundingVolumeHierarchy::Query(const BoundingBox &box, std::vector<uint32_t> &outItems) const
+    {
+        if (m_Nodes.empty())
+        {
+            return;
+        }
+
+        const vec3 boxMin = box.Center - box.Extents;
+        const vec3 boxMax = box.Center + box.Extents;
+
+        uint32_t stack[64];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0)
+        {
+            const uint32_t nodeIndex = stack[--stackSize];
+            const Node &node = m_Nodes[nodeIndex];
+            if (glm::any(glm::lessThan(node.Max, boxMin)) || glm::any(glm::greaterThan(node.Min, boxMax)))
+            {
+                continue;
+            }
+
+            if (node.Count > 0)
+            {
+                for (uint32_t i = 0; i < node.Count; ++i)
+                {
+                    const uint32_t item = m_ItemIndices[node.LeftOrFirst + i];
+                    const BoundingBox &itemBox = m_ItemBounds[item];
+                    if (glm::all(glm::lessThanEqual(glm::abs(itemBox.Center - box.Center), itemBox.Extents + box.Extents)))
+                    {
+                        outItems.push_back(item);
+                    }
+                }
+            }
+            else if (stackSize + 2 <= 64)
+            {
+                stack[stackSize++] = node.LeftOrFirst;
+                stack[stackSize++] = node.LeftOrFirst + 1;
+            }
+            else
+            {
+                CollectItems(nodeIndex, outItems);
+            }
+        }
+    }
+} // namespace Collision
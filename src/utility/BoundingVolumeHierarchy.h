@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "utility/Collision.h"
+
+namespace Collision
+{
+    // Bounding volume hierarchy over a flat list of axis-aligned boxes.
+    // The tree is built once with binned SAH, and only refitted when the boxes move, so it stays valid but may become less tight.
+    // Queries return the indices of the boxes in the list passed to Build().
+    class BoundingVolumeHierarchy
+    {
+    public:
+        static constexpr uint32_t MAX_LEAF_SIZE = 4;
+        static constexpr uint32_t BIN_COUNT = 16;
+
+        BoundingVolumeHierarchy() = default;
+
+        void Build(const std::vector<BoundingBox> &itemBounds);
+
+        // Update the node bounds bottom-up from the new item bounds, the item count must match the last Build()
+        void Refit(const std::vector<BoundingBox> &itemBounds);
+
+        // Items whose box intersects the convex volume of the planes
+        void Query(const FrustumPlanes &planes, std::vector<uint32_t> &outItems) const;
+        // Items whose box intersects the box
+        void Query(const BoundingBox &box, std::vector<uint32_t> &outItems) const;
+
+        void Clear();
+
+        size_t GetItemCount() const { return m_ItemIndices.size(); }
+        size_t GetNodeCount() const { return m_Nodes.size(); }
+
+    private:
+        struct Node
+        {
+            vec3 Min;
+            uint32_t LeftOrFirst;       // Index of the left child (the right one follows it) or the first item of a leaf
+            vec3 Max;
+            uint32_t Count;             // Item count of a leaf, 0 for inner nodes
+        };
+
+        // Split a leaf at the best binned SAH plane, returns false if the node stays a leaf
+        bool Subdivide(uint32_t nodeIndex, const std::vector<vec3> &centroids);
+        void UpdateNodeBounds(Node &node) const;
+        void CollectItems(uint32_t nodeIndex, std::vector<uint32_t> &outItems) const;
+
+        std::vector<Node> m_Nodes;
+        std::vector<uint32_t> m_ItemIndices;        // Item indices ordered by leaf
+        std::vector<BoundingBox> m_ItemBounds;      // Bounds of the items in the order of Build()
+        BoundingBoxBatch m_LeafItemBounds;          // Bounds of the items in leaf order, a leaf is tested in one SIMD batch
+
+        void UpdateLeafItemBounds();
+    };
+} // namespace Collision
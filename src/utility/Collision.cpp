@@ -2,6 +2,16 @@
 
 #include <glm/gtc/type_ptr.hpp>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#define COLLISION_SIMD_WIDTH 8
+#elif defined(__SSE__) || defined(_M_X64) || defined(_M_IX86_FP)
+#include <xmmintrin.h>
+#define COLLISION_SIMD_WIDTH 4
+#else
+#define COLLISION_SIMD_WIDTH 1
+#endif
+
 const glm::vec3 g_BoxCornerOffset[8] =
 {
     glm::vec3(-1.0f, -1.0f, 1.0f),
@@ -20,28 +30,21 @@ namespace Collision
     //----------------------------------------------------------------
     // Axis-aligned bounding box
     //----------------------------------------------------------------
-    std::vector<vec3> BoundingBox::GetCorners()
+    void BoundingBox::GetCorners(vec3 *outCorners) const
     {
-        std::vector<vec3> corners;
-        corners.resize(CORNER_COUNT);
         for (size_t i = 0; i < CORNER_COUNT; ++i)
         {
-            glm::vec3 c = Center + g_BoxCornerOffset[i] * Extents;
-            corners[i] = c;
+            outCorners[i] = Center + g_BoxCornerOffset[i] * Extents;
         }
-        return corners;
     }
 
     void BoundingBox::MergeBoundingBox(const BoundingBox &b, const glm::mat4 &transform)
     {
-        vec3 bCenter = b.Center;
-        vec3 bExtents = b.Extents;
-        
-        vec3 bMin = bCenter - bExtents;
-        vec3 bMax = bCenter + bExtents;
+        BoundingBox transformed;
+        CreateFromBoundingBoxAndTransform(transformed, b, transform);
         
-        bMin = glm::make_vec3(transform * vec4(bMin, 1.0f));
-        bMax = glm::make_vec3(transform * vec4(bMax, 1.0f));
+        vec3 bMin = transformed.Center - transformed.Extents;
+        vec3 bMax = transformed.Center + transformed.Extents;
         
         bMin = glm::min(Center - Extents, bMin);
         bMax = glm::max(Center + Extents, bMax);
@@ -79,20 +82,17 @@ namespace Collision
 
     void BoundingBox::CreateFromBoundingBoxAndTransform(BoundingBox &outBox, const BoundingBox &b, const glm::mat4 &transform)
     {
-        vec3 bCenter = b.Center;
-        vec3 bExtents = b.Extents;
-        vec3 bMin = bCenter - bExtents;
-        vec3 bMax = bCenter + bExtents;
-        bMin = glm::make_vec3(transform * vec4(bMin, 1.0f));
-        bMax = glm::make_vec3(transform * vec4(bMax, 1.0f));
-        
-        BoundingBox::CreateFromPoints(outBox, bMin, bMax);
+        // Transforming only min and max is wrong under rotation, the extents are projected onto each world axis instead (Arvo)
+        glm::mat3 absRotation = glm::mat3(glm::abs(vec3(transform[0])), glm::abs(vec3(transform[1])), glm::abs(vec3(transform[2])));
+
+        outBox.Center = vec3(transform * vec4(b.Center, 1.0f));
+        outBox.Extents = absRotation * b.Extents;
     }
 
     //----------------------------------------------------------------
     // Bounding frustum
     //----------------------------------------------------------------
-    std::vector<vec3> BoundingFrustum::GetCorners()
+    void BoundingFrustum::GetCorners(vec3 *outCorners) const
     {
         // Load origin
         vec3 vOrigin = Origin;
@@ -106,8 +106,7 @@ namespace Collision
         vec3 vNear = vec3(Near);
         vec3 vFar = vec3(Far);
         
-        std::vector<vec3> vCorners;
-        vCorners.resize(CORNER_COUNT);
+        vec3 *vCorners = outCorners;
 
         // Returns 8 corners position of bounding frustum.
         //     Near    Far
@@ -126,9 +125,7 @@ namespace Collision
         vCorners[7] = vLeftBottom * vFar;
         
         for (size_t i = 0; i < CORNER_COUNT; ++i)
-            vCorners[i] += Origin;
-        
-        return vCorners;
+            vCorners[i] += vOrigin;
     }
 
     BoundingFrustum::BoundingFrustum(const glm::mat4 &projection)
@@ -180,4 +177,284 @@ namespace Collision
         outFrustum.Near = points[4].z;
         outFrustum.Far = points[5].z;
     }
+
+    //----------------------------------------------------------------
+    // Frustum planes
+    //----------------------------------------------------------------
+    FrustumPlanes::FrustumPlanes(const glm::mat4 &viewProjection)
+    {
+        CreateFromMatrix(*this, viewProjection);
+    }
+
+    bool FrustumPlanes::Intersects(const BoundingBox &box) const
+    {
+        for (size_t i = 0; i < PLANE_COUNT; ++i)
+        {
+            const vec4 &plane = Planes[i];
+            vec3 normal = vec3(plane);
+
+            // Projected radius of the box onto the plane normal
+            float radius = glm::dot(box.Extents, glm::abs(normal));
+            float distance = glm::dot(normal, box.Center) + plane.w;
+            if (distance + radius < 0.0f)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool FrustumPlanes::Intersects(const BoundingSphere &sphere) const
+    {
+        for (size_t i = 0; i < PLANE_COUNT; ++i)
+        {
+            const vec4 &plane = Planes[i];
+            if (glm::dot(vec3(plane), sphere.Center) + plane.w + sphere.Radius < 0.0f)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void FrustumPlanes::CreateFromMatrix(FrustumPlanes &outPlanes, const glm::mat4 &viewProjection)
+    {
+        // Rows of the matrix, glm matrices are column major
+        vec4 row0 = vec4(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+        vec4 row1 = vec4(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+        vec4 row2 = vec4(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+        vec4 row3 = vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+        // OpenGL clip space: -w <= x, y, z <= w
+        outPlanes.Planes[0] = row3 + row0;     // Left
+        outPlanes.Planes[1] = row3 - row0;     // Right
+        outPlanes.Planes[2] = row3 + row1;     // Bottom
+        outPlanes.Planes[3] = row3 - row1;     // Top
+        outPlanes.Planes[4] = row3 + row2;     // Near
+        outPlanes.Planes[5] = row3 - row2;     // Far
+
+        for (size_t i = 0; i < PLANE_COUNT; ++i)
+        {
+            float length = glm::length(vec3(outPlanes.Planes[i]));
+            if (length > 0.0f)
+            {
+                outPlanes.Planes[i] /= length;
+            }
+        }
+    }
+
+    //----------------------------------------------------------------
+    // Batches
+    //----------------------------------------------------------------
+    namespace
+    {
+        // Round up to full lanes and add one extra batch, so full lanes can be loaded from any index below the count
+        size_t PaddedSize(size_t count)
+        {
+            return (count + 7) / 8 * 8 + 8;
+        }
+    }
+
+    void BoundingBoxBatch::Resize(size_t count)
+    {
+        const size_t padded = PaddedSize(count);
+        CenterX.assign(padded, 0.0f);
+        CenterY.assign(padded, 0.0f);
+        CenterZ.assign(padded, 0.0f);
+        ExtentsX.assign(padded, 0.0f);
+        ExtentsY.assign(padded, 0.0f);
+        ExtentsZ.assign(padded, 0.0f);
+        Count = count;
+    }
+
+    void BoundingBoxBatch::Set(size_t index, const BoundingBox &box)
+    {
+        CenterX[index] = box.Center.x;
+        CenterY[index] = box.Center.y;
+        CenterZ[index] = box.Center.z;
+        ExtentsX[index] = box.Extents.x;
+        ExtentsY[index] = box.Extents.y;
+        ExtentsZ[index] = box.Extents.z;
+    }
+
+    void BoundingSphereBatch::Resize(size_t count)
+    {
+        const size_t padded = PaddedSize(count);
+        CenterX.assign(padded, 0.0f);
+        CenterY.assign(padded, 0.0f);
+        CenterZ.assign(padded, 0.0f);
+        Radius.assign(padded, 0.0f);
+        Count = count;
+    }
+
+    void BoundingSphereBatch::Set(size_t index, const BoundingSphere &sphere)
+    {
+        CenterX[index] = sphere.Center.x;
+        CenterY[index] = sphere.Center.y;
+        CenterZ[index] = sphere.Center.z;
+        Radius[index] = sphere.Radius;
+    }
+
+    size_t IntersectBatch(const FrustumPlanes &planes, const BoundingBoxBatch &boxes, size_t begin, size_t count, uint8_t *outResults)
+    {
+        size_t intersectCount = 0;
+        size_t i = 0;
+
+#if COLLISION_SIMD_WIDTH == 8
+        for (; i < count; i += 8)
+        {
+            const size_t index = begin + i;
+            __m256 cx = _mm256_loadu_ps(&boxes.CenterX[index]);
+            __m256 cy = _mm256_loadu_ps(&boxes.CenterY[index]);
+            __m256 cz = _mm256_loadu_ps(&boxes.CenterZ[index]);
+            __m256 ex = _mm256_loadu_ps(&boxes.ExtentsX[index]);
+            __m256 ey = _mm256_loadu_ps(&boxes.ExtentsY[index]);
+            __m256 ez = _mm256_loadu_ps(&boxes.ExtentsZ[index]);
+
+            __m256 outside = _mm256_setzero_ps();
+            for (size_t p = 0; p < FrustumPlanes::PLANE_COUNT; ++p)
+            {
+                const vec4 &plane = planes.Planes[p];
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), cx), _mm256_mul_ps(_mm256_set1_ps(plane.y), cy)),
+                                                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), cz), _mm256_set1_ps(plane.w)));
+                __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(glm::abs(plane.x)), ex), _mm256_mul_ps(_mm256_set1_ps(glm::abs(plane.y)), ey)),
+                                              _mm256_mul_ps(_mm256_set1_ps(glm::abs(plane.z)), ez));
+                outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+            }
+
+            const int outsideMask = _mm256_movemask_ps(outside);
+            const size_t laneCount = count - i < 8 ? count - i : 8;
+            for (size_t lane = 0; lane < laneCount; ++lane)
+            {
+                const uint8_t inside = (outsideMask >> lane) & 1 ? 0 : 1;
+                outResults[i + lane] = inside;
+                intersectCount += inside;
+            }
+        }
+#elif COLLISION_SIMD_WIDTH == 4
+        for (; i < count; i += 4)
+        {
+            const size_t index = begin + i;
+            __m128 cx = _mm_loadu_ps(&boxes.CenterX[index]);
+            __m128 cy = _mm_loadu_ps(&boxes.CenterY[index]);
+            __m128 cz = _mm_loadu_ps(&boxes.CenterZ[index]);
+            __m128 ex = _mm_loadu_ps(&boxes.ExtentsX[index]);
+            __m128 ey = _mm_loadu_ps(&boxes.ExtentsY[index]);
+            __m128 ez = _mm_loadu_ps(&boxes.ExtentsZ[index]);
+
+            __m128 outside = _mm_setzero_ps();
+            for (size_t p = 0; p < FrustumPlanes::PLANE_COUNT; ++p)
+            {
+                const vec4 &plane = planes.Planes[p];
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+                                             _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), cz), _mm_set1_ps(plane.w)));
+                __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(glm::abs(plane.x)), ex), _mm_mul_ps(_mm_set1_ps(glm::abs(plane.y)), ey)),
+                                           _mm_mul_ps(_mm_set1_ps(glm::abs(plane.z)), ez));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+            }
+
+            const int outsideMask = _mm_movemask_ps(outside);
+            const size_t laneCount = count - i < 4 ? count - i : 4;
+            for (size_t lane = 0; lane < laneCount; ++lane)
+            {
+                const uint8_t inside = (outsideMask >> lane) & 1 ? 0 : 1;
+                outResults[i + lane] = inside;
+                intersectCount += inside;
+            }
+        }
+#else
+        for (; i < count; ++i)
+        {
+            const size_t index = begin + i;
+            uint8_t inside = 1;
+            for (size_t p = 0; p < FrustumPlanes::PLANE_COUNT && inside; ++p)
+            {
+                const vec4 &plane = planes.Planes[p];
+                const float distance = plane.x * boxes.CenterX[index] + plane.y * boxes.CenterY[index] + plane.z * boxes.CenterZ[index] + plane.w;
+                const float radius = glm::abs(plane.x) * boxes.ExtentsX[index] + glm::abs(plane.y) * boxes.ExtentsY[index] + glm::abs(plane.z) * boxes.ExtentsZ[index];
+                inside = distance + radius < 0.0f ? 0 : 1;
+            }
+            outResults[i] = inside;
+            intersectCount += inside;
+        }
+#endif
+        return intersectCount;
+    }
+
+    size_t IntersectBatch(const FrustumPlanes &planes, const BoundingSphereBatch &spheres, size_t begin, size_t count, uint8_t *outResults)
+    {
+        size_t intersectCount = 0;
+        size_t i = 0;
+
+#if COLLISION_SIMD_WIDTH == 8
+        for (; i < count; i += 8)
+        {
+            const size_t index = begin + i;
+            __m256 cx = _mm256_loadu_ps(&spheres.CenterX[index]);
+            __m256 cy = _mm256_loadu_ps(&spheres.CenterY[index]);
+            __m256 cz = _mm256_loadu_ps(&spheres.CenterZ[index]);
+            __m256 r = _mm256_loadu_ps(&spheres.Radius[index]);
+
+            __m256 outside = _mm256_setzero_ps();
+            for (size_t p = 0; p < FrustumPlanes::PLANE_COUNT; ++p)
+            {
+                const vec4 &plane = planes.Planes[p];
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), cx), _mm256_mul_ps(_mm256_set1_ps(plane.y), cy)),
+                                                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), cz), _mm256_set1_ps(plane.w)));
+                outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, r), _mm256_setzero_ps(), _CMP_LT_OQ));
+            }
+
+            const int outsideMask = _mm256_movemask_ps(outside);
+            const size_t laneCount = count - i < 8 ? count - i : 8;
+            for (size_t lane = 0; lane < laneCount; ++lane)
+            {
+                const uint8_t inside = (outsideMask >> lane) & 1 ? 0 : 1;
+                outResults[i + lane] = inside;
+                intersectCount += inside;
+            }
+        }
+#elif COLLISION_SIMD_WIDTH == 4
+        for (; i < count; i += 4)
+        {
+            const size_t index = begin + i;
+            __m128 cx = _mm_loadu_ps(&spheres.CenterX[index]);
+            __m128 cy = _mm_loadu_ps(&spheres.CenterY[index]);
+            __m128 cz = _mm_loadu_ps(&spheres.CenterZ[index]);
+            __m128 r = _mm_loadu_ps(&spheres.Radius[index]);
+
+            __m128 outside = _mm_setzero_ps();
+            for (size_t p = 0; p < FrustumPlanes::PLANE_COUNT; ++p)
+            {
+                const vec4 &plane = planes.Planes[p];
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+                                             _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), cz), _mm_set1_ps(plane.w)));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, r), _mm_setzero_ps()));
+            }
+
+            const int outsideMask = _mm_movemask_ps(outside);
+            const size_t laneCount = count - i < 4 ? count - i : 4;
+            for (size_t lane = 0; lane < laneCount; ++lane)
+            {
+                const uint8_t inside = (outsideMask >> lane) & 1 ? 0 : 1;
+                outResults[i + lane] = inside;
+                intersectCount += inside;
+            }
+        }
+#else
+        for (; i < count; ++i)
+        {
+            const size_t index = begin + i;
+            uint8_t inside = 1;
+            for (size_t p = 0; p < FrustumPlanes::PLANE_COUNT && inside; ++p)
+            {
+                const vec4 &plane = planes.Planes[p];
+                const float distance = plane.x * spheres.CenterX[index] + plane.y * spheres.CenterY[index] + plane.z * spheres.CenterZ[index] + plane.w;
+                inside = distance + spheres.Radius[index] < 0.0f ? 0 : 1;
+            }
+            outResults[i] = inside;
+            intersectCount += inside;
+        }
+#endif
+        return intersectCount;
+    }
 }
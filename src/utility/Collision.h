@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <cstdint>
 #include <glm/glm.hpp>
 
 using namespace glm;
@@ -17,10 +18,10 @@ namespace Collision
         
         BoundingBox() noexcept : Center(0.0f), Extents(1.0f) { }
 
-        // Get the 8 corners of the box
-        std::vector<vec3> GetCorners();
+        // Get the 8 corners of the box, outCorners must hold CORNER_COUNT points
+        void GetCorners(vec3 *outCorners) const;
         
-        // Merge other bounding box
+        // Merge other bounding box, the transformed box is exact (Arvo's method)
         void MergeBoundingBox(const BoundingBox &b, const glm::mat4 &transform = glm::mat4(1.0f));
         
         // Create axis-aligned box that contains two other bounding boxes
@@ -32,6 +33,15 @@ namespace Collision
         static void CreateFromBoundingBoxAndTransform(BoundingBox &outBox, const BoundingBox &b, const glm::mat4 &transform = glm::mat4(1.0f));
     };
 
+    struct BoundingSphere
+    {
+        vec3 Center;
+        float Radius;
+
+        BoundingSphere() noexcept : Center(0.0f), Radius(1.0f) { }
+        BoundingSphere(const vec3 &center, const float &radius) noexcept : Center(center), Radius(radius) { }
+    };
+
     struct BoundingFrustum
     {
         static constexpr size_t CORNER_COUNT = 8;
@@ -51,9 +61,55 @@ namespace Collision
         
         BoundingFrustum(const glm::mat4 &projection);
         
-        // Get the 8 corners of the frustum
-        std::vector<vec3> GetCorners();
+        // Get the 8 corners of the frustum, outCorners must hold CORNER_COUNT points
+        void GetCorners(vec3 *outCorners) const;
 
         static void CreateFromMatrix(BoundingFrustum &outFrustum, const glm::mat4 &projection);
     };
+
+    // Frustum represented by 6 planes in world space, used for culling
+    struct FrustumPlanes
+    {
+        static constexpr size_t PLANE_COUNT = 6;
+
+        vec4 Planes[PLANE_COUNT];   // Left, right, bottom, top, near, far. xyz is the normal pointing inside, w is the distance.
+
+        FrustumPlanes() noexcept { }
+
+        FrustumPlanes(const glm::mat4 &viewProjection);
+
+        // Returns false if the box is completely outside of the frustum
+        bool Intersects(const BoundingBox &box) const;
+        bool Intersects(const BoundingSphere &sphere) const;
+
+        // Extract the planes from an OpenGL view-projection matrix (Gribb-Hartmann)
+        static void CreateFromMatrix(FrustumPlanes &outPlanes, const glm::mat4 &viewProjection);
+    };
+
+    // Structure of arrays of boxes, so 4 (SSE) or 8 (AVX) boxes are tested at once.
+    // The arrays are padded, so a batch can be read in full lanes from any index below Count.
+    struct BoundingBoxBatch
+    {
+        std::vector<float> CenterX, CenterY, CenterZ;
+        std::vector<float> ExtentsX, ExtentsY, ExtentsZ;
+        size_t Count = 0;
+
+        void Resize(size_t count);
+        void Set(size_t index, const BoundingBox &box);
+    };
+
+    struct BoundingSphereBatch
+    {
+        std::vector<float> CenterX, CenterY, CenterZ;
+        std::vector<float> Radius;
+        size_t Count = 0;
+
+        void Resize(size_t count);
+        void Set(size_t index, const BoundingSphere &sphere);
+    };
+
+    // Batch intersection kernels, AVX or SSE when the compiler targets them, scalar otherwise.
+    // outResults[i] is 1 if the i-th box/sphere from begin intersects the frustum, returns the number of intersecting ones.
+    size_t IntersectBatch(const FrustumPlanes &planes, const BoundingBoxBatch &boxes, size_t begin, size_t count, uint8_t *outResults);
+    size_t IntersectBatch(const FrustumPlanes &planes, const BoundingSphereBatch &spheres, size_t begin, size_t count, uint8_t *outResults);
 } // namespace Collision
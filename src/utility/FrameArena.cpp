@@ -0,0 +1,67 @@
+#include "utility/FrameArena.h"
+
+#include <cstdlib>
+
+FrameArena::FrameArena(size_t blockSize)
+    : m_BlockSize(blockSize), m_CurrentBlock(0), m_Offset(0), m_UsedBytesInPreviousBlocks(0)
+{ }
+
+FrameArena::~FrameArena()
+{
+    for (size_t i = 0; i < m_Blocks.size(); ++i)
+    {
+        std::free(m_Blocks[i].Data);
+    }
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+    while (m_CurrentBlock < m_Blocks.size())
+    {
+        Block &block = m_Blocks[m_CurrentBlock];
+        size_t padding = (alignment - (reinterpret_cast<uintptr_t>(block.Data + m_Offset) & (alignment - 1))) & (alignment - 1);
+        size_t alignedOffset = m_Offset + padding;
+        if (alignedOffset + size <= block.Size)
+        {
+            m_Offset = alignedOffset + size;
+            return block.Data + alignedOffset;
+        }
+
+        // Move to the next block, the end of this one is wasted
+        m_UsedBytesInPreviousBlocks += m_Offset;
+        m_CurrentBlock++;
+        m_Offset = 0;
+    }
+
+    // Out of blocks, this only happens while the arena grows to the peak usage of a frame
+    Block block;
+    block.Size = size + alignment > m_BlockSize ? size + alignment : m_BlockSize;
+    block.Data = static_cast<uint8_t*>(std::malloc(block.Size));
+    m_Blocks.push_back(block);
+
+    size_t alignedOffset = (alignment - (reinterpret_cast<uintptr_t>(block.Data) & (alignment - 1))) & (alignment - 1);
+    m_Offset = alignedOffset + size;
+    return block.Data + alignedOffset;
+}
+
+void FrameArena::Reset()
+{
+    m_CurrentBlock = 0;
+    m_Offset = 0;
+    m_UsedBytesInPreviousBlocks = 0;
+}
+
+size_t FrameArena::GetUsedBytes() const
+{
+    return m_UsedBytesInPreviousBlocks + m_Offset;
+}
+
+size_t FrameArena::GetReservedBytes() const
+{
+    size_t reserved = 0;
+    for (size_t i = 0; i < m_Blocks.size(); ++i)
+    {
+        reserved += m_Blocks[i].Size;
+    }
+    return reserved;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <new>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+// Linear allocator for the objects which only live for one frame.
+// The memory blocks are kept across frames and Reset() only rewinds them, so a frame which does not need more
+// memory than the previous ones does not touch the heap. Destructors are never called, only trivially destructible types are allowed.
+class FrameArena
+{
+public:
+    FrameArena(size_t blockSize = 64 * 1024);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment);
+
+    template<typename T>
+    T* New()
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameArena never calls destructors");
+        return new (Allocate(sizeof(T), alignof(T))) T();
+    }
+
+    // Rewind to the first block, the pointers returned before become invalid
+    void Reset();
+
+    size_t GetUsedBytes() const;
+    size_t GetReservedBytes() const;
+
+private:
+    struct Block
+    {
+        uint8_t* Data;
+        size_t Size;
+    };
+
+    std::vector<Block> m_Blocks;
+    size_t m_BlockSize;
+    size_t m_CurrentBlock;
+    size_t m_Offset;
+    size_t m_UsedBytesInPreviousBlocks;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// 64-bit FNV-1a, pass the previous result as the seed to hash several pieces as one
+namespace Hash
+{
+    constexpr uint64_t FNV1A_64_OFFSET = 14695981039346656037ull;
+    constexpr uint64_t FNV1A_64_PRIME = 1099511628211ull;
+
+    inline uint64_t FNV1a64(const void *data, size_t size, uint64_t seed = FNV1A_64_OFFSET)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = seed;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ bytes[i]) * FNV1A_64_PRIME;
+        }
+        return hash;
+    }
+
+    // The length is hashed too, so the boundaries between the strings change the result
+    inline uint64_t FNV1a64(const std::string &text, uint64_t seed = FNV1A_64_OFFSET)
+    {
+        uint64_t length = text.length();
+        return FNV1a64(text.data(), text.length(), FNV1a64(&length, sizeof(length), seed));
+    }
+} // namespace Hash
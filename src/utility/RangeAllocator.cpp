@@ -0,0 +1,123 @@
+#include "utility/RangeAllocator.h"
+
+#include <iterator>
+
+RangeAllocator::RangeAllocator(uint32_t capacity)
+    : m_Capacity(0), m_FreeSize(0)
+{
+    Reset(capacity);
+}
+
+uint32_t RangeAllocator::Allocate(uint32_t size, uint32_t alignment)
+{
+    if (size == 0 || alignment == 0)
+    {
+        return INVALID_OFFSET;
+    }
+
+    // Best fit, the padding needed by the alignment counts as part of the request
+    auto best = m_FreeRanges.end();
+    uint32_t bestPadding = 0;
+    for (auto it = m_FreeRanges.begin(); it != m_FreeRanges.end(); ++it)
+    {
+        uint32_t padding = (alignment - it->first % alignment) % alignment;
+        if (it->second < size + padding)
+        {
+            continue;
+        }
+
+        if (best == m_FreeRanges.end() || it->second < best->second)
+        {
+            best = it;
+            bestPadding = padding;
+            if (it->second == size + padding)
+            {
+                break;
+            }
+        }
+    }
+
+    if (best == m_FreeRanges.end())
+    {
+        return INVALID_OFFSET;
+    }
+
+    uint32_t rangeOffset = best->first;
+    uint32_t rangeSize = best->second;
+    m_FreeRanges.erase(best);
+
+    uint32_t offset = rangeOffset + bestPadding;
+    if (bestPadding > 0)
+    {
+        m_FreeRanges[rangeOffset] = bestPadding;
+    }
+    uint32_t tail = rangeSize - bestPadding - size;
+    if (tail > 0)
+    {
+        m_FreeRanges[offset + size] = tail;
+    }
+
+    m_FreeSize -= size;
+    return offset;
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t size)
+{
+    if (size == 0 || offset == INVALID_OFFSET)
+    {
+        return;
+    }
+
+    m_FreeSize += size;
+    InsertFreeRange(offset, size);
+}
+
+void RangeAllocator::Reset(uint32_t capacity)
+{
+    m_FreeRanges.clear();
+    m_Capacity = capacity;
+    m_FreeSize = capacity;
+    if (capacity > 0)
+    {
+        m_FreeRanges[0] = capacity;
+    }
+}
+
+void RangeAllocator::Grow(uint32_t capacity)
+{
+    if (capacity <= m_Capacity)
+    {
+        return;
+    }
+
+    uint32_t oldCapacity = m_Capacity;
+    m_Capacity = capacity;
+    m_FreeSize += capacity - oldCapacity;
+    InsertFreeRange(oldCapacity, capacity - oldCapacity);
+}
+
+void RangeAllocator::InsertFreeRange(uint32_t offset, uint32_t size)
+{
+    auto next = m_FreeRanges.lower_bound(offset);
+
+    // Merge with the free range ending at the offset
+    if (next != m_FreeRanges.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            offset = previous->first;
+            size += previous->second;
+            m_FreeRanges.erase(previous);
+        }
+    }
+
+    // Merge with the free range starting at the end
+    if (next != m_FreeRanges.end() && offset + size == next->first)
+    {
+        size += next->second;
+        m_FreeRanges.erase(next);
+    }
+
+    m_FreeRanges[offset] = size;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+// Free-list allocator of ranges in a linear space (elements of a GPU buffer), it does not own any memory.
+// The free ranges are kept sorted by offset and merged with their neighbours when a range is freed,
+// an allocation takes the smallest free range it fits in to keep the large ranges for the large requests.
+class RangeAllocator
+{
+public:
+    static constexpr uint32_t INVALID_OFFSET = 0xFFFFFFFFu;
+
+    RangeAllocator(uint32_t capacity = 0);
+
+    // Returns INVALID_OFFSET if no free range is large enough
+    uint32_t Allocate(uint32_t size, uint32_t alignment = 1);
+    void Free(uint32_t offset, uint32_t size);
+
+    // Everything becomes free
+    void Reset(uint32_t capacity);
+    // Add the space from the current capacity to the new one at the end
+    void Grow(uint32_t capacity);
+
+    uint32_t GetCapacity() const { return m_Capacity; }
+    uint32_t GetUsedSize() const { return m_Capacity - m_FreeSize; }
+    uint32_t GetFreeSize() const { return m_FreeSize; }
+    size_t GetFreeRangeCount() const { return m_FreeRanges.size(); }
+
+private:
+    void InsertFreeRange(uint32_t offset, uint32_t size);
+
+    // Offset -> size of the free ranges
+    std::map<uint32_t, uint32_t> m_FreeRanges;
+    uint32_t m_Capacity;
+    uint32_t m_FreeSize;
+};
@@ -7,3 +7,50 @@ bool StatusRecorder::FXAA = true;
 bool StatusRecorder::ToneMapping = true;
 bool StatusRecorder::DeferredRendering = true;
 bool StatusRecorder::SSAO = true;
+bool StatusRecorder::DepthPrePass = true;
+bool StatusRecorder::FrustumCulling = true;
+bool StatusRecorder::SortCommands = true;
+bool StatusRecorder::SortTransparentTriangles = false;
+bool StatusRecorder::Instancing = true;
+bool StatusRecorder::StaticBatching = false;
+
+float StatusRecorder::TransformUpdateTime = 0.0f;
+float StatusRecorder::SceneBoundsUpdateTime = 0.0f;
+unsigned int StatusRecorder::VisibleMeshCount = 0;
+unsigned int StatusRecorder::CulledMeshCount = 0;
+unsigned int StatusRecorder::ShadowCasterDrawCount = 0;
+unsigned int StatusRecorder::ShadowCasterCulledCount = 0;
+float StatusRecorder::BVHBuildTime = 0.0f;
+float StatusRecorder::BVHRefitTime = 0.0f;
+float StatusRecorder::BVHQueryTime = 0.0f;
+unsigned int StatusRecorder::CommandBuildAllocations = 0;
+unsigned int StatusRecorder::ProgramSwitches = 0;
+unsigned int StatusRecorder::TextureBinds = 0;
+unsigned int StatusRecorder::UniformUploads = 0;
+unsigned int StatusRecorder::UniformBufferBinds = 0;
+unsigned int StatusRecorder::DrawUniformUploadBytes = 0;
+unsigned int StatusRecorder::UniformRingWaits = 0;
+unsigned int StatusRecorder::RenderTargetAllocations = 0;
+unsigned int StatusRecorder::PooledRenderTargetCount = 0;
+float StatusRecorder::PooledRenderTargetMemory = 0.0f;
+unsigned int StatusRecorder::FrameGraphPassCount = 0;
+unsigned int StatusRecorder::FrameGraphCulledPassCount = 0;
+unsigned int StatusRecorder::FrameGraphTransientTargets = 0;
+unsigned int StatusRecorder::FrameGraphPhysicalTargets = 0;
+float StatusRecorder::FrameGraphAliasedMemory = 0.0f;
+unsigned int StatusRecorder::VertexArrayBinds = 0;
+unsigned int StatusRecorder::GeometryPoolRebuilds = 0;
+unsigned int StatusRecorder::InstancedBatchCount = 0;
+unsigned int StatusRecorder::InstancedCommandCount = 0;
+unsigned int StatusRecorder::InstancedShadowBatchCount = 0;
+unsigned int StatusRecorder::OpaqueDrawCount = 0;
+unsigned int StatusRecorder::StaticBatchCount = 0;
+unsigned int StatusRecorder::StaticBatchedMeshCount = 0;
+float StatusRecorder::StaticBatchingTime = 0.0f;
+unsigned int StatusRecorder::ShaderCacheHits = 0;
+unsigned int StatusRecorder::ShaderCacheMisses = 0;
+unsigned int StatusRecorder::ShaderCompiles = 0;
+unsigned int StatusRecorder::ShaderFileReads = 0;
+unsigned int StatusRecorder::ShaderBinaryCacheHits = 0;
+float StatusRecorder::ShaderCompileTime = 0.0f;
+float StatusRecorder::StartupTime = 0.0f;
@@ -10,4 +10,52 @@ public:
     static bool ToneMapping;
     static bool DeferredRendering;
     static bool SSAO;
+    static bool DepthPrePass;
+    static bool FrustumCulling;
+    static bool SortCommands;
+    static bool SortTransparentTriangles;
+    static bool Instancing;
+    static bool StaticBatching; // Read when the models are loaded
+
+    // Statistics
+    static float TransformUpdateTime; // Milliseconds spent in updating the world matrices of the scene nodes per frame
+    static float SceneBoundsUpdateTime; // Milliseconds spent in updating the scene bounds per frame
+    static unsigned int VisibleMeshCount; // Meshes inside the camera frustum
+    static unsigned int CulledMeshCount; // Meshes rejected by the camera frustum
+    static unsigned int ShadowCasterDrawCount; // Shadow caster draws summed over all cascades
+    static unsigned int ShadowCasterCulledCount; // Shadow casters rejected by the cascades, summed over all cascades
+    static float BVHBuildTime; // Milliseconds spent in the last build of the scene BVH
+    static float BVHRefitTime; // Milliseconds spent in the last refit of the scene BVH
+    static float BVHQueryTime; // Milliseconds spent in querying the scene BVH per frame, camera and cascades
+    static unsigned int CommandBuildAllocations; // Heap allocations while building the render commands of a frame
+    static unsigned int ProgramSwitches; // glUseProgram calls per frame
+    static unsigned int TextureBinds; // glBindTexture calls per frame
+    static unsigned int UniformUploads; // glUniform calls of the material values and the per-draw matrices per frame
+    static unsigned int UniformBufferBinds; // glBindBufferRange calls of the material parameter blocks and the per-draw uniforms per frame
+    static unsigned int DrawUniformUploadBytes; // Bytes of per-draw uniforms uploaded per frame, 0 while no transform changes
+    static unsigned int UniformRingWaits; // Times an upload to a uniform ring buffer waited for the GPU to release a region
+    static unsigned int RenderTargetAllocations; // Render targets created or resized by the render target pool per frame
+    static unsigned int PooledRenderTargetCount; // Transient render targets kept by the pool
+    static float PooledRenderTargetMemory; // Megabytes of the attachments of the pooled render targets
+    static unsigned int FrameGraphPassCount; // Passes added to the frame graph
+    static unsigned int FrameGraphCulledPassCount; // Passes culled because nothing reads their output
+    static unsigned int FrameGraphTransientTargets; // Transient targets used by the live passes
+    static unsigned int FrameGraphPhysicalTargets; // Pooled targets backing them, targets with disjoint lifetimes share one
+    static float FrameGraphAliasedMemory; // Megabytes saved by the sharing
+    static unsigned int VertexArrayBinds; // glBindVertexArray calls per frame
+    static unsigned int GeometryPoolRebuilds; // Times the geometry pools were grown or compacted
+    static unsigned int InstancedBatchCount; // Instanced draws of the opaque pass
+    static unsigned int InstancedCommandCount; // Opaque commands drawn through the instanced draws
+    static unsigned int InstancedShadowBatchCount; // Instanced shadow caster draws summed over all cascades
+    static unsigned int OpaqueDrawCount; // Draw calls of the opaque pass
+    static unsigned int StaticBatchCount; // Meshes created by the static batching
+    static unsigned int StaticBatchedMeshCount; // Source meshes merged by the static batching
+    static float StaticBatchingTime; // Milliseconds spent in the static batching at load time
+    static unsigned int ShaderCacheHits; // Shader loads served by an already linked program
+    static unsigned int ShaderCacheMisses; // Shader loads without an already linked program, compiled or loaded from a binary
+    static unsigned int ShaderCompiles; // Shader cache misses which compiled and linked a program
+    static unsigned int ShaderFileReads; // Shader files read from disk, each file is only read once
+    static unsigned int ShaderBinaryCacheHits; // Programs loaded from the binaries on disk instead of compiled
+    static float ShaderCompileTime; // Milliseconds spent compiling, linking or loading the binaries of programs
+    static float StartupTime; // Milliseconds from the start of main() to the end of the first frame
 };